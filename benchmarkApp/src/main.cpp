@@ -0,0 +1,787 @@
+#include "ObjLoader.h"
+#include "SceneFile.h"
+#include "SceneJSON.h"
+#include "ScenePresets.h"
+#include "Tracer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+
+namespace
+{
+    struct Options
+    {
+        size_t MaxShapes = 1000000;
+        size_t MeshTriangles = 1000000;
+        int MaxThreads = 0; // 0 uses every hardware thread
+        int Repetitions = 5;
+        std::string Filter;
+        std::string FrameScene = "spheres:1000";
+        std::vector<int> BVHWidths = {2, 4, 8};
+    };
+
+    struct Result
+    {
+        std::string Name;
+        std::string Scene;
+        size_t Shapes = 0;
+        glm::uint32 Width = 0, Height = 0;
+        int Threads = 1;
+        int BVHWidth = 2;
+        bool Quantized = false;
+        double BytesPerPrimitive = 0.0; // Nodes of the traversed tree over its primitives, traversal benchmarks only
+        double Rays = 0.0;
+        double BestMs = 0.0;
+        double BuildMs = 0.0;
+    };
+
+    volatile float Sink = 0.0f;
+
+    void PrintUsage(const char *executable)
+    {
+        std::cerr << "Usage: " << executable << " [options]\n"
+                  << "  --max-shapes <n>    largest TraceRay scene (1000000)\n"
+                  << "  --max-threads <n>   largest frame and build thread count, 0 = all (0)\n"
+                  << "  --repetitions <n>   runs per measurement, the best is reported (5)\n"
+                  << "  --filter <text>     only run benchmarks whose name contains text\n"
+                  << "  --frame-scene <s>   scene preset for the frame benchmarks (spheres:1000)\n"
+                  << "  --mesh-triangles <n> triangles of the mesh benchmarks' torus (1000000)\n"
+                  << "  --bvh-widths <list> BVH branching factors the traversal benchmarks compare (2,4,8),\n"
+                  << "                      widths 4 and 8 run with float and quantized nodes\n"
+                  << "Results are printed to stdout as JSON, progress goes to stderr." << std::endl;
+    }
+
+    bool ParseArguments(int argc, char **argv, Options &options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            if (arg == "--help" || arg == "-h" || i + 1 >= argc)
+                return false;
+
+            const char *value = argv[++i];
+            if (arg == "--max-shapes")
+                options.MaxShapes = (size_t)std::max(1L, std::atol(value));
+            else if (arg == "--max-threads")
+                options.MaxThreads = std::max(0, std::atoi(value));
+            else if (arg == "--mesh-triangles")
+                options.MeshTriangles = (size_t)std::max(1L, std::atol(value));
+            else if (arg == "--repetitions")
+                options.Repetitions = std::max(1, std::atoi(value));
+            else if (arg == "--filter")
+                options.Filter = value;
+            else if (arg == "--frame-scene")
+                options.FrameScene = value;
+            else if (arg == "--bvh-widths")
+            {
+                options.BVHWidths.clear();
+                std::stringstream list(value);
+                std::string item;
+                while (std::getline(list, item, ','))
+                {
+                    int width = std::atoi(item.c_str());
+                    if (width == 2 || width == 4 || width == 8)
+                        options.BVHWidths.push_back(width);
+                }
+                if (options.BVHWidths.empty())
+                {
+                    std::cerr << "No valid BVH width in " << value << std::endl;
+                    return false;
+                }
+            }
+            else
+            {
+                std::cerr << "Unknown option " << arg << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    template <typename Func>
+    double MeasureBestMs(int repetitions, const Func &func)
+    {
+        double best = std::numeric_limits<double>::max();
+        for (int i = 0; i < repetitions; i++)
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+            func();
+            auto end = std::chrono::high_resolution_clock::now();
+            best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+        }
+        return best;
+    }
+
+    // Rays from a shell around the origin aimed at a box of the given half size, roughly half of them hit a unit sphere
+    std::vector<Ray> MakeRays(size_t count, float targetSize)
+    {
+        std::mt19937 engine(42);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+        std::vector<Ray> rays(count);
+        for (Ray &ray : rays)
+        {
+            glm::vec3 origin;
+            do
+                origin = glm::vec3(unit(engine), unit(engine), unit(engine));
+            while (glm::dot(origin, origin) < 0.01f || glm::dot(origin, origin) > 1.0f);
+            ray.Origin = glm::normalize(origin) * 5.0f;
+            glm::vec3 target = glm::vec3(unit(engine), unit(engine), unit(engine)) * targetSize;
+            ray.Direction = glm::normalize(target - ray.Origin);
+        }
+        return rays;
+    }
+
+    std::vector<Ray> MakeCameraRays(const Camera &camera)
+    {
+        std::vector<Ray> rays;
+        rays.reserve(camera.GetRayDirections().size());
+        for (const glm::vec3 &direction : camera.GetRayDirections())
+        {
+            Ray ray;
+            ray.Origin = camera.GetPosition();
+            ray.Direction = direction;
+            rays.push_back(ray);
+        }
+        return rays;
+    }
+
+    class Suite
+    {
+    public:
+        explicit Suite(const Options &options) : options(options) {}
+
+        bool Enabled(const std::string &name) const
+        {
+            return options.Filter.empty() || name.find(options.Filter) != std::string::npos;
+        }
+
+        void Add(const Result &result)
+        {
+            std::cerr << result.Name << " " << result.Scene;
+            if (result.Width > 0)
+                std::cerr << " " << result.Width << "x" << result.Height << " threads=" << result.Threads;
+            if (result.BVHWidth != 2)
+                std::cerr << " bvh" << result.BVHWidth << (result.Quantized ? "q" : "");
+            if (result.BytesPerPrimitive > 0.0)
+                std::cerr << " " << result.BytesPerPrimitive << " B/prim";
+            std::cerr << ": " << result.BestMs * 1e6 / result.Rays << " ns/ray" << std::endl;
+            results.push_back(result);
+        }
+
+        void RunShapeKernels()
+        {
+            std::vector<Ray> rays = MakeRays(1 << 20, 1.5f);
+
+            std::shared_ptr<Shape> sphere = std::make_shared<Sphere>();
+            ((Sphere &)*sphere).SetRadius(1.0f);
+            std::shared_ptr<Shape> plane = std::make_shared<Plane>();
+            ((Plane &)*plane).Normal = glm::vec3(0.0f, 0.0f, -1.0f);
+
+            const std::pair<const char *, std::shared_ptr<Shape>> kernels[] = {
+                {"sphere_closest_hit", sphere},
+                {"plane_closest_hit", plane}};
+
+            for (const auto &kernel : kernels)
+            {
+                if (!Enabled(kernel.first))
+                    continue;
+
+                const Shape &shape = *kernel.second;
+                Result result;
+                result.Name = kernel.first;
+                result.Shapes = 1;
+                result.Rays = (double)rays.size();
+                result.BestMs = MeasureBestMs(options.Repetitions, [&]
+                                              {
+                    float sum = 0.0f;
+                    for (const Ray &ray : rays)
+                        sum += shape.GetClosestHit(ray);
+                    Sink = Sink + sum; });
+                Add(result);
+            }
+
+            // One ray against a run of spheres in SoA storage, a full vector of the SIMD kernel per step
+            if (Enabled("sphere_kernel"))
+            {
+                Scene scene;
+                for (int i = 0; i < 8; i++)
+                {
+                    std::shared_ptr<Sphere> sphere = std::make_shared<Sphere>();
+                    sphere->SetPosition(glm::vec3((float)(i % 4) - 1.5f, (float)(i / 4) - 0.5f, 0.0f));
+                    sphere->SetRadius(0.5f);
+                    scene.Shapes.push_back(sphere);
+                }
+                CompiledScene compiled;
+                compiled.Compile(scene);
+
+                Result result;
+                result.Name = "sphere_kernel";
+                result.Scene = SphereKernel::GetInstructionSet();
+                result.Shapes = scene.Shapes.size();
+                result.Rays = (double)rays.size();
+                result.BestMs = MeasureBestMs(options.Repetitions, [&]
+                                              {
+                    float sum = 0.0f;
+                    for (const Ray &ray : rays)
+                    {
+                        float hitDistance = std::numeric_limits<float>::max();
+                        int hitIndex = -1;
+                        compiled.IntersectSpheres(ray, 0, (glm::uint32)scene.Shapes.size(), hitDistance, hitIndex);
+                        sum += (float)hitIndex;
+                    }
+                    Sink = Sink + sum; });
+                Add(result);
+            }
+        }
+
+        void RunTraceRay()
+        {
+            bool closest = Enabled("trace_ray");
+            bool shadow = Enabled("trace_shadow_ray");
+            bool bruteForce = Enabled("trace_ray_brute_force");
+            if (!closest && !shadow && !bruteForce)
+                return;
+
+            for (size_t shapes = 10; shapes <= options.MaxShapes; shapes *= 10)
+            {
+                Scene scene;
+                Camera camera(45.0f, 0.1f, 100.0f);
+                std::string sceneName = "spheres:" + std::to_string(shapes);
+                ScenePresets::Load(sceneName, scene, camera);
+                camera.OnResize(256, 256);
+                std::vector<Ray> rays = MakeCameraRays(camera);
+
+                Tracer tracer;
+                tracer.PrepareScene(scene);
+
+                Result result;
+                result.Scene = sceneName;
+                result.Shapes = shapes;
+                result.Rays = (double)rays.size();
+                result.BuildMs = tracer.GetBVHStats().BuildTimeMs;
+
+                for (const TreeLayout &layout : GetTreeLayouts())
+                {
+                    tracer.GetSettings().BVHWidth = layout.Width;
+                    tracer.GetSettings().QuantizedBVH = layout.Quantized;
+                    tracer.PrepareScene(scene);
+                    result.BVHWidth = layout.Width;
+                    result.Quantized = layout.Quantized;
+                    result.BytesPerPrimitive = (double)tracer.GetBVHMemorySize() / std::max(tracer.GetBVHStats().BoundedCount, 1u);
+
+                    if (closest)
+                    {
+                        result.Name = "trace_ray";
+                        result.BestMs = MeasureBestMs(options.Repetitions, [&]
+                                                      {
+                            float sum = 0.0f;
+                            for (const Ray &ray : rays)
+                                sum += tracer.TraceRay(ray).HitDistance;
+                            Sink = Sink + sum; });
+                        Add(result);
+                    }
+                    if (shadow)
+                    {
+                        result.Name = "trace_shadow_ray";
+                        result.BestMs = MeasureBestMs(options.Repetitions, [&]
+                                                      {
+                            int blocked = 0;
+                            for (const Ray &ray : rays)
+                                blocked += tracer.TraceShadowRay(ray, std::numeric_limits<float>::max()) ? 1 : 0;
+                            Sink = Sink + (float)blocked; });
+                        Add(result);
+                    }
+                }
+                result.BVHWidth = 2;
+                result.Quantized = false;
+                result.BytesPerPrimitive = 0.0;
+
+                // Every ray against every sphere, only worth measuring while it finishes in reasonable time
+                if (bruteForce && shapes <= 1000)
+                {
+                    tracer.GetSettings().UseBVH = false;
+                    result.Name = "trace_ray_brute_force";
+                    result.BestMs = MeasureBestMs(options.Repetitions, [&]
+                                                  {
+                        float sum = 0.0f;
+                        for (const Ray &ray : rays)
+                            sum += tracer.TraceRay(ray).HitDistance;
+                        Sink = Sink + sum; });
+                    Add(result);
+                }
+            }
+        }
+
+        // Camera rays only, no shading: one TraceRay per pixel against 4x4 and 8x8 packets
+        void RunPrimaryRays()
+        {
+            if (!Enabled("primary"))
+                return;
+
+            Scene scene;
+            Camera camera(45.0f, 0.1f, 100.0f);
+            if (!ScenePresets::Load(options.FrameScene, scene, camera))
+            {
+                std::cerr << "Unknown scene " << options.FrameScene << std::endl;
+                return;
+            }
+
+            const glm::uint32 width = 1920, height = 1080;
+            camera.OnResize(width, height);
+            Tracer tracer;
+            tracer.PrepareScene(scene);
+
+            Result result;
+            result.Scene = options.FrameScene;
+            result.Shapes = scene.Shapes.size();
+            result.Width = width;
+            result.Height = height;
+            result.Rays = (double)width * height;
+            result.BuildMs = tracer.GetBVHStats().BuildTimeMs;
+
+            for (const TreeLayout &layout : GetTreeLayouts())
+            {
+                tracer.GetSettings().BVHWidth = layout.Width;
+                tracer.GetSettings().QuantizedBVH = layout.Quantized;
+                tracer.PrepareScene(scene);
+                result.BVHWidth = layout.Width;
+                result.Quantized = layout.Quantized;
+                result.BytesPerPrimitive = (double)tracer.GetBVHMemorySize() / std::max(tracer.GetBVHStats().BoundedCount, 1u);
+
+                if (Enabled("primary_rays"))
+                {
+                    std::vector<Ray> rays = MakeCameraRays(camera);
+                    result.Name = "primary_rays";
+                    result.BestMs = MeasureBestMs(options.Repetitions, [&]
+                                                  {
+                        float sum = 0.0f;
+                        for (const Ray &ray : rays)
+                            sum += tracer.TraceRay(ray).HitDistance;
+                        Sink = Sink + sum; });
+                    Add(result);
+                }
+
+                for (glm::uint32 blockSize : {4u, 8u})
+                {
+                    std::string name = "primary_packets_" + std::to_string(blockSize) + "x" + std::to_string(blockSize);
+                    if (!Enabled(name))
+                        continue;
+
+                    RayPacket packet;
+                    result.Name = name;
+                    result.BestMs = MeasureBestMs(options.Repetitions, [&]
+                                                  {
+                        float sum = 0.0f;
+                        for (glm::uint32 y = 0; y < height; y += blockSize)
+                        {
+                            for (glm::uint32 x = 0; x < width; x += blockSize)
+                            {
+                                packet.Generate(camera.GetPosition(), camera.GetRayDirections(), width, x, y, blockSize, width, height);
+                                tracer.TracePacket(packet);
+                                sum += packet.HitDistance[0];
+                            }
+                        }
+                        Sink = Sink + sum; });
+                    Add(result);
+                }
+            }
+        }
+
+        void RunFrames()
+        {
+            if (!Enabled("frame") && !Enabled("frame_wavefront") && !Enabled("frame_wavefront_sorted"))
+                return;
+
+            const glm::uint32 resolutions[][2] = {{1280, 720}, {1920, 1080}, {3840, 2160}};
+
+            std::vector<int> threadCounts = GetThreadCounts();
+            int maxThreads = threadCounts.back();
+
+            Scene scene;
+            Camera camera(45.0f, 0.1f, 100.0f);
+            if (!ScenePresets::Load(options.FrameScene, scene, camera))
+            {
+                std::cerr << "Unknown scene " << options.FrameScene << std::endl;
+                return;
+            }
+
+            for (const auto &resolution : resolutions)
+            {
+                if (!Enabled("frame"))
+                    break;
+
+                camera.OnResize(resolution[0], resolution[1]);
+                std::vector<glm::uint32> data(resolution[0] * resolution[1]);
+
+                for (int threads : threadCounts)
+                {
+                    Tracer tracer;
+                    tracer.GetSettings().ThreadCount = threads;
+                    tracer.OnResize(resolution[0], resolution[1]);
+                    scene.GeometryDirty = true;
+                    tracer.PrepareScene(scene);
+
+                    Result result;
+                    result.Name = "frame";
+                    result.Scene = options.FrameScene;
+                    result.Shapes = scene.Shapes.size();
+                    result.Width = resolution[0];
+                    result.Height = resolution[1];
+                    result.Threads = tracer.GetThreadCount();
+                    result.Rays = (double)resolution[0] * resolution[1];
+                    result.BuildMs = tracer.GetBVHStats().BuildTimeMs;
+                    result.BestMs = MeasureBestMs(options.Repetitions, [&]
+                                                  { tracer.Render(scene, camera, data.data()); });
+                    Add(result);
+                }
+            }
+
+            // The same frame traced stage by stage, on every thread
+            const glm::uint32 width = 1920, height = 1080;
+            camera.OnResize(width, height);
+            std::vector<glm::uint32> data(width * height);
+            for (bool sortByMaterial : {false, true})
+            {
+                std::string name = sortByMaterial ? "frame_wavefront_sorted" : "frame_wavefront";
+                if (!Enabled(name))
+                    continue;
+
+                Tracer tracer;
+                tracer.GetSettings().ThreadCount = maxThreads;
+                tracer.GetSettings().Wavefront = true;
+                tracer.GetSettings().SortByMaterial = sortByMaterial;
+                tracer.OnResize(width, height);
+                scene.GeometryDirty = true;
+                tracer.PrepareScene(scene);
+
+                Result result;
+                result.Name = name;
+                result.Scene = options.FrameScene;
+                result.Shapes = scene.Shapes.size();
+                result.Width = width;
+                result.Height = height;
+                result.Threads = tracer.GetThreadCount();
+                result.Rays = (double)width * height;
+                result.BuildMs = tracer.GetBVHStats().BuildTimeMs;
+                result.BestMs = MeasureBestMs(options.Repetitions, [&]
+                                              { tracer.Render(scene, camera, data.data()); });
+                Add(result);
+            }
+        }
+
+        // Small frames of lights:<count> with every light shaded against one light per hit, resampled or picked
+        // from the light tree; the first grows with the light count, the others should barely
+        void RunLightSampling()
+        {
+            const glm::uint32 width = 320, height = 180;
+            for (size_t lightCount : {16, 64, 256})
+            {
+                std::string sceneName = "lights:" + std::to_string(lightCount);
+                Scene scene;
+                Camera camera(45.0f, 0.1f, 100.0f);
+                ScenePresets::Load(sceneName, scene, camera);
+                camera.OnResize(width, height);
+                std::vector<glm::uint32> data(width * height);
+
+                for (LightSampling sampling : {LightSampling::All, LightSampling::Resampled, LightSampling::Tree})
+                {
+                    std::string name = sampling == LightSampling::All         ? "frame_lights_all"
+                                       : sampling == LightSampling::Resampled ? "frame_lights_resampled"
+                                                                              : "frame_lights_tree";
+                    if (!Enabled(name))
+                        continue;
+
+                    Tracer tracer;
+                    tracer.GetSettings().ThreadCount = GetThreadCounts().back();
+                    tracer.GetSettings().LightSelection = sampling;
+                    tracer.OnResize(width, height);
+                    scene.GeometryDirty = true;
+                    tracer.PrepareScene(scene);
+
+                    Result result;
+                    result.Name = name;
+                    result.Scene = sceneName;
+                    result.Shapes = scene.Shapes.size();
+                    result.Width = width;
+                    result.Height = height;
+                    result.Threads = tracer.GetThreadCount();
+                    result.Rays = (double)width * height;
+                    result.BuildMs = tracer.GetBVHStats().BuildTimeMs;
+                    result.BestMs = MeasureBestMs(options.Repetitions, [&]
+                                                  { tracer.Render(scene, camera, data.data()); });
+                    Add(result);
+                }
+            }
+        }
+
+        // Camera rays against one large torus mesh, then the same torus written to an OBJ file and loaded back,
+        // the load per triangle instead of per ray (BVH build included)
+        void RunMeshes()
+        {
+            if (!Enabled("mesh_ray") && !Enabled("mesh_obj_load"))
+                return;
+
+            std::string preset = "torus:" + std::to_string(options.MeshTriangles);
+            Scene scene;
+            Camera camera(45.0f, 0.1f, 100.0f);
+            ScenePresets::Load(preset, scene, camera);
+            const Mesh &mesh = static_cast<const Mesh &>(*scene.Shapes[0]);
+
+            Result result;
+            result.Scene = preset;
+            result.Shapes = mesh.GetTriangleCount();
+            result.BuildMs = mesh.GetBVHStats().BuildTimeMs;
+
+            if (Enabled("mesh_ray"))
+            {
+                camera.OnResize(512, 512);
+                std::vector<Ray> rays = MakeCameraRays(camera);
+                Tracer tracer;
+                tracer.PrepareScene(scene);
+
+                result.Name = "mesh_ray";
+                result.Rays = (double)rays.size();
+                result.BytesPerPrimitive = (double)mesh.GetMemorySize() / std::max(mesh.GetTriangleCount(), 1u);
+                result.BestMs = MeasureBestMs(options.Repetitions, [&]
+                                              {
+                    float sum = 0.0f;
+                    for (const Ray &ray : rays)
+                        sum += tracer.TraceRay(ray).HitDistance;
+                    Sink = Sink + sum; });
+                Add(result);
+                result.BytesPerPrimitive = 0.0;
+            }
+
+            if (Enabled("mesh_obj_load"))
+            {
+                std::string path = (std::filesystem::temp_directory_path() / "briar_mesh_bench.obj").string();
+                FILE *file = std::fopen(path.c_str(), "w");
+                if (!file)
+                {
+                    std::cerr << "Cannot write " << path << std::endl;
+                    return;
+                }
+                for (const glm::vec3 &vertex : mesh.Vertices)
+                    std::fprintf(file, "v %.6f %.6f %.6f\n", vertex.x, vertex.y, vertex.z);
+                for (size_t i = 0; i < mesh.Indices.size(); i += 3)
+                    std::fprintf(file, "f %u %u %u\n", mesh.Indices[i] + 1, mesh.Indices[i + 1] + 1, mesh.Indices[i + 2] + 1);
+                std::fclose(file);
+
+                Mesh loaded;
+                result.Name = "mesh_obj_load";
+                result.Rays = (double)mesh.GetTriangleCount();
+                result.BestMs = MeasureBestMs(options.Repetitions, [&]
+                                              { ObjLoader::Load(path, loaded); });
+                result.BuildMs = loaded.GetBVHStats().BuildTimeMs;
+                Add(result);
+                std::remove(path.c_str());
+            }
+        }
+
+        // Rebuilds the largest sphere scene from scratch with each builder on growing thread counts,
+        // per primitive instead of per ray
+        void RunBuild()
+        {
+            if (!Enabled("bvh_build"))
+                return;
+
+            std::string preset = "spheres:" + std::to_string(options.MaxShapes);
+            Scene scene;
+            Camera camera(45.0f, 0.1f, 100.0f);
+            ScenePresets::Load(preset, scene, camera);
+
+            for (BVHBuilder builder : {BVHBuilder::SAH, BVHBuilder::LBVH})
+            {
+                std::string name = builder == BVHBuilder::LBVH ? "bvh_build_lbvh" : "bvh_build";
+                if (!Enabled(name))
+                    continue;
+
+                scene.Builder = builder;
+                for (int threads : GetThreadCounts())
+                {
+                    Tracer tracer;
+                    tracer.GetSettings().ThreadCount = threads;
+
+                    Result result;
+                    result.Name = name;
+                    result.Scene = preset;
+                    result.Shapes = scene.Shapes.size();
+                    result.Rays = (double)scene.Shapes.size();
+                    result.BestMs = std::numeric_limits<double>::max();
+                    for (int i = 0; i < options.Repetitions; i++)
+                    {
+                        scene.GeometryDirty = true;
+                        tracer.PrepareScene(scene);
+                        result.BestMs = std::min(result.BestMs, (double)tracer.GetBVHStats().BuildTimeMs);
+                    }
+                    result.Threads = tracer.GetThreadCount();
+                    result.BuildMs = result.BestMs;
+                    Add(result);
+                }
+            }
+        }
+
+        // The largest sphere scene saved with its BVH, then mapped and prepared for tracing again, per primitive.
+        // Compare with bvh_build for what the prebuilt tree saves
+        void RunSceneFile()
+        {
+            if (!Enabled("scene_file_load"))
+                return;
+
+            std::string preset = "spheres:" + std::to_string(options.MaxShapes);
+            std::string path = (std::filesystem::temp_directory_path() / "briar_scene_bench.bscn").string();
+            {
+                Scene scene;
+                Camera camera(45.0f, 0.1f, 100.0f);
+                ScenePresets::Load(preset, scene, camera);
+                if (!SceneFile::Save(path, scene, camera, true, BVHBuilder::SAH))
+                    return;
+            }
+
+            Tracer tracer;
+            Result result;
+            result.Name = "scene_file_load";
+            result.Scene = preset;
+            result.Shapes = options.MaxShapes;
+            result.Rays = (double)options.MaxShapes;
+            result.BestMs = MeasureBestMs(options.Repetitions, [&]
+                                          {
+                Scene scene;
+                Camera camera(45.0f, 0.1f, 100.0f);
+                SceneFile::Load(path, scene, camera);
+                tracer.PrepareScene(scene); });
+            result.Threads = tracer.GetThreadCount();
+            result.BuildMs = tracer.GetBVHStats().BuildTimeMs;
+            Add(result);
+            std::remove(path.c_str());
+        }
+
+        // Parse speed of a JSON scene already in memory, reported per byte
+        void RunSceneJSON()
+        {
+            if (!Enabled("scene_json_parse"))
+                return;
+
+            std::string preset = "spheres:" + std::to_string(options.MaxShapes);
+            std::string path = (std::filesystem::temp_directory_path() / "briar_scene_bench.json").string();
+            {
+                Scene scene;
+                Camera camera(45.0f, 0.1f, 100.0f);
+                ScenePresets::Load(preset, scene, camera);
+                if (!SceneJSON::Save(path, scene, camera))
+                    return;
+            }
+            std::ifstream file(path, std::ios::binary);
+            std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            std::remove(path.c_str());
+
+            Result result;
+            result.Name = "scene_json_parse";
+            result.Scene = preset;
+            result.Shapes = options.MaxShapes;
+            result.Rays = (double)text.size();
+            result.BestMs = MeasureBestMs(options.Repetitions, [&]
+                                          {
+                SceneJSON::SceneDescription description;
+                std::string error;
+                SceneJSON::Parse(text.data(), text.size(), "", description, error); });
+            Add(result);
+        }
+
+        void PrintJSON(std::ostream &out) const
+        {
+            out << "{\n  \"machine\": {\"hardware_threads\": " << std::thread::hardware_concurrency()
+                << ", \"tbb_threads\": " << TileScheduler::GetMaxThreadCount()
+                << ", \"simd\": \"" << SphereKernel::GetInstructionSet() << "\"},\n"
+                << "  \"repetitions\": " << options.Repetitions << ",\n"
+                << "  \"benchmarks\": [";
+            for (size_t i = 0; i < results.size(); i++)
+            {
+                const Result &result = results[i];
+                out << (i == 0 ? "\n" : ",\n")
+                    << "    {\"name\": \"" << result.Name << "\""
+                    << ", \"scene\": \"" << result.Scene << "\""
+                    << ", \"shapes\": " << result.Shapes
+                    << ", \"width\": " << result.Width
+                    << ", \"height\": " << result.Height
+                    << ", \"threads\": " << result.Threads
+                    << ", \"bvh_width\": " << result.BVHWidth
+                    << ", \"quantized\": " << (result.Quantized ? "true" : "false")
+                    << ", \"bytes_per_prim\": " << result.BytesPerPrimitive
+                    << ", \"rays\": " << (size_t)result.Rays
+                    << ", \"best_ms\": " << result.BestMs
+                    << ", \"ns_per_ray\": " << result.BestMs * 1e6 / result.Rays
+                    << ", \"build_ms\": " << result.BuildMs << "}";
+            }
+            out << "\n  ]\n}" << std::endl;
+        }
+
+    private:
+        struct TreeLayout
+        {
+            int Width;
+            bool Quantized;
+        };
+
+        // Every requested width, the wide ones once with float and once with quantized nodes
+        std::vector<TreeLayout> GetTreeLayouts() const
+        {
+            std::vector<TreeLayout> layouts;
+            for (int width : options.BVHWidths)
+            {
+                layouts.push_back({width, false});
+                if (width != 2)
+                    layouts.push_back({width, true});
+            }
+            return layouts;
+        }
+
+        // Powers of two up to the thread limit, then the limit itself
+        std::vector<int> GetThreadCounts() const
+        {
+            int maxThreads = options.MaxThreads > 0 ? options.MaxThreads : TileScheduler::GetMaxThreadCount();
+            std::vector<int> threadCounts;
+            for (int threads = 1; threads < maxThreads; threads *= 2)
+                threadCounts.push_back(threads);
+            threadCounts.push_back(maxThreads);
+            return threadCounts;
+        }
+
+    private:
+        const Options &options;
+        std::vector<Result> results;
+    };
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!ParseArguments(argc, argv, options))
+    {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    Suite suite(options);
+    suite.RunShapeKernels();
+    suite.RunTraceRay();
+    suite.RunPrimaryRays();
+    suite.RunFrames();
+    suite.RunLightSampling();
+    suite.RunMeshes();
+    suite.RunBuild();
+    suite.RunSceneFile();
+    suite.RunSceneJSON();
+    suite.PrintJSON(std::cout);
+    return 0;
+}
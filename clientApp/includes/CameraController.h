@@ -0,0 +1,23 @@
+#pragma once
+
+#define GL_SILENCE_DEPRECATION
+#include <glm/glm.hpp>
+#include "Camera.h"
+
+class Window;
+
+// Drives a Camera from the window's mouse and WASD/QE input
+class CameraController
+{
+public:
+	CameraController(Camera &camera, Window &window);
+
+	bool OnUpdate(float ts);
+
+	float GetRotationSpeed();
+private:
+	Camera &camera;
+	Window &newWindow;
+
+	glm::vec2 LastMousePosition{ 0.0f, 0.0f };
+};
@@ -0,0 +1,106 @@
+#pragma once
+
+#define GL_SILENCE_DEPRECATION
+#include <iostream>
+#include "../glfw/include/GLFW/glfw3.h"
+#include <OpenGL/gl3.h>
+#include <glm/glm.hpp>
+#include "imgui.h"
+#include "imgui_impl_glfw.h"
+#include "imgui_impl_opengl3.h"
+#include "Camera.h"
+#include "CameraController.h"
+#include "Window.h"
+#include "Scene.h"
+#include "Tracer.h"
+#include <vector>
+
+class Window;
+
+class Camera;
+
+// Presents the Tracer output in the Scene panel as a GL texture.
+// The tracer writes straight into a mapped pixel unpack buffer; two buffers alternate so the
+// texture upload of one frame can run while the next one is traced
+class Renderer
+{
+public:
+    using Settings = Tracer::Settings;
+    struct ImageData
+    {
+        int width;
+        int height;
+        glm::uint32 *data;
+    };
+
+private:
+    GLuint renderImage = 0;
+    GLuint pixelBuffers[2] = {0, 0};
+    int pixelBufferIndex = 0;
+    glm::uint32 textureWidth = 0, textureHeight = 0;
+    // Used only if the driver refuses to map a pixel buffer
+    std::vector<glm::uint32> stagingBuffer;
+    // int sceneWindowWidth = 1280;
+    // int sceneWindowHeight = 720;
+
+    ImageData image;
+
+    Window &window;
+
+    Scene *activeScene;
+    Camera *activeCamera;
+    CameraController *cameraController;
+
+    Tracer tracer;
+    bool showConvergenceMap = false;
+
+public:
+    Renderer(Window &window);
+    ~Renderer();
+
+    void Update(float ts);
+    void OnResize(glm::uint32 width, glm::uint32 height);
+    void Render(Scene &scene, Camera &camera);
+
+private:
+    void ResizeTexture();
+
+public:
+
+    inline float GetSceneWindowWidth()
+    {
+        return image.width;
+    }
+    inline float GetSceneWindowHeight()
+    {
+        return image.height;
+    }
+    inline GLuint GetRenderImage()
+    {
+        return renderImage;
+    }
+
+    void setSceneWindowWidth(float width)
+    {
+        image.width = width;
+    }
+    void setSceneWindowHeight(float height)
+    {
+        image.height = height;
+    }
+
+    void ResetFrameIndex() { tracer.ResetFrameIndex(); }
+    // Tints the image by tile convergence while adaptive sampling runs
+    bool &GetShowConvergenceMap() { return showConvergenceMap; }
+    const ConvergenceMap &GetConvergenceMap() const { return tracer.GetConvergenceMap(); }
+    glm::uint32 GetAdaptiveSamplesPerPixel() const { return tracer.GetAdaptiveSamplesPerPixel(); }
+    Camera &GetCamera() { return *activeCamera; }
+    Settings &GetSettings() { return tracer.GetSettings(); }
+    const BVH::BuildStats &GetBVHStats() const { return tracer.GetBVHStats(); }
+    size_t GetBVHMemorySize() const { return tracer.GetBVHMemorySize(); }
+    const TopLevelBVH::BuildStats &GetInstanceStats() const { return tracer.GetInstanceStats(); }
+    const LightTree::BuildStats &GetLightTreeStats() const { return tracer.GetLightTreeStats(); }
+    const Tracer::WavefrontStats &GetWavefrontStats() const { return tracer.GetWavefrontStats(); }
+    float GetLastRenderTime() const { return tracer.GetLastRenderTime(); }
+    int GetThreadCount() const { return tracer.GetThreadCount(); }
+};
@@ -13,6 +13,7 @@
 #include "imgui.h"
 #include <OpenGL/gl3.h>
 #include "Scene.h"
+#include "SceneWatcher.h"
 
 class Renderer;
 
@@ -49,6 +50,7 @@ private:
     std::string title;
     GLFWwindow *window;
     Renderer *renderer;
+    SceneWatcher sceneWatcher;
 
 public:
     Scene scene;
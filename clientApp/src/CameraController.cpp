@@ -0,0 +1,93 @@
+#include "CameraController.h"
+#include "Window.h"
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtx/quaternion.hpp>
+
+CameraController::CameraController(Camera &camera, Window &window)
+    : camera(camera), newWindow(window)
+{
+}
+
+bool CameraController::OnUpdate(float ts)
+{
+    glm::vec2 mousePos = newWindow.GetMousePosition();
+    glm::vec2 delta = (mousePos - LastMousePosition) * 0.002f;
+    LastMousePosition = mousePos;
+
+    if (!newWindow.IsMouseButtonDown(MouseButton::Right))
+    {
+        newWindow.SetCursorMode(CursorMode::Normal);
+        return false;
+    }
+
+    newWindow.SetCursorMode(CursorMode::Locked);
+
+    bool moved = false;
+
+    glm::vec3 position = camera.GetPosition();
+    glm::vec3 forwardDirection = camera.GetDirection();
+
+    constexpr float upX = 0.0f;
+    constexpr float upY = 1.0f;
+    constexpr float upZ = 0.0f;
+    const glm::vec3 upDirection(upX, upY, upZ);
+    glm::vec3 rightDirection = glm::cross(forwardDirection, upDirection);
+
+    float speed = 0.0003f;
+
+    // Movement
+    if (newWindow.IsKeyDown(KeyCode::W))
+    {
+        position += forwardDirection * speed * ts;
+        moved = true;
+    }
+    else if (newWindow.IsKeyDown(KeyCode::S))
+    {
+        position -= forwardDirection * speed * ts;
+        moved = true;
+    }
+    if (newWindow.IsKeyDown(KeyCode::A))
+    {
+        position -= rightDirection * speed * ts;
+        moved = true;
+    }
+    else if (newWindow.IsKeyDown(KeyCode::D))
+    {
+        position += rightDirection * speed * ts;
+        moved = true;
+    }
+    if (newWindow.IsKeyDown(KeyCode::E))
+    {
+        position -= upDirection * speed * ts;
+        moved = true;
+    }
+    else if (newWindow.IsKeyDown(KeyCode::Q))
+    {
+        position += upDirection * speed * ts;
+        moved = true;
+    }
+
+    // Rotation
+    if (delta.x != 0.0f || delta.y != 0.0f)
+    {
+        float pitchDelta = delta.y * GetRotationSpeed();
+        float yawDelta = delta.x * GetRotationSpeed();
+
+        glm::quat q = glm::normalize(glm::cross(glm::angleAxis(-pitchDelta, rightDirection),
+                                                glm::angleAxis(-yawDelta, glm::vec3(0.f, 1.0f, 0.0f))));
+        forwardDirection = glm::rotate(q, forwardDirection);
+
+        moved = true;
+    }
+
+    if (moved)
+        camera.SetView(position, forwardDirection);
+    return moved;
+}
+
+float CameraController::GetRotationSpeed()
+{
+    return 0.3f;
+}
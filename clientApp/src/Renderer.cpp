@@ -0,0 +1,117 @@
+#include "Renderer.h"
+#include "Window.h"
+#include "Scene.h"
+
+Renderer::Renderer(Window &window) : window(window)
+{
+    renderImage = 0;
+    image.width = 1280;
+    image.height = 720;
+    activeCamera = new Camera(45.0f, 0.1f, 100.0f);
+    cameraController = new CameraController(*activeCamera, window);
+    activeScene = &window.scene;
+    tracer.OnResize(image.width, image.height);
+}
+
+void Renderer::Update(float ts)
+{
+    activeCamera->OnResize(image.width, image.height);
+    if (cameraController->OnUpdate(ts))
+        ResetFrameIndex();
+    Render(*activeScene, *activeCamera);
+}
+
+Renderer::~Renderer()
+{
+    if (renderImage != 0)
+    {
+        glDeleteTextures(1, &renderImage);
+    }
+    if (pixelBuffers[0] != 0)
+    {
+        glDeleteBuffers(2, pixelBuffers);
+    }
+    delete cameraController;
+    delete activeCamera;
+}
+
+void Renderer::OnResize(glm::uint32 width, glm::uint32 height)
+{
+    if (width == image.width && height == image.height)
+        return;
+    image.width = width;
+    image.height = height;
+
+    tracer.OnResize(width, height);
+}
+
+void Renderer::ResizeTexture()
+{
+    textureWidth = image.width;
+    textureHeight = image.height;
+    GLsizeiptr size = (GLsizeiptr)textureWidth * textureHeight * sizeof(glm::uint32);
+
+    if (renderImage == 0)
+    {
+        glGenTextures(1, &renderImage);
+        glBindTexture(GL_TEXTURE_2D, renderImage);
+
+        // Configurar parámetros de la textura
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+    glBindTexture(GL_TEXTURE_2D, renderImage);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, textureWidth, textureHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+    if (pixelBuffers[0] == 0)
+        glGenBuffers(2, pixelBuffers);
+    for (GLuint pixelBuffer : pixelBuffers)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void Renderer::Render(Scene &scene, Camera &camera)
+{
+    activeScene = &scene;
+    activeCamera = &camera;
+
+    if (renderImage == 0 || textureWidth != (glm::uint32)image.width || textureHeight != (glm::uint32)image.height)
+        ResizeTexture();
+
+    GLsizeiptr size = (GLsizeiptr)textureWidth * textureHeight * sizeof(glm::uint32);
+
+    // Generar los datos de la imagen directamente en el buffer de la GPU
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffers[pixelBufferIndex]);
+    glm::uint32 *data = (glm::uint32 *)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    bool mapped = data != nullptr;
+    if (!mapped)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        stagingBuffer.resize(textureWidth * textureHeight);
+        data = stagingBuffer.data();
+    }
+
+    tracer.Render(scene, camera, data);
+    if (showConvergenceMap && tracer.GetConvergenceMap().IsActive())
+        tracer.GetConvergenceMap().Draw(data);
+
+    // Subir los datos a la textura, desde el PBO la copia es asíncrona
+    glBindTexture(GL_TEXTURE_2D, renderImage);
+    if (mapped)
+    {
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, textureWidth, textureHeight, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    else
+    {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, textureWidth, textureHeight, GL_RGBA, GL_UNSIGNED_BYTE, data);
+    }
+
+    pixelBufferIndex = 1 - pixelBufferIndex;
+}
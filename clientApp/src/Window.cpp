@@ -1,5 +1,9 @@
 #include "Window.h"
 #include "Renderer.h"
+#include "ObjLoader.h"
+#include "SceneFile.h"
+#include "SceneJSON.h"
+#include "ScenePresets.h"
 #include <glm/gtc/type_ptr.hpp>
 
 float Window::GetTime()
@@ -72,7 +76,48 @@ void Window::mainLoop()
         ImGui::NewFrame();
         ImGui::DockSpaceOverViewport();
 
+        // Edits saved to an open JSON scene show up without reopening it
+        if (sceneWatcher.Poll(scene, renderer->GetCamera(), renderer->GetSettings()))
+            renderer->ResetFrameIndex();
+
         ImGui::Begin("Adjustments");
+        ImGui::PushID("SceneFile");
+        static char scenePath[256] = "";
+        ImGui::InputText("Scene", scenePath, sizeof(scenePath));
+        ImGui::Button("Open");
+        if (ImGui::IsItemClicked())
+        {
+            // A .json path is opened and watched, a .bscn path or any scene name the headless renderer takes just loaded
+            std::string name = scenePath;
+            bool json = name.size() > 5 && name.compare(name.size() - 5, 5, ".json") == 0;
+            if (name.size() > 5 && name.compare(name.size() - 5, 5, ".bscn") == 0)
+                name = "bscn:" + name;
+            Scene loaded;
+            bool ok = json ? sceneWatcher.Open(name, loaded, renderer->GetCamera(), renderer->GetSettings())
+                           : ScenePresets::Load(name, loaded, renderer->GetCamera());
+            if (ok)
+            {
+                if (!json)
+                    sceneWatcher.Close();
+                scene = std::move(loaded);
+                renderer->ResetFrameIndex();
+            }
+        }
+        ImGui::SameLine();
+        ImGui::Button("Save");
+        if (ImGui::IsItemClicked())
+        {
+            std::string path = scenePath;
+            if (path.size() > 5 && path.compare(path.size() - 5, 5, ".json") == 0)
+                SceneJSON::Save(path, scene, renderer->GetCamera());
+            else
+                SceneFile::Save(path, scene, renderer->GetCamera(), true, scene.Builder);
+        }
+        if (sceneWatcher.IsWatching())
+            ImGui::Text("Watching %s: %s", sceneWatcher.GetPath().c_str(), sceneWatcher.GetStatus().c_str());
+        ImGui::PopID();
+        ImGui::Separator();
+
         ImGui::Text("Shapes");
         for (size_t i = 0; i < scene.Shapes.size(); i++)
         {
@@ -80,14 +125,23 @@ void Window::mainLoop()
                 ImGui::Text("Sphere");
             else if (scene.Shapes[i]->GetType() == ShapeType::Plane)
                 ImGui::Text("Plane");
+            else if (scene.Shapes[i]->GetType() == ShapeType::Mesh)
+                ImGui::Text("Mesh (%u triangles)", ((Mesh &)*scene.Shapes[i]).GetTriangleCount());
             ImGui::PushID(i);
 
             Shape &shape = *scene.Shapes[i];
-            ImGui::DragFloat3("Position", glm::value_ptr(shape.Position), 0.1f);
+            if (ImGui::DragFloat3("Position", glm::value_ptr(shape.Position), 0.1f))
+                scene.EditedShapes.push_back(i);
             if (shape.GetType() == ShapeType::Sphere)
-                ImGui::DragFloat("Radius", &((Sphere &)shape).Radius, 0.1f);
+            {
+                if (ImGui::DragFloat("Radius", &((Sphere &)shape).Radius, 0.1f))
+                    scene.EditedShapes.push_back(i);
+            }
             else if (shape.GetType() == ShapeType::Plane)
-                ImGui::DragFloat3("Normal", glm::value_ptr(((Plane &)shape).Normal), 0.1f);
+            {
+                if (ImGui::DragFloat3("Normal", glm::value_ptr(((Plane &)shape).Normal), 0.1f))
+                    scene.EditedShapes.push_back(i);
+            }
             ImGui::DragInt("Material", &shape.MaterialIndex, 1.0f, 0, (int)scene.Materials.size() - 1);
 
             ImGui::Separator();
@@ -101,6 +155,7 @@ void Window::mainLoop()
             // Sphere sphere = Sphere();
             std::shared_ptr<Shape> sphere = std::make_shared<Sphere>();
             scene.Shapes.push_back(sphere);
+            scene.GeometryDirty = true;
         }
         ImGui::PopID();
         ImGui::PushID("Plane");
@@ -110,10 +165,48 @@ void Window::mainLoop()
             // Plane plane = Plane();
             std::shared_ptr<Shape> plane = std::make_shared<Plane>();
             scene.Shapes.push_back(plane);
+            scene.GeometryDirty = true;
+        }
+        ImGui::PopID();
+        ImGui::PushID("Mesh");
+        static char objPath[256] = "";
+        ImGui::InputText("OBJ", objPath, sizeof(objPath));
+        ImGui::Button("Add Mesh");
+        if (ImGui::IsItemClicked())
+        {
+            std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>();
+            if (ObjLoader::Load(objPath, *mesh))
+            {
+                scene.Shapes.push_back(mesh);
+                scene.GeometryDirty = true;
+            }
         }
         ImGui::PopID();
         ImGui::Separator();
 
+        if (!scene.Instances.empty())
+        {
+            ImGui::Text("Instances");
+            ImGui::PushID("Instances");
+            for (size_t i = 0; i < scene.Instances.size(); i++)
+            {
+                ImGui::PushID(i);
+
+                Instance &instance = scene.Instances[i];
+                glm::vec3 translation = instance.ObjectToWorld.GetTranslation();
+                if (ImGui::DragFloat3("Position", glm::value_ptr(translation), 0.1f))
+                {
+                    instance.ObjectToWorld.SetTranslation(translation);
+                    scene.InstancesDirty = true;
+                }
+                ImGui::DragInt("Material", &instance.MaterialIndex, 1.0f, -1, (int)scene.Materials.size() - 1);
+
+                ImGui::PopID();
+            }
+            ImGui::PopID();
+            ImGui::Separator();
+        }
+
         ImGui::Text("Lights");
         ImGui::PushID("Lights");
         ImGui::Text("Ambient Light");
@@ -126,9 +219,12 @@ void Window::mainLoop()
             ImGui::PushID(i);
 
             Light &light = scene.Lights[i];
-            ImGui::DragFloat3("Position", glm::value_ptr(light.Position), 0.1f);
-            ImGui::ColorEdit3("Color", glm::value_ptr(light.Color));
-            ImGui::DragFloat("Intensity", &light.Intensity, 0.1f);
+            if (ImGui::DragFloat3("Position", glm::value_ptr(light.Position), 0.1f))
+                scene.LightsDirty = true;
+            if (ImGui::ColorEdit3("Color", glm::value_ptr(light.Color)))
+                scene.LightsDirty = true;
+            if (ImGui::DragFloat("Intensity", &light.Intensity, 0.1f))
+                scene.LightsDirty = true;
 
             ImGui::Separator();
 
@@ -141,7 +237,9 @@ void Window::mainLoop()
             Light light;
             light.Position = {0.0f, 0.0f, 0.0f};
             light.Color = {1.0f, 1.0f, 1.0f};
+            light.Intensity = 1.0f;
             scene.Lights.push_back(light);
+            scene.LightsDirty = true;
         }
         ImGui::PopID();
         ImGui::Text("Materials");
@@ -165,10 +263,95 @@ void Window::mainLoop()
         ImGui::Begin("Settings");
         {
             ImGui::Checkbox("Accumulate", &renderer->GetSettings().Accumulate);
+            // Path depth changes what every sample estimates, samples taken before do not mix with the new ones
+            if (ImGui::SliderInt("Bounces", &renderer->GetSettings().Bounces, 1, 32))
+                renderer->ResetFrameIndex();
+            if (ImGui::Checkbox("Russian Roulette", &renderer->GetSettings().RussianRoulette))
+                renderer->ResetFrameIndex();
+            if (renderer->GetSettings().RussianRoulette &&
+                ImGui::SliderInt("Roulette Depth", &renderer->GetSettings().RouletteDepth, 0, 16, "after %d bounces"))
+                renderer->ResetFrameIndex();
+            {
+                // Both estimate the same image, samples keep accumulating across a switch
+                const char *lightNames[] = {"All", "Resampled", "Tree"};
+                int current = (int)renderer->GetSettings().LightSelection;
+                if (ImGui::Combo("Light Sampling", &current, lightNames, IM_ARRAYSIZE(lightNames)))
+                    renderer->GetSettings().LightSelection = (LightSampling)current;
+                if (renderer->GetSettings().LightSelection != LightSampling::All)
+                    ImGui::SliderInt("Light Samples", &renderer->GetSettings().LightSamples, 1, 16, "%d per hit");
+                if (renderer->GetSettings().LightSelection == LightSampling::Tree)
+                {
+                    const LightTree::BuildStats &lightTreeStats = renderer->GetLightTreeStats();
+                    ImGui::Text("Light tree: %u nodes, depth %u, build %.3f ms", lightTreeStats.NodeCount, lightTreeStats.MaxDepth,
+                                lightTreeStats.BuildTimeMs);
+                    if (lightTreeStats.RefitCount > 0)
+                        ImGui::Text("Light tree refit %.3f ms (%u since build)", lightTreeStats.RefitTimeMs, lightTreeStats.RefitCount);
+                }
+            }
+            ImGui::SliderInt("Threads", &renderer->GetSettings().ThreadCount, 0, TileScheduler::GetMaxThreadCount(), "%d (0 = all)");
+            ImGui::SliderInt("Tile Size", &renderer->GetSettings().TileSize, 8, 128);
+            ImGui::Checkbox("BVH", &renderer->GetSettings().UseBVH);
+            {
+                const int bvhWidths[] = {2, 4, 8};
+                const char *bvhNames[] = {"Binary", "BVH4", "BVH8"};
+                int &bvhWidth = renderer->GetSettings().BVHWidth;
+                int current = bvhWidth == 4 ? 1 : (bvhWidth == 8 ? 2 : 0);
+                if (ImGui::Combo("BVH Width", &current, bvhNames, IM_ARRAYSIZE(bvhNames)))
+                    bvhWidth = bvhWidths[current];
+                if (bvhWidth != 2)
+                    ImGui::Checkbox("Quantized Nodes", &renderer->GetSettings().QuantizedBVH);
+            }
+            {
+                const char *builderNames[] = {"SAH", "LBVH"};
+                int current = scene.Builder == BVHBuilder::LBVH ? 1 : 0;
+                if (ImGui::Combo("BVH Builder", &current, builderNames, IM_ARRAYSIZE(builderNames)))
+                    scene.Builder = current == 1 ? BVHBuilder::LBVH : BVHBuilder::SAH;
+            }
+            {
+                const int packetSizes[] = {0, 4, 8};
+                const char *packetNames[] = {"Off", "4x4", "8x8"};
+                int &packetSize = renderer->GetSettings().PacketSize;
+                int current = packetSize == 4 ? 1 : (packetSize == 8 ? 2 : 0);
+                if (ImGui::Combo("Primary Packets", &current, packetNames, IM_ARRAYSIZE(packetNames)))
+                    packetSize = packetSizes[current];
+            }
+            ImGui::Checkbox("Wavefront", &renderer->GetSettings().Wavefront);
+            if (renderer->GetSettings().Wavefront)
+                ImGui::Checkbox("Sort by Material", &renderer->GetSettings().SortByMaterial);
+            if (renderer->GetSettings().Accumulate && !renderer->GetSettings().Wavefront)
+            {
+                ImGui::Checkbox("Adaptive Sampling", &renderer->GetSettings().AdaptiveSampling);
+                if (renderer->GetSettings().AdaptiveSampling)
+                {
+                    ImGui::SliderFloat("Noise Threshold", &renderer->GetSettings().NoiseThreshold, 0.001f, 0.1f, "%.3f", ImGuiSliderFlags_Logarithmic);
+                    ImGui::Checkbox("Convergence Map", &renderer->GetShowConvergenceMap());
+                    ImGui::Text("%.1f%% converged, %u spp/frame in the rest", renderer->GetConvergenceMap().GetConvergedFraction() * 100.0f,
+                                renderer->GetAdaptiveSamplesPerPixel());
+                }
+            }
 
             if (ImGui::Button("Reset"))
                 renderer->ResetFrameIndex();
             ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / io.Framerate, io.Framerate);
+            ImGui::Text("Trace %.3f ms on %d threads (%s)", renderer->GetLastRenderTime(), renderer->GetThreadCount(), SphereKernel::GetInstructionSet());
+            const BVH::BuildStats &bvhStats = renderer->GetBVHStats();
+            ImGui::Text("BVH: %u nodes, %u leaves, depth %u", bvhStats.NodeCount, bvhStats.LeafCount, bvhStats.MaxDepth);
+            ImGui::Text("BVH nodes in use: %.1f KiB, %.1f bytes/primitive", renderer->GetBVHMemorySize() / 1024.0f,
+                        bvhStats.BoundedCount > 0 ? (float)renderer->GetBVHMemorySize() / bvhStats.BoundedCount : 0.0f);
+            ImGui::Text("BVH build %.3f ms, %s (SAH cost %.2f)", bvhStats.BuildTimeMs,
+                        bvhStats.Builder == BVHBuilder::LBVH ? "LBVH" : "SAH", bvhStats.SAHCost);
+            if (bvhStats.RefitCount > 0)
+                ImGui::Text("BVH refit %.3f ms (%u since build, SAH +%.0f%%)", bvhStats.RefitTimeMs, bvhStats.RefitCount,
+                            bvhStats.BuildSAHCost > 0.0f ? 100.0f * (bvhStats.SAHCost / bvhStats.BuildSAHCost - 1.0f) : 0.0f);
+            const TopLevelBVH::BuildStats &instanceStats = renderer->GetInstanceStats();
+            if (instanceStats.InstanceCount > 0)
+                ImGui::Text("Instances: %u of %u geometries, %zu shapes placed, top level %.3f ms", instanceStats.InstanceCount,
+                            instanceStats.GeometryCount, instanceStats.InstancedShapeCount, instanceStats.BuildTimeMs);
+            if (renderer->GetSettings().Wavefront)
+            {
+                const Tracer::WavefrontStats &wavefrontStats = renderer->GetWavefrontStats();
+                ImGui::Text("Wavefront: %u waves, %u paths, %u shadow rays", wavefrontStats.WaveCount, wavefrontStats.PathsTraced, wavefrontStats.ShadowRays);
+            }
             ImGui::Text("Mouse Position: (%.1f, %.1f)", io.MousePos.x, io.MousePos.y);
         }
         ImGui::End();
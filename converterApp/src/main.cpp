@@ -0,0 +1,99 @@
+#include "SceneFile.h"
+#include "SceneJSON.h"
+#include "ScenePresets.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+namespace
+{
+    struct Options
+    {
+        std::string SceneName;
+        std::string Output;
+        bool IncludeBVH = true;
+        BVHBuilder Builder = BVHBuilder::SAH;
+    };
+
+    void PrintUsage(const char *executable)
+    {
+        std::cerr << "Usage: " << executable << " --scene <name> --output <file.bscn|file.json> [options]\n"
+                  << "  --scene <name>      scene to convert, any scene the headless renderer takes\n"
+                  << "  --output <file>     binary scene file to write, or a JSON scene when it ends in .json\n"
+                  << "  --bvh <n>           1 stores the BVHs so loading builds nothing (1)\n"
+                  << "  --builder <name>    BVH builder, sah or lbvh (sah)\n"
+                  << "Scenes:";
+        for (const std::string &name : ScenePresets::GetNames())
+            std::cerr << " " << name;
+        std::cerr << std::endl;
+    }
+
+    bool ParseArguments(int argc, char **argv, Options &options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            if (arg == "--help" || arg == "-h" || i + 1 >= argc)
+                return false;
+
+            const char *value = argv[++i];
+            if (arg == "--scene")
+                options.SceneName = value;
+            else if (arg == "--output")
+                options.Output = value;
+            else if (arg == "--bvh")
+                options.IncludeBVH = std::atoi(value) != 0;
+            else if (arg == "--builder")
+            {
+                std::string builder = value;
+                if (builder != "sah" && builder != "lbvh")
+                {
+                    std::cerr << "Unknown builder " << builder << std::endl;
+                    return false;
+                }
+                options.Builder = builder == "lbvh" ? BVHBuilder::LBVH : BVHBuilder::SAH;
+            }
+            else
+            {
+                std::cerr << "Unknown option " << arg << std::endl;
+                return false;
+            }
+        }
+        return !options.SceneName.empty() && !options.Output.empty();
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!ParseArguments(argc, argv, options))
+    {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    Scene scene;
+    Camera camera(45.0f, 0.1f, 100.0f);
+    auto loadStart = std::chrono::high_resolution_clock::now();
+    if (!ScenePresets::Load(options.SceneName, scene, camera))
+    {
+        std::cerr << "Unknown scene " << options.SceneName << std::endl;
+        return 1;
+    }
+    auto loadEnd = std::chrono::high_resolution_clock::now();
+
+    bool json = options.Output.size() > 5 && options.Output.compare(options.Output.size() - 5, 5, ".json") == 0;
+    if (json ? !SceneJSON::Save(options.Output, scene, camera)
+             : !SceneFile::Save(options.Output, scene, camera, options.IncludeBVH, options.Builder))
+        return 1;
+    auto saveEnd = std::chrono::high_resolution_clock::now();
+
+    std::cout << "scene       " << options.SceneName << " (" << scene.Shapes.size() << " shapes, " << scene.Instances.size()
+              << " instances, " << scene.Lights.size() << " lights)\n"
+              << "load        " << std::chrono::duration<float, std::milli>(loadEnd - loadStart).count() << " ms\n"
+              << "save        " << std::chrono::duration<float, std::milli>(saveEnd - loadEnd).count() << " ms"
+              << (options.IncludeBVH && !json ? (options.Builder == BVHBuilder::LBVH ? ", lbvh included" : ", sah bvh included") : "") << "\n"
+              << "output      " << options.Output << std::endl;
+    return 0;
+}
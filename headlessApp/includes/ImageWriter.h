@@ -0,0 +1,17 @@
+#pragma once
+
+#define GL_SILENCE_DEPRECATION
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+// Writes linear colors stored bottom row first, as the Tracer produces them.
+// The format is picked from the extension: .ppm, .png (8-bit, clamped) or .pfm (32-bit float)
+namespace ImageWriter
+{
+    bool Write(const std::string &path, glm::uint32 width, glm::uint32 height, const std::vector<glm::vec4> &pixels);
+
+    bool WritePPM(const std::string &path, glm::uint32 width, glm::uint32 height, const std::vector<glm::vec4> &pixels);
+    bool WritePNG(const std::string &path, glm::uint32 width, glm::uint32 height, const std::vector<glm::vec4> &pixels);
+    bool WritePFM(const std::string &path, glm::uint32 width, glm::uint32 height, const std::vector<glm::vec4> &pixels);
+}
@@ -0,0 +1,186 @@
+#include "ImageWriter.h"
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+
+namespace
+{
+    bool EndsWith(const std::string &value, const std::string &suffix)
+    {
+        return value.size() >= suffix.size() && value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    uint8_t ToByte(float value)
+    {
+        return (uint8_t)(glm::clamp(value, 0.0f, 1.0f) * 255.0f);
+    }
+
+    // Top row first, three bytes per pixel
+    std::vector<uint8_t> ToRGB8(glm::uint32 width, glm::uint32 height, const std::vector<glm::vec4> &pixels)
+    {
+        std::vector<uint8_t> rgb(width * height * 3);
+        size_t offset = 0;
+        for (glm::uint32 y = height; y-- > 0;)
+        {
+            for (glm::uint32 x = 0; x < width; x++)
+            {
+                const glm::vec4 &color = pixels[x + y * width];
+                rgb[offset++] = ToByte(color.r);
+                rgb[offset++] = ToByte(color.g);
+                rgb[offset++] = ToByte(color.b);
+            }
+        }
+        return rgb;
+    }
+
+    uint32_t Crc32(const uint8_t *data, size_t size, uint32_t crc = 0)
+    {
+        static uint32_t table[256];
+        static bool tableReady = false;
+        if (!tableReady)
+        {
+            for (uint32_t i = 0; i < 256; i++)
+            {
+                uint32_t c = i;
+                for (int k = 0; k < 8; k++)
+                    c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+                table[i] = c;
+            }
+            tableReady = true;
+        }
+
+        crc = ~crc;
+        for (size_t i = 0; i < size; i++)
+            crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+        return ~crc;
+    }
+
+    void PutUint32(std::vector<uint8_t> &out, uint32_t value)
+    {
+        out.push_back((uint8_t)(value >> 24));
+        out.push_back((uint8_t)(value >> 16));
+        out.push_back((uint8_t)(value >> 8));
+        out.push_back((uint8_t)value);
+    }
+
+    void WriteChunk(std::ofstream &file, const char *type, const std::vector<uint8_t> &data)
+    {
+        std::vector<uint8_t> chunk;
+        PutUint32(chunk, (uint32_t)data.size());
+        chunk.insert(chunk.end(), type, type + 4);
+        chunk.insert(chunk.end(), data.begin(), data.end());
+        PutUint32(chunk, Crc32(chunk.data() + 4, chunk.size() - 4));
+        file.write((const char *)chunk.data(), chunk.size());
+    }
+}
+
+namespace ImageWriter
+{
+    bool Write(const std::string &path, glm::uint32 width, glm::uint32 height, const std::vector<glm::vec4> &pixels)
+    {
+        if (EndsWith(path, ".ppm"))
+            return WritePPM(path, width, height, pixels);
+        if (EndsWith(path, ".png"))
+            return WritePNG(path, width, height, pixels);
+        if (EndsWith(path, ".pfm"))
+            return WritePFM(path, width, height, pixels);
+        return false;
+    }
+
+    bool WritePPM(const std::string &path, glm::uint32 width, glm::uint32 height, const std::vector<glm::vec4> &pixels)
+    {
+        std::ofstream file(path, std::ios::binary);
+        if (!file)
+            return false;
+
+        std::vector<uint8_t> rgb = ToRGB8(width, height, pixels);
+        file << "P6\n"
+             << width << " " << height << "\n255\n";
+        file.write((const char *)rgb.data(), rgb.size());
+        return (bool)file;
+    }
+
+    // Uncompressed PNG: the zlib stream is made of stored deflate blocks, no compression library needed
+    bool WritePNG(const std::string &path, glm::uint32 width, glm::uint32 height, const std::vector<glm::vec4> &pixels)
+    {
+        std::ofstream file(path, std::ios::binary);
+        if (!file)
+            return false;
+
+        std::vector<uint8_t> rgb = ToRGB8(width, height, pixels);
+
+        // Every scanline starts with filter type 0
+        std::vector<uint8_t> raw;
+        raw.reserve(rgb.size() + height);
+        size_t stride = width * 3;
+        for (glm::uint32 y = 0; y < height; y++)
+        {
+            raw.push_back(0);
+            raw.insert(raw.end(), rgb.begin() + y * stride, rgb.begin() + (y + 1) * stride);
+        }
+
+        std::vector<uint8_t> zlib = {0x78, 0x01};
+        uint32_t adlerA = 1, adlerB = 0;
+        for (uint8_t byte : raw)
+        {
+            adlerA = (adlerA + byte) % 65521;
+            adlerB = (adlerB + adlerA) % 65521;
+        }
+        size_t offset = 0;
+        do
+        {
+            size_t blockSize = std::min<size_t>(raw.size() - offset, 65535);
+            bool last = offset + blockSize == raw.size();
+            zlib.push_back(last ? 1 : 0);
+            zlib.push_back((uint8_t)blockSize);
+            zlib.push_back((uint8_t)(blockSize >> 8));
+            zlib.push_back((uint8_t)~blockSize);
+            zlib.push_back((uint8_t)(~blockSize >> 8));
+            zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + blockSize);
+            offset += blockSize;
+        } while (offset < raw.size());
+        PutUint32(zlib, (adlerB << 16) | adlerA);
+
+        std::vector<uint8_t> header;
+        PutUint32(header, width);
+        PutUint32(header, height);
+        header.push_back(8); // Bit depth
+        header.push_back(2); // Truecolor
+        header.push_back(0);
+        header.push_back(0);
+        header.push_back(0);
+
+        const uint8_t signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+        file.write((const char *)signature, sizeof(signature));
+        WriteChunk(file, "IHDR", header);
+        WriteChunk(file, "IDAT", zlib);
+        WriteChunk(file, "IEND", {});
+        return (bool)file;
+    }
+
+    // PFM stores rows bottom to top, which is already the Tracer's order
+    bool WritePFM(const std::string &path, glm::uint32 width, glm::uint32 height, const std::vector<glm::vec4> &pixels)
+    {
+        std::ofstream file(path, std::ios::binary);
+        if (!file)
+            return false;
+
+        // A negative scale marks little-endian data
+        const uint16_t endianTest = 1;
+        bool littleEndian = *(const uint8_t *)&endianTest == 1;
+        file << "PF\n"
+             << width << " " << height << "\n"
+             << (littleEndian ? "-1.0" : "1.0") << "\n";
+
+        std::vector<float> rgb;
+        rgb.reserve(width * height * 3);
+        for (const glm::vec4 &color : pixels)
+        {
+            rgb.push_back(color.r);
+            rgb.push_back(color.g);
+            rgb.push_back(color.b);
+        }
+        file.write((const char *)rgb.data(), rgb.size() * sizeof(float));
+        return (bool)file;
+    }
+}
@@ -0,0 +1,276 @@
+#include "ImageWriter.h"
+#include "ScenePresets.h"
+#include "Tracer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <string>
+
+namespace
+{
+    struct Options
+    {
+        glm::uint32 Width = 1280;
+        glm::uint32 Height = 720;
+        int SamplesPerPixel = 16;
+        int Bounces = 5;
+        int RouletteDepth = 2; // Negative turns Russian roulette off
+        int ThreadCount = 0;
+        int TileSize = 32;
+        int PacketSize = 8;
+        int BVHWidth = 2;
+        bool QuantizedBVH = false;
+        BVHBuilder Builder = BVHBuilder::SAH;
+        bool Wavefront = false;
+        bool SortByMaterial = false;
+        float NoiseThreshold = 0.0f; // 0 samples every pixel every frame
+        LightSampling LightSelection = LightSampling::All;
+        int LightSamples = 1;
+        std::string SceneName = "default";
+        std::string Output = "render.png";
+    };
+
+    void PrintUsage(const char *executable)
+    {
+        std::cerr << "Usage: " << executable << " [options]\n"
+                  << "  --width <px>        image width (1280)\n"
+                  << "  --height <px>       image height (720)\n"
+                  << "  --spp <n>           samples per pixel (16)\n"
+                  << "  --bounces <n>       maximum path depth (5)\n"
+                  << "  --roulette <n>      bounces before Russian roulette may end a path, -1 = off (2)\n"
+                  << "  --threads <n>       worker threads, 0 = all (0)\n"
+                  << "  --tile <px>         tile size (32)\n"
+                  << "  --packet <n>        primary ray packet size, 4 or 8, 0 = single rays (8)\n"
+                  << "  --bvh-width <n>     BVH branching factor, 2, 4 or 8 (2)\n"
+                  << "  --quantized <n>     1 stores BVH4/BVH8 child boxes as 8-bit steps (0)\n"
+                  << "  --builder <name>    BVH builder, sah or lbvh (sah)\n"
+                  << "  --integrator <name> path or wavefront (path)\n"
+                  << "  --sort-materials <n> 1 sorts wavefront paths by material before shading (0)\n"
+                  << "  --adaptive <t>      stop sampling tiles whose relative noise falls below t, 0 = off (0);\n"
+                  << "                      --spp then counts frames, noisy tiles get up to 8 samples each\n"
+                  << "  --lights <name>     all shades every light, resampled or tree pick --light-samples per hit (all)\n"
+                  << "  --light-samples <n> shadow rays per hit when lights are sampled (1)\n"
+                  << "  --scene <name>      scene to render (default)\n"
+                  << "  --output <file>     .png, .ppm or .pfm (render.png)\n"
+                  << "Scenes:";
+        for (const std::string &name : ScenePresets::GetNames())
+            std::cerr << " " << name;
+        std::cerr << std::endl;
+    }
+
+    bool ParseArguments(int argc, char **argv, Options &options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            if (arg == "--help" || arg == "-h" || i + 1 >= argc)
+                return false;
+
+            const char *value = argv[++i];
+            if (arg == "--width")
+                options.Width = (glm::uint32)std::max(1, std::atoi(value));
+            else if (arg == "--height")
+                options.Height = (glm::uint32)std::max(1, std::atoi(value));
+            else if (arg == "--spp")
+                options.SamplesPerPixel = std::max(1, std::atoi(value));
+            else if (arg == "--bounces")
+                options.Bounces = std::max(1, std::atoi(value));
+            else if (arg == "--roulette")
+                options.RouletteDepth = std::atoi(value);
+            else if (arg == "--threads")
+                options.ThreadCount = std::max(0, std::atoi(value));
+            else if (arg == "--tile")
+                options.TileSize = std::max(1, std::atoi(value));
+            else if (arg == "--packet")
+                options.PacketSize = std::max(0, std::atoi(value));
+            else if (arg == "--bvh-width")
+                options.BVHWidth = std::atoi(value);
+            else if (arg == "--quantized")
+                options.QuantizedBVH = std::atoi(value) != 0;
+            else if (arg == "--builder")
+            {
+                std::string builder = value;
+                if (builder != "sah" && builder != "lbvh")
+                {
+                    std::cerr << "Unknown builder " << builder << std::endl;
+                    return false;
+                }
+                options.Builder = builder == "lbvh" ? BVHBuilder::LBVH : BVHBuilder::SAH;
+            }
+            else if (arg == "--integrator")
+            {
+                std::string integrator = value;
+                if (integrator != "path" && integrator != "wavefront")
+                {
+                    std::cerr << "Unknown integrator " << integrator << std::endl;
+                    return false;
+                }
+                options.Wavefront = integrator == "wavefront";
+            }
+            else if (arg == "--sort-materials")
+                options.SortByMaterial = std::atoi(value) != 0;
+            else if (arg == "--adaptive")
+                options.NoiseThreshold = std::max(0.0f, (float)std::atof(value));
+            else if (arg == "--lights")
+            {
+                std::string lights = value;
+                if (lights == "all")
+                    options.LightSelection = LightSampling::All;
+                else if (lights == "resampled")
+                    options.LightSelection = LightSampling::Resampled;
+                else if (lights == "tree")
+                    options.LightSelection = LightSampling::Tree;
+                else
+                {
+                    std::cerr << "Unknown light sampling " << lights << std::endl;
+                    return false;
+                }
+            }
+            else if (arg == "--light-samples")
+                options.LightSamples = std::max(1, std::atoi(value));
+            else if (arg == "--scene")
+                options.SceneName = value;
+            else if (arg == "--output")
+                options.Output = value;
+            else
+            {
+                std::cerr << "Unknown option " << arg << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!ParseArguments(argc, argv, options))
+    {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    Scene scene;
+    Camera camera(45.0f, 0.1f, 100.0f);
+
+    auto loadStart = std::chrono::high_resolution_clock::now();
+    if (!ScenePresets::Load(options.SceneName, scene, camera))
+    {
+        std::cerr << "Unknown scene " << options.SceneName << std::endl;
+        PrintUsage(argv[0]);
+        return 1;
+    }
+    auto loadEnd = std::chrono::high_resolution_clock::now();
+    scene.Builder = options.Builder;
+    camera.OnResize(options.Width, options.Height);
+
+    Tracer tracer;
+    Tracer::Settings &settings = tracer.GetSettings();
+    settings.Accumulate = true;
+    settings.Bounces = options.Bounces;
+    settings.RussianRoulette = options.RouletteDepth >= 0;
+    settings.RouletteDepth = std::max(options.RouletteDepth, 0);
+    settings.ThreadCount = options.ThreadCount;
+    settings.TileSize = options.TileSize;
+    settings.PacketSize = options.PacketSize;
+    settings.BVHWidth = options.BVHWidth;
+    settings.QuantizedBVH = options.QuantizedBVH;
+    settings.Wavefront = options.Wavefront;
+    settings.SortByMaterial = options.SortByMaterial;
+    settings.AdaptiveSampling = options.NoiseThreshold > 0.0f;
+    settings.NoiseThreshold = options.NoiseThreshold;
+    settings.LightSelection = options.LightSelection;
+    settings.LightSamples = options.LightSamples;
+    tracer.OnResize(options.Width, options.Height);
+
+    std::vector<glm::uint32> rgba(options.Width * options.Height);
+
+    float fastestSampleMs = std::numeric_limits<float>::max();
+    auto renderStart = std::chrono::high_resolution_clock::now();
+    for (int sample = 0; sample < options.SamplesPerPixel; sample++)
+    {
+        tracer.Render(scene, camera, rgba.data());
+        fastestSampleMs = std::min(fastestSampleMs, tracer.GetLastRenderTime());
+    }
+    auto renderEnd = std::chrono::high_resolution_clock::now();
+
+    std::vector<glm::vec4> pixels(options.Width * options.Height);
+    const glm::vec4 *accumulation = tracer.GetAccumulationData();
+    double samplesTraced = 0.0;
+    for (size_t i = 0; i < pixels.size(); i++)
+    {
+        pixels[i] = accumulation[i] / accumulation[i].a;
+        samplesTraced += accumulation[i].a;
+    }
+
+    if (!ImageWriter::Write(options.Output, options.Width, options.Height, pixels))
+    {
+        std::cerr << "Failed to write " << options.Output << std::endl;
+        return 1;
+    }
+
+    float loadMs = std::chrono::duration<float, std::milli>(loadEnd - loadStart).count();
+    float renderMs = std::chrono::duration<float, std::milli>(renderEnd - renderStart).count();
+    const BVH::BuildStats &bvhStats = tracer.GetBVHStats();
+    const TopLevelBVH::BuildStats &instanceStats = tracer.GetInstanceStats();
+
+    std::cout << "scene       " << options.SceneName << " (" << scene.Shapes.size() << " shapes, " << scene.Lights.size() << " lights)\n"
+              << "image       " << options.Width << "x" << options.Height << ", " << options.SamplesPerPixel << " spp, "
+              << options.Bounces << " bounces"
+              << (settings.RussianRoulette ? " (roulette after " + std::to_string(settings.RouletteDepth) + ")" : "") << ", "
+              << (settings.LightSelection == LightSampling::All         ? std::string("all lights")
+                  : settings.LightSelection == LightSampling::Resampled ? std::to_string(settings.LightSamples) + " resampled lights"
+                                                                        : std::to_string(settings.LightSamples) + " lights from the tree")
+              << ", "
+              << tracer.GetThreadCount() << " threads\n"
+              << "scene load  " << loadMs << " ms\n"
+              << "bvh build   " << bvhStats.BuildTimeMs << " ms, " << bvhStats.NodeCount << " nodes ("
+              << (bvhStats.Builder == BVHBuilder::LBVH ? "lbvh" : "sah") << ")\n"
+              << "bvh nodes   " << tracer.GetBVHMemorySize() / 1024 << " KiB, "
+              << (bvhStats.BoundedCount > 0 ? (double)tracer.GetBVHMemorySize() / bvhStats.BoundedCount : 0.0) << " bytes/primitive\n";
+    if (instanceStats.InstanceCount > 0)
+    {
+        std::cout << "instances   " << instanceStats.InstanceCount << " of " << instanceStats.GeometryCount << " geometries, "
+                  << instanceStats.InstancedShapeCount << " shapes placed from " << instanceStats.GeometryShapeCount << " stored, "
+                  << instanceStats.MemorySize / 1024 << " KiB, geometry build " << instanceStats.GeometryBuildTimeMs
+                  << " ms, top level " << instanceStats.BuildTimeMs << " ms\n";
+    }
+    if (settings.LightSelection == LightSampling::Tree)
+    {
+        const LightTree::BuildStats &lightTreeStats = tracer.GetLightTreeStats();
+        std::cout << "light tree  " << lightTreeStats.NodeCount << " nodes, depth " << lightTreeStats.MaxDepth << ", build "
+                  << lightTreeStats.BuildTimeMs << " ms\n";
+    }
+    size_t meshCount = 0, triangleCount = 0, meshMemory = 0;
+    float meshBuildMs = 0.0f;
+    for (const std::shared_ptr<Shape> &shape : scene.Shapes)
+    {
+        if (shape->GetType() != ShapeType::Mesh)
+            continue;
+        const Mesh &mesh = static_cast<const Mesh &>(*shape);
+        meshCount++;
+        triangleCount += mesh.GetTriangleCount();
+        meshMemory += mesh.GetMemorySize();
+        meshBuildMs += mesh.GetBVHStats().BuildTimeMs;
+    }
+    if (meshCount > 0)
+    {
+        std::cout << "meshes      " << meshCount << ", " << triangleCount << " triangles, " << meshMemory / 1024
+                  << " KiB, bvh build " << meshBuildMs << " ms\n";
+    }
+    if (tracer.GetConvergenceMap().IsActive())
+    {
+        std::cout << "adaptive    " << tracer.GetConvergenceMap().GetConvergedFraction() * 100.0f << "% converged, "
+                  << samplesTraced / pixels.size() << " spp average, " << tracer.GetAdaptiveSamplesPerPixel()
+                  << " spp/frame in the rest\n";
+    }
+    std::cout << "render      " << renderMs << " ms total, " << renderMs / options.SamplesPerPixel << " ms/sample avg, "
+              << fastestSampleMs << " ms/sample best\n"
+              << "throughput  " << samplesTraced / (renderMs * 1000.0) << " M samples/s\n"
+              << "output      " << options.Output << std::endl;
+    return 0;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#define GL_SILENCE_DEPRECATION
+#include <glm/glm.hpp>
+#include <limits>
+#include "Ray.h"
+
+struct AABB
+{
+    glm::vec3 Min{std::numeric_limits<float>::max()};
+    glm::vec3 Max{-std::numeric_limits<float>::max()};
+
+    void Grow(const glm::vec3 &point)
+    {
+        Min = glm::min(Min, point);
+        Max = glm::max(Max, point);
+    }
+
+    void Grow(const AABB &other)
+    {
+        Min = glm::min(Min, other.Min);
+        Max = glm::max(Max, other.Max);
+    }
+
+    bool IsEmpty() const { return Min.x > Max.x; }
+
+    glm::vec3 GetCenter() const { return (Min + Max) * 0.5f; }
+
+    float GetSurfaceArea() const
+    {
+        if (IsEmpty())
+            return 0.0f;
+        glm::vec3 e = Max - Min;
+        return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+    }
+
+    // Slab test, returns the entry distance or max() when the box is missed or farther than tMax
+    float Intersect(const Ray &ray, const glm::vec3 &invDirection, float tMax) const
+    {
+        glm::vec3 t0 = (Min - ray.Origin) * invDirection;
+        glm::vec3 t1 = (Max - ray.Origin) * invDirection;
+        glm::vec3 tNear = glm::min(t0, t1);
+        glm::vec3 tFar = glm::max(t0, t1);
+        float tEnter = glm::max(glm::max(tNear.x, tNear.y), tNear.z);
+        float tExit = glm::min(glm::min(tFar.x, tFar.y), tFar.z);
+        if (tExit >= tEnter && tExit > 0.0f && tEnter < tMax)
+            return tEnter;
+        return std::numeric_limits<float>::max();
+    }
+};
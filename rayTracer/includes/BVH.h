@@ -0,0 +1,131 @@
+#pragma once
+
+#define GL_SILENCE_DEPRECATION
+#include <glm/glm.hpp>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include "AABB.h"
+#include "Ray.h"
+#include "RayPacket.h"
+#include "CompiledScene.h"
+
+class BVH
+{
+public:
+    struct Node
+    {
+        AABB Bounds;
+        glm::uint32 LeftFirst = 0; // Left child for inner nodes (right is LeftFirst + 1), first primitive for leaves
+        glm::uint32 Count = 0;     // Primitives in the leaf, 0 for inner nodes
+
+        bool IsLeaf() const { return Count > 0; }
+    };
+    struct BuildStats
+    {
+        BVHBuilder Builder = BVHBuilder::SAH;
+        float BuildTimeMs = 0.0f;
+        glm::uint32 NodeCount = 0;
+        glm::uint32 LeafCount = 0;
+        glm::uint32 MaxDepth = 0;
+        glm::uint32 BoundedCount = 0;
+        glm::uint32 UnboundedCount = 0;
+        float SAHCost = 0.0f;      // Kept current by Refit
+        float BuildSAHCost = 0.0f; // Cost right after the last Build
+        float RefitTimeMs = 0.0f;  // Last Refit
+        glm::uint32 RefitCount = 0; // Refits since the last Build
+    };
+
+    static constexpr glm::uint32 MaxLeafSize = 8;
+    // Nodes above this many primitives are split by binned SAH, smaller ones by an exact sweep over sorted centroids
+    static constexpr glm::uint32 MaxSweepCount = 32;
+    static constexpr glm::uint32 BinCount = 32;
+    // Largest range the LBVH keeps in one leaf instead of emitting its subtree
+    static constexpr glm::uint32 MaxLinearLeafSize = 4;
+    static constexpr glm::uint32 MaxDepth = 60;
+    // Refit reports the tree as worn out once its SAH cost is this much above the freshly built one
+    static constexpr float MaxSAHGrowth = 0.25f;
+
+    BVH() = default;
+    ~BVH() = default;
+
+    // Builds over the spheres of scene and reorders them so every leaf covers a contiguous range,
+    // scene must outlive the tree. Binning, sorting and subtrees run as TBB tasks on the calling thread's arena.
+    void Build(CompiledScene &scene, BVHBuilder builder = BVHBuilder::SAH);
+    // Builds over arbitrary boxes without a scene to trace; leaves cover ranges of GetPrimitiveIndices(),
+    // which maps them back to indices into primitiveBounds. Queries on such a tree find nothing, callers walk GetNodes()
+    void Build(const std::vector<AABB> &primitiveBounds, BVHBuilder builder = BVHBuilder::SAH);
+    // Adopt nodes saved from an earlier Build (SceneFile) instead of building: the scene's spheres, or the
+    // primitiveCount plain boxes, must already be in the saved leaf order. Returns false and leaves the tree empty
+    // when a node points outside the node or primitive arrays.
+    bool Restore(CompiledScene &scene, const Node *savedNodes, size_t nodeCount, BVHBuilder builder);
+    bool Restore(glm::uint32 primitiveCount, const Node *savedNodes, size_t nodeCount, BVHBuilder builder);
+    // Recomputes the bounds of the leaves holding the given sphere slots and of their ancestors, bottom-up,
+    // for spheres that moved or changed radius in place. Returns false when the SAH cost has grown past
+    // MaxSAHGrowth since the last Build, the tree still works but a rebuild would trace faster.
+    bool Refit(const std::vector<glm::uint32> &sphereSlots);
+
+    // Closest hit over the tree and the unbounded side list, objectIndex is -1 on a miss
+    bool Intersect(const Ray &ray, float &hitDistance, int &objectIndex) const;
+    // Same search, but only hits closer than the incoming hitDistance count and replace hitDistance and objectIndex.
+    // Returns whether one did
+    bool IntersectCloser(const Ray &ray, float &hitDistance, int &objectIndex) const;
+    // Any hit inside (tMin, tMax), stops at the first blocker
+    bool AnyHit(const Ray &ray, float tMin, float tMax) const;
+    // Closest hit for every lane of a packet; a node is visited once for the whole packet
+    // when any of its rays enters the node's bounds
+    void IntersectPacket(RayPacket &packet) const;
+
+    const BuildStats &GetStats() const { return stats; }
+    const std::vector<Node> &GetNodes() const { return nodes; }
+    const CompiledScene *GetScene() const { return scene; }
+    const std::vector<glm::uint32> &GetPrimitiveIndices() const { return primitiveIndices; }
+    // Nodes whose bounds changed in the last Refit
+    const std::vector<glm::uint32> &GetRefittedNodes() const { return refittedNodes; }
+
+private:
+    struct PrimitiveRef
+    {
+        AABB Bounds;
+        glm::vec3 Centroid;
+        glm::uint32 PrimitiveIndex;
+    };
+
+    struct Bins;
+    struct BinnedSplit;
+
+    template <typename GetBounds>
+    void BuildTree(glm::uint32 primitiveCount, const GetBounds &getBounds, BVHBuilder builder);
+    void FinishBuild(glm::uint32 primitiveCount, BVHBuilder builder, std::chrono::high_resolution_clock::time_point start);
+    bool RestoreNodes(glm::uint32 primitiveCount, const Node *savedNodes, size_t nodeCount);
+
+    void UpdateNodeBounds(glm::uint32 nodeIndex);
+    void Subdivide(glm::uint32 nodeIndex, const AABB &centroidBounds, glm::uint32 depth, std::atomic<glm::uint32> &nodeCount);
+    float FindBestSplit(const Node &node, int &bestAxis, glm::uint32 &bestSplit);
+    void BinReferences(const Node &node, const AABB &centroidBounds, Bins &bins) const;
+    bool FindBinnedSplit(const Node &node, const AABB &centroidBounds, BinnedSplit &split) const;
+    // Returns false without touching the tree when 30-bit codes collide too often to give a usable hierarchy
+    template <typename Key>
+    bool BuildLinear(const AABB &centroidBounds, std::atomic<glm::uint32> &nodeCount);
+    AABB EmitLinear(glm::uint32 nodeIndex, const std::vector<glm::uint32> &splits, glm::uint32 internalIndex,
+                    glm::uint32 first, glm::uint32 last, glm::uint32 depth, std::atomic<glm::uint32> &nodeCount);
+    float ComputeSAHCost() const;
+    float GetNodeCost(const Node &node) const;
+    void SetNodeBounds(glm::uint32 nodeIndex, const AABB &bounds);
+
+private:
+    std::vector<Node> nodes;
+    std::vector<PrimitiveRef> references;
+    std::vector<glm::uint32> primitiveIndices; // Leaf order -> primitive, only for trees built over plain boxes
+
+    // Refit bookkeeping, rebuilt by Build
+    std::vector<glm::uint32> parents;
+    std::vector<glm::uint32> sphereLeaves; // Sphere slot -> leaf node
+    std::vector<unsigned char> refitted;
+    std::vector<glm::uint32> refittedNodes;
+    double weightedAreaSum = 0.0; // Sum of node area times node cost, the SAH cost before dividing by the root area
+
+    const CompiledScene *scene = nullptr;
+
+    BuildStats stats;
+};
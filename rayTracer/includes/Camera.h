@@ -2,18 +2,16 @@
 
 #define GL_SILENCE_DEPRECATION
 #include <glm/glm.hpp>
-#include "Window.h"
 #include <vector>
 
-class Window;
-
 class Camera
 {
 public:
-	Camera(float verticalFOV, float nearClip, float farClip, Window &window);
+	Camera(float verticalFOV, float nearClip, float farClip);
 
-	bool OnUpdate(float ts);
 	void OnResize(glm::uint32 width, glm::uint32 height);
+	// Moves the camera and recomputes the view and the cached ray directions once
+	void SetView(const glm::vec3 &position, const glm::vec3 &direction);
 
 	const glm::mat4& GetProjection() const { return Projection; }
 	const glm::mat4& GetInverseProjection() const { return InverseProjection; }
@@ -25,14 +23,11 @@ public:
 
 	const std::vector<glm::vec3>& GetRayDirections() const { return RayDirections; }
 
-	float GetRotationSpeed();
 private:
 	void RecalculateProjection();
 	void RecalculateView();
 	void RecalculateRayDirections();
 private:
-	Window &newWindow;
-
 	glm::mat4 Projection{ 1.0f };
 	glm::mat4 View{ 1.0f };
 	glm::mat4 InverseProjection{ 1.0f };
@@ -48,7 +43,5 @@ private:
 	// Cached ray directions
 	std::vector<glm::vec3> RayDirections;
 
-	glm::vec2 LastMousePosition{ 0.0f, 0.0f };
-
 	glm::uint32 ViewportWidth = 0, ViewportHeight = 0;
 };
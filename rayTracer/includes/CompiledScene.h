@@ -0,0 +1,93 @@
+#pragma once
+
+#define GL_SILENCE_DEPRECATION
+#include <glm/glm.hpp>
+#include <vector>
+#include "AABB.h"
+#include "Ray.h"
+#include "RayPacket.h"
+#include "Scene.h"
+#include "SphereKernel.h"
+
+class Mesh;
+
+// Flat copy of Scene::Shapes split by type into structure-of-arrays storage.
+// Intersection loops run over these arrays with no pointer chasing or virtual calls;
+// ShapeIndex maps every primitive back to Scene::Shapes for shading.
+// Meshes bring their own triangle BVH and are only referenced, Tracer tests them next to the sphere BVH.
+class CompiledScene
+{
+public:
+    // The float arrays carry SphereKernel::Padding extra entries past Size()
+    struct SphereData
+    {
+        std::vector<float> CenterX, CenterY, CenterZ;
+        std::vector<float> RadiusSquared;
+        std::vector<int> ShapeIndex;
+
+        size_t Size() const { return ShapeIndex.size(); }
+    };
+    struct PlaneData
+    {
+        std::vector<float> NormalX, NormalY, NormalZ;
+        std::vector<float> Offset; // dot(Normal, Position)
+        std::vector<int> ShapeIndex;
+
+        size_t Size() const { return ShapeIndex.size(); }
+    };
+    struct MeshData
+    {
+        std::vector<const Mesh *> Meshes; // Owned by the compiled shape list, which must outlive this
+        std::vector<AABB> Bounds;         // Object space, Meshes[i]->Position is added per query
+        std::vector<int> ShapeIndex;
+
+        size_t Size() const { return ShapeIndex.size(); }
+    };
+
+    void Compile(const Scene &scene);
+    // Same over any list of shapes, ShapeIndex then indexes that list (a Geometry's shapes)
+    void Compile(const std::vector<std::shared_ptr<Shape>> &shapes);
+
+    // Reorders the spheres so that sphere i becomes the old sphere order[i]
+    void PermuteSpheres(const std::vector<glm::uint32> &order);
+    // Copies the current position, radius or normal of Scene::Shapes[shapeIndex] into its slot,
+    // returns the sphere slot so the BVH can refit it, or -1 for planes and meshes
+    int UpdateShape(const Scene &scene, size_t shapeIndex);
+
+    AABB GetSphereBounds(glm::uint32 index) const;
+
+    // Closest hit among spheres [first, first + count), hitIndex receives the Scene::Shapes index
+    void IntersectSpheres(const Ray &ray, glm::uint32 first, glm::uint32 count, float &hitDistance, int &hitIndex) const;
+    bool AnyHitSpheres(const Ray &ray, glm::uint32 first, glm::uint32 count, float tMin, float tMax) const;
+
+    // Brute force over every plane and sphere, hitIndex is -1 on a miss
+    bool Intersect(const Ray &ray, float &hitDistance, int &hitIndex) const;
+    bool AnyHit(const Ray &ray, float tMin, float tMax) const;
+
+    void IntersectPlanes(const Ray &ray, float &hitDistance, int &hitIndex) const;
+    bool AnyHitPlanes(const Ray &ray, float tMin, float tMax) const;
+
+    // Closest triangle hit among the meshes closer than hitDistance, hitIndex receives the shape index and triangle the
+    // triangle within its mesh. Returns whether one was found
+    bool IntersectMeshes(const Ray &ray, float &hitDistance, int &hitIndex, int &triangle) const;
+    bool AnyHitMeshes(const Ray &ray, float tMin, float tMax) const;
+
+    // Packet versions, every lane keeps its own closest hit in packet.HitDistance and packet.ObjectIndex
+    void IntersectSpheres(RayPacket &packet, glm::uint32 first, glm::uint32 count) const;
+    void IntersectPlanes(RayPacket &packet) const;
+
+    const SphereData &GetSpheres() const { return spheres; }
+    const PlaneData &GetPlanes() const { return planes; }
+    const MeshData &GetMeshes() const { return meshes; }
+
+private:
+    SphereKernel::Spheres GetSphereKernelData() const;
+    void PadSpheres();
+
+private:
+    SphereData spheres;
+    PlaneData planes;
+    MeshData meshes;
+
+    std::vector<glm::uint32> shapeSlots; // Scene::Shapes index -> slot in spheres, planes or meshes
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#define GL_SILENCE_DEPRECATION
+#include <glm/glm.hpp>
+#include <vector>
+#include "TileScheduler.h"
+
+// Noise estimate for adaptive sampling. Next to the colour sums in the tracer's accumulation buffer every pixel keeps
+// the sum of its squared sample luminance, which gives the variance of its mean. A tile's error is the average
+// relative standard error of its pixels; once that falls below the threshold the tile stops taking samples until
+// the accumulation is reset.
+class ConvergenceMap
+{
+public:
+    // Fewer samples than this underestimate the variance of rare bright paths, no tile converges before
+    static constexpr glm::uint32 MinSamples = 16;
+
+    // Clears every sum and tile for a new accumulation
+    void Reset(glm::uint32 width, glm::uint32 height);
+    // Lays the tiles out like TileScheduler::Configure; a new tile size or threshold resets the tiles, the per-pixel
+    // sums are kept
+    void Configure(glm::uint32 tileSize, float threshold);
+    // Stops tracking, IsActive is false until the next Reset
+    void Clear();
+    bool IsActive() const { return !squaredSums.empty(); }
+
+    void AddSample(glm::uint32 pixel, const glm::vec3 &color)
+    {
+        float luminance = GetLuminance(color);
+        squaredSums[pixel] += luminance * luminance;
+    }
+
+    // Re-estimates the error of tile from the accumulation buffer (sample count in alpha); call from the thread that
+    // rendered it
+    void UpdateTile(const TileScheduler::Tile &tile, const glm::vec4 *accumulation);
+    bool IsConverged(const TileScheduler::Tile &tile) const { return converged[GetTileIndex(tile)] != 0; }
+
+    // Samples per pixel per frame for the tiles that have not converged: the samples the converged tiles no longer
+    // take are shared out between them, up to maxSamples
+    glm::uint32 GetSamplesPerPixel(glm::uint32 maxSamples) const;
+    // Share of the image's pixels in converged tiles, 0 to 1
+    float GetConvergedFraction() const;
+
+    // Tints data (RGBA8, the image the tracer wrote) by tile: green where converged, red to yellow by the error
+    // relative to the threshold elsewhere
+    void Draw(glm::uint32 *data) const;
+
+    static float GetLuminance(const glm::vec3 &color) { return glm::dot(color, glm::vec3(0.2126f, 0.7152f, 0.0722f)); }
+
+private:
+    size_t GetTileIndex(const TileScheduler::Tile &tile) const { return (tile.MinY / tileSize) * tilesX + tile.MinX / tileSize; }
+
+private:
+    glm::uint32 width = 0, height = 0;
+    glm::uint32 tileSize = 0;
+    glm::uint32 tilesX = 0, tilesY = 0;
+    float threshold = 0.0f;
+
+    std::vector<float> squaredSums;
+    std::vector<float> errors;             // Per tile, relative standard error of its pixel means
+    std::vector<unsigned char> converged; // Per tile, written only by the thread rendering it
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#define GL_SILENCE_DEPRECATION
+#include <glm/glm.hpp>
+#include <vector>
+#include "Scene.h"
+#include "Random.h"
+
+// How the tracer chooses the lights it shades at every hit
+enum class LightSampling
+{
+    All,       // One shadow ray to every light, cost grows with the light count
+    Resampled, // Settings::LightSamples lights picked by LightSampler, cost independent of the light count
+    Tree,      // Settings::LightSamples lights picked by walking a LightTree, cost logarithmic in the light count
+};
+
+// Picks lights for scenes with too many to shade them all. An alias table over light power proposes candidates in
+// constant time; resampled importance sampling then keeps one of CandidateCount candidates in proportion to its
+// unshadowed contribution at the shading point (power times the cosine over the squared distance, plus the material's
+// specular share, which does not fall off with distance). Scenes with no more lights than that are sampled exactly.
+class LightSampler
+{
+public:
+    static constexpr glm::uint32 CandidateCount = 8;
+
+    // Rebuilds the alias table, lights keep their indices
+    void Build(const std::vector<Light> &lights);
+
+    // Index of the chosen light and the weight its contribution is multiplied by (one over its probability), -1 when
+    // no light can contribute at position
+    int Sample(const std::vector<Light> &lights, const glm::vec3 &position, const glm::vec3 &normal, float specular,
+               Sampler &sampler, float &weight) const;
+
+    // Estimated unshadowed contribution of light at position, the target the samples follow
+    static float GetContribution(const Light &light, const glm::vec3 &position, const glm::vec3 &normal, float specular);
+    static float GetLuminance(const Light &light);
+    // Intensity times luminance
+    static float GetPower(const Light &light);
+
+private:
+    // Light drawn in proportion to the table's weights from u in [0, 1), with its probability
+    glm::uint32 SampleAlias(float u, float &probability) const;
+
+private:
+    std::vector<float> thresholds; // Chance of keeping the slot's own light rather than its alias
+    std::vector<glm::uint32> aliases;
+    std::vector<float> probabilities;
+};
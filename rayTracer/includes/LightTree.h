@@ -0,0 +1,69 @@
+#pragma once
+
+#define GL_SILENCE_DEPRECATION
+#include <glm/glm.hpp>
+#include <vector>
+#include "AABB.h"
+#include "Scene.h"
+#include "Random.h"
+
+// Binary hierarchy over Scene::Lights for picking one light per hit in logarithmic time. Every node bounds its lights'
+// positions, total power and the cone of directions they emit into; sampling walks down from the root and at every
+// node takes either child with probability proportional to a conservative estimate of what its lights contribute at
+// the shading point, so lights that are far, behind the surface or facing away are rarely picked.
+class LightTree
+{
+public:
+    // Emitted directions lie within acos(CosTheta) of Axis, -1 covers the whole sphere (point lights)
+    struct Cone
+    {
+        glm::vec3 Axis{0.0f, 0.0f, 1.0f};
+        float CosTheta = -1.0f;
+    };
+    struct Node
+    {
+        AABB Bounds;
+        Cone Orientation;
+        float Power = 0.0f;     // Sum of Intensity times the luminance of Color
+        float Luminance = 0.0f; // Sum of the luminance of Color, scales the specular share that does not fall off
+        glm::uint32 Child = 0;  // Second child for inner nodes (the first follows the node), light index for leaves
+        bool Leaf = false;
+    };
+    struct BuildStats
+    {
+        float BuildTimeMs = 0.0f;
+        glm::uint32 NodeCount = 0;
+        glm::uint32 MaxDepth = 0;
+        float Cost = 0.0f;      // Kept current by Refit
+        float BuildCost = 0.0f; // Cost right after the last Build
+        float RefitTimeMs = 0.0f;
+        glm::uint32 RefitCount = 0; // Refits since the last Build
+    };
+
+    static constexpr glm::uint32 BinCount = 12;
+    // Refit reports the tree as worn out once its cost is this much above the freshly built one
+    static constexpr float MaxCostGrowth = 0.25f;
+
+    void Build(const std::vector<Light> &lights);
+    // Recomputes every node bottom-up for lights moved, recoloured or dimmed in place. Returns false when the light
+    // count changed or the cost has grown past MaxCostGrowth since the last Build, and the tree needs a Build
+    bool Refit(const std::vector<Light> &lights);
+
+    // Index of the chosen light and the weight its contribution is multiplied by (one over its probability), -1 when
+    // no light can contribute at position. Draws a single number from sampler however deep the tree is
+    int Sample(const glm::vec3 &position, const glm::vec3 &normal, float specular, Sampler &sampler, float &weight) const;
+
+    const BuildStats &GetStats() const { return stats; }
+    const std::vector<Node> &GetNodes() const { return nodes; }
+
+private:
+    // leaves holds one leaf per light, reordered as the range is split
+    glm::uint32 BuildRecursive(std::vector<Node> &leaves, size_t begin, size_t end, glm::uint32 depth);
+    // Estimate of what the node's lights add at position, exact for a leaf and 0 only when none of them can add anything
+    static float GetImportance(const Node &node, const glm::vec3 &position, const glm::vec3 &normal, float specular);
+    float GetCost() const;
+
+private:
+    std::vector<Node> nodes;
+    BuildStats stats;
+};
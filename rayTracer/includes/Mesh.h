@@ -0,0 +1,44 @@
+#pragma once
+
+#define GL_SILENCE_DEPRECATION
+#include "Shape.h"
+#include "BVH.h"
+#include <glm/glm.hpp>
+#include <vector>
+
+// Indexed triangle mesh with its own BVH over the triangles. Vertices are in object space and move with Position,
+// so dragging a mesh never touches its tree. Fill Vertices and Indices (three per triangle), then call Build.
+class Mesh : public Shape
+{
+public:
+    Mesh();
+    ~Mesh();
+
+    bool Intersect(const glm::vec3& RayOrigin, const glm::vec3& RayDirection, float& t) const override;
+    // Normal of the triangle closest to Point (relative to Position), a linear search; tracing keeps the hit triangle
+    // and uses GetTriangleNormal instead
+    glm::vec3 GetNormal(const glm::vec3& Point) const override;
+    float GetClosestHit(const Ray& ray) const override;
+    bool AnyHit(const Ray& ray, float tMin, float tMax) const override;
+    AABB GetBounds() const override;
+
+    // Builds the triangle BVH and reorders the triangles in Indices to its leaf order
+    void Build(BVHBuilder builder = BVHBuilder::SAH);
+    // Adopts a tree saved from GetBVHNodes after Build instead, Indices must still be in that tree's leaf order
+    bool Restore(const BVH::Node *nodes, size_t nodeCount, BVHBuilder builder = BVHBuilder::SAH);
+
+    // Closest triangle hit closer than hitDistance; on one, hitDistance and triangle are replaced and true is returned
+    bool IntersectCloser(const Ray& ray, float& hitDistance, int& triangle) const;
+    // Unit geometric normal on the side the triangle winds counter-clockwise, Tracer flips it towards the ray
+    glm::vec3 GetTriangleNormal(int triangle) const;
+
+    glm::uint32 GetTriangleCount() const { return (glm::uint32)(Indices.size() / 3); }
+    const BVH::BuildStats& GetBVHStats() const { return tree.GetStats(); }
+    const std::vector<BVH::Node>& GetBVHNodes() const { return tree.GetNodes(); }
+    size_t GetMemorySize() const;
+
+    std::vector<glm::vec3> Vertices;
+    std::vector<glm::uint32> Indices;
+private:
+    BVH tree;
+};
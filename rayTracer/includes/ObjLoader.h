@@ -0,0 +1,14 @@
+#pragma once
+
+#define GL_SILENCE_DEPRECATION
+#include <string>
+#include "Mesh.h"
+
+// Wavefront OBJ reader for triangle meshes. Only positions (v) and faces (f) are read, polygons are split into fans
+// and every other statement is skipped. The file is streamed in large blocks and parsed in place, so loading does
+// not allocate per vertex or per line.
+namespace ObjLoader
+{
+    // Replaces mesh's Vertices and Indices and builds its BVH, returns false and reports to std::cerr on a bad file
+    bool Load(const std::string &path, Mesh &mesh, BVHBuilder builder = BVHBuilder::SAH);
+}
@@ -12,6 +12,9 @@ public:
     bool Intersect(const glm::vec3& RayOrigin, const glm::vec3& RayDirection, float& t) const override;
     glm::vec3 GetNormal(const glm::vec3& Point) const override;
     float GetClosestHit(const Ray& ray) const override;
+    bool AnyHit(const Ray& ray, float tMin, float tMax) const override;
+    bool IsBounded() const override { return false; }
+    AABB GetBounds() const override;
 
     glm::vec3 Normal{0.0f, -1.0f, 0.0f};
 private:
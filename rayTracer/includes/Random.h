@@ -0,0 +1,58 @@
+#pragma once
+
+#define GL_SILENCE_DEPRECATION
+#include <glm/glm.hpp>
+
+namespace Random
+{
+    // PCG-RXS-M-XS hash (Jarzynski & Olano, "Hash Functions for GPU Rendering")
+    inline glm::uint32 PCGHash(glm::uint32 input)
+    {
+        glm::uint32 state = input * 747796405u + 2891336453u;
+        glm::uint32 word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+        return (word >> 22u) ^ word;
+    }
+
+    // Top 24 bits mapped to [0, 1)
+    inline float ToFloat(glm::uint32 bits)
+    {
+        return (float)(bits >> 8) * (1.0f / 16777216.0f);
+    }
+}
+
+// Stateless sampler: every value is a pure function of (pixel, frame, bounce, dimension),
+// so a pixel gets the same sequence whatever thread or tile order renders it
+class Sampler
+{
+public:
+    Sampler() = default;
+    Sampler(glm::uint32 pixel, glm::uint32 frameIndex)
+        : pathSeed(Random::PCGHash(Random::PCGHash(pixel) + frameIndex))
+    {
+        SetBounce(0);
+    }
+
+    void SetBounce(glm::uint32 bounce)
+    {
+        bounceSeed = Random::PCGHash(pathSeed + bounce);
+        dimension = 0;
+    }
+
+    float Float()
+    {
+        return Random::ToFloat(Random::PCGHash(bounceSeed + dimension++));
+    }
+
+    glm::vec3 Vec3(float min, float max)
+    {
+        float x = Float() * (max - min) + min;
+        float y = Float() * (max - min) + min;
+        float z = Float() * (max - min) + min;
+        return glm::vec3(x, y, z);
+    }
+
+private:
+    glm::uint32 pathSeed = 0;
+    glm::uint32 bounceSeed = 0;
+    glm::uint32 dimension = 0;
+};
@@ -0,0 +1,107 @@
+#pragma once
+
+#define GL_SILENCE_DEPRECATION
+#include <glm/glm.hpp>
+#include <limits>
+#include <vector>
+#include "AABB.h"
+#include "SIMD.h"
+
+// Primary rays of one square pixel block. They all start at the camera, so the origin is shared
+// and the per-ray data is stored as structure of arrays, one SIMD::Width group of lanes at a time.
+struct RayPacket
+{
+    static constexpr glm::uint32 MaxBlockSize = 8;
+    static constexpr glm::uint32 MaxSize = MaxBlockSize * MaxBlockSize;
+
+    glm::vec3 Origin{0.0f};
+    glm::uint32 Size = 0; // Always a multiple of SIMD::Width
+
+    alignas(32) float DirectionX[MaxSize];
+    alignas(32) float DirectionY[MaxSize];
+    alignas(32) float DirectionZ[MaxSize];
+    alignas(32) float InvDirectionX[MaxSize];
+    alignas(32) float InvDirectionY[MaxSize];
+    alignas(32) float InvDirectionZ[MaxSize];
+    alignas(32) float LengthSquared[MaxSize];       // dot(Direction, Direction)
+    alignas(32) float NegInvLengthSquared[MaxSize]; // -1 / dot(Direction, Direction)
+
+    // Results, ObjectIndex is -1 on a miss; InstanceIndex and PrimitiveIndex are -1 unless an instance or a mesh was hit
+    // (Tracer::HitPayload)
+    alignas(32) float HitDistance[MaxSize];
+    int ObjectIndex[MaxSize];
+    int InstanceIndex[MaxSize];
+    int PrimitiveIndex[MaxSize];
+
+    // Loads the blockSize x blockSize pixels starting at (x, y) from the camera ray directions and resets the hits.
+    // Lane (i, j) holds pixel (x + i, y + j); pixels at or past (maxX, maxY) repeat the last valid row or column.
+    void Generate(const glm::vec3 &origin, const std::vector<glm::vec3> &directions, glm::uint32 imageWidth,
+                  glm::uint32 x, glm::uint32 y, glm::uint32 blockSize, glm::uint32 maxX, glm::uint32 maxY)
+    {
+        Origin = origin;
+        Size = blockSize * blockSize;
+
+        for (glm::uint32 j = 0; j < blockSize; j++)
+        {
+            glm::uint32 pixelY = glm::min(y + j, maxY - 1);
+            for (glm::uint32 i = 0; i < blockSize; i++)
+            {
+                glm::uint32 pixelX = glm::min(x + i, maxX - 1);
+                const glm::vec3 &direction = directions[pixelX + pixelY * imageWidth];
+
+                glm::uint32 lane = i + j * blockSize;
+                DirectionX[lane] = direction.x;
+                DirectionY[lane] = direction.y;
+                DirectionZ[lane] = direction.z;
+                InvDirectionX[lane] = 1.0f / direction.x;
+                InvDirectionY[lane] = 1.0f / direction.y;
+                InvDirectionZ[lane] = 1.0f / direction.z;
+                float lengthSquared = glm::dot(direction, direction);
+                LengthSquared[lane] = lengthSquared;
+                NegInvLengthSquared[lane] = -1.0f / lengthSquared;
+                HitDistance[lane] = std::numeric_limits<float>::max();
+                ObjectIndex[lane] = -1;
+                InstanceIndex[lane] = -1;
+                PrimitiveIndex[lane] = -1;
+            }
+        }
+    }
+
+    // True when any lane enters bounds closer than its current hit
+    bool HitsBounds(const AABB &bounds) const
+    {
+        // With a shared origin the slab offsets (Min - Origin) are the same for every lane
+        SIMD::Float minX = SIMD::Broadcast(bounds.Min.x - Origin.x);
+        SIMD::Float minY = SIMD::Broadcast(bounds.Min.y - Origin.y);
+        SIMD::Float minZ = SIMD::Broadcast(bounds.Min.z - Origin.z);
+        SIMD::Float maxX = SIMD::Broadcast(bounds.Max.x - Origin.x);
+        SIMD::Float maxY = SIMD::Broadcast(bounds.Max.y - Origin.y);
+        SIMD::Float maxZ = SIMD::Broadcast(bounds.Max.z - Origin.z);
+        SIMD::Float zero = SIMD::Broadcast(0.0f);
+
+        for (glm::uint32 group = 0; group < Size; group += SIMD::Width)
+        {
+            SIMD::Float invX = SIMD::Load(InvDirectionX + group);
+            SIMD::Float invY = SIMD::Load(InvDirectionY + group);
+            SIMD::Float invZ = SIMD::Load(InvDirectionZ + group);
+
+            SIMD::Float t0X = minX * invX, t1X = maxX * invX;
+            SIMD::Float t0Y = minY * invY, t1Y = maxY * invY;
+            SIMD::Float t0Z = minZ * invZ, t1Z = maxZ * invZ;
+
+            SIMD::Float tEnter = SIMD::Max(SIMD::Max(SIMD::Min(t0X, t1X), SIMD::Min(t0Y, t1Y)), SIMD::Min(t0Z, t1Z));
+            SIMD::Float tExit = SIMD::Min(SIMD::Min(SIMD::Max(t0X, t1X), SIMD::Max(t0Y, t1Y)), SIMD::Max(t0Z, t1Z));
+
+            // Same acceptance as AABB::Intersect, against each lane's current closest hit
+            SIMD::Mask hit = SIMD::LessEqual(tEnter, tExit) & SIMD::Greater(tExit, zero) & SIMD::Less(tEnter, SIMD::Load(HitDistance + group));
+            if (SIMD::Any(hit))
+                return true;
+        }
+        return false;
+    }
+
+    glm::vec3 GetDirection(glm::uint32 lane) const
+    {
+        return glm::vec3(DirectionX[lane], DirectionY[lane], DirectionZ[lane]);
+    }
+};
@@ -0,0 +1,146 @@
+#pragma once
+
+#define GL_SILENCE_DEPRECATION
+#include <glm/glm.hpp>
+#include <cmath>
+#include <cstring>
+
+// Build with -DBRIAR_SCALAR to force the portable kernels on x86
+#if defined(__AVX2__) && defined(__FMA__) && !defined(BRIAR_SCALAR)
+#define BRIAR_AVX2 1
+#include <immintrin.h>
+#elif (defined(__SSE2__) || defined(_M_X64)) && !defined(BRIAR_SCALAR)
+#define BRIAR_SSE 1
+#include <emmintrin.h>
+#endif
+
+// Thin wrappers over the native float vector, so lane-parallel code (ray packets) is written once
+// and runs 8 wide with AVX2, 4 wide with SSE2 and 1 wide elsewhere.
+// Load and Store expect addresses aligned to Alignment, LoadUnaligned and LoadBytes take any address.
+namespace SIMD
+{
+#if defined(BRIAR_AVX2)
+
+    constexpr glm::uint32 Width = 8;
+
+    struct Float { __m256 Value; };
+    struct Mask { __m256 Value; };
+
+    inline Float Broadcast(float value) { return {_mm256_set1_ps(value)}; }
+    inline Float Load(const float *data) { return {_mm256_load_ps(data)}; }
+    inline Float LoadUnaligned(const float *data) { return {_mm256_loadu_ps(data)}; }
+    // Width bytes from any address, each widened to a float 0..255
+    inline Float LoadBytes(const glm::uint8 *data) { return {_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)data)))}; }
+    inline void Store(float *data, Float value) { _mm256_store_ps(data, value.Value); }
+
+    inline Float operator+(Float a, Float b) { return {_mm256_add_ps(a.Value, b.Value)}; }
+    inline Float operator-(Float a, Float b) { return {_mm256_sub_ps(a.Value, b.Value)}; }
+    inline Float operator*(Float a, Float b) { return {_mm256_mul_ps(a.Value, b.Value)}; }
+    inline Float operator/(Float a, Float b) { return {_mm256_div_ps(a.Value, b.Value)}; }
+    // a * b + c and a * b - c, fused where the hardware has FMA
+    inline Float MultiplyAdd(Float a, Float b, Float c) { return {_mm256_fmadd_ps(a.Value, b.Value, c.Value)}; }
+    inline Float MultiplySub(Float a, Float b, Float c) { return {_mm256_fmsub_ps(a.Value, b.Value, c.Value)}; }
+    inline Float Min(Float a, Float b) { return {_mm256_min_ps(a.Value, b.Value)}; }
+    inline Float Max(Float a, Float b) { return {_mm256_max_ps(a.Value, b.Value)}; }
+    inline Float Sqrt(Float a) { return {_mm256_sqrt_ps(a.Value)}; }
+
+    // Ordered compares, NaN lanes are false
+    inline Mask Less(Float a, Float b) { return {_mm256_cmp_ps(a.Value, b.Value, _CMP_LT_OQ)}; }
+    inline Mask LessEqual(Float a, Float b) { return {_mm256_cmp_ps(a.Value, b.Value, _CMP_LE_OQ)}; }
+    inline Mask Greater(Float a, Float b) { return {_mm256_cmp_ps(a.Value, b.Value, _CMP_GT_OQ)}; }
+    inline Mask operator&(Mask a, Mask b) { return {_mm256_and_ps(a.Value, b.Value)}; }
+    inline Mask operator|(Mask a, Mask b) { return {_mm256_or_ps(a.Value, b.Value)}; }
+
+    // a where mask is set, b elsewhere
+    inline Float Select(Mask mask, Float a, Float b) { return {_mm256_blendv_ps(b.Value, a.Value, mask.Value)}; }
+    // One bit per lane, lane 0 in bit 0
+    inline int Bits(Mask mask) { return _mm256_movemask_ps(mask.Value); }
+
+#elif defined(BRIAR_SSE)
+
+    constexpr glm::uint32 Width = 4;
+
+    struct Float { __m128 Value; };
+    struct Mask { __m128 Value; };
+
+    inline Float Broadcast(float value) { return {_mm_set1_ps(value)}; }
+    inline Float Load(const float *data) { return {_mm_load_ps(data)}; }
+    inline Float LoadUnaligned(const float *data) { return {_mm_loadu_ps(data)}; }
+    inline Float LoadBytes(const glm::uint8 *data)
+    {
+        int bytes;
+        std::memcpy(&bytes, data, sizeof(bytes));
+        __m128i zero = _mm_setzero_si128();
+        __m128i words = _mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero);
+        return {_mm_cvtepi32_ps(_mm_unpacklo_epi16(words, zero))};
+    }
+    inline void Store(float *data, Float value) { _mm_store_ps(data, value.Value); }
+
+    inline Float operator+(Float a, Float b) { return {_mm_add_ps(a.Value, b.Value)}; }
+    inline Float operator-(Float a, Float b) { return {_mm_sub_ps(a.Value, b.Value)}; }
+    inline Float operator*(Float a, Float b) { return {_mm_mul_ps(a.Value, b.Value)}; }
+    inline Float operator/(Float a, Float b) { return {_mm_div_ps(a.Value, b.Value)}; }
+    inline Float MultiplyAdd(Float a, Float b, Float c) { return {_mm_add_ps(_mm_mul_ps(a.Value, b.Value), c.Value)}; }
+    inline Float MultiplySub(Float a, Float b, Float c) { return {_mm_sub_ps(_mm_mul_ps(a.Value, b.Value), c.Value)}; }
+    inline Float Min(Float a, Float b) { return {_mm_min_ps(a.Value, b.Value)}; }
+    inline Float Max(Float a, Float b) { return {_mm_max_ps(a.Value, b.Value)}; }
+    inline Float Sqrt(Float a) { return {_mm_sqrt_ps(a.Value)}; }
+
+    inline Mask Less(Float a, Float b) { return {_mm_cmplt_ps(a.Value, b.Value)}; }
+    inline Mask LessEqual(Float a, Float b) { return {_mm_cmple_ps(a.Value, b.Value)}; }
+    inline Mask Greater(Float a, Float b) { return {_mm_cmpgt_ps(a.Value, b.Value)}; }
+    inline Mask operator&(Mask a, Mask b) { return {_mm_and_ps(a.Value, b.Value)}; }
+    inline Mask operator|(Mask a, Mask b) { return {_mm_or_ps(a.Value, b.Value)}; }
+
+    inline Float Select(Mask mask, Float a, Float b) { return {_mm_or_ps(_mm_and_ps(mask.Value, a.Value), _mm_andnot_ps(mask.Value, b.Value))}; }
+    inline int Bits(Mask mask) { return _mm_movemask_ps(mask.Value); }
+
+#else
+
+    constexpr glm::uint32 Width = 1;
+
+    struct Float { float Value; };
+    struct Mask { bool Value; };
+
+    inline Float Broadcast(float value) { return {value}; }
+    inline Float Load(const float *data) { return {*data}; }
+    inline Float LoadUnaligned(const float *data) { return {*data}; }
+    inline Float LoadBytes(const glm::uint8 *data) { return {(float)*data}; }
+    inline void Store(float *data, Float value) { *data = value.Value; }
+
+    inline Float operator+(Float a, Float b) { return {a.Value + b.Value}; }
+    inline Float operator-(Float a, Float b) { return {a.Value - b.Value}; }
+    inline Float operator*(Float a, Float b) { return {a.Value * b.Value}; }
+    inline Float operator/(Float a, Float b) { return {a.Value / b.Value}; }
+    inline Float MultiplyAdd(Float a, Float b, Float c) { return {a.Value * b.Value + c.Value}; }
+    inline Float MultiplySub(Float a, Float b, Float c) { return {a.Value * b.Value - c.Value}; }
+    inline Float Min(Float a, Float b) { return {a.Value < b.Value ? a.Value : b.Value}; }
+    inline Float Max(Float a, Float b) { return {a.Value > b.Value ? a.Value : b.Value}; }
+    inline Float Sqrt(Float a) { return {std::sqrt(a.Value)}; }
+
+    inline Mask Less(Float a, Float b) { return {a.Value < b.Value}; }
+    inline Mask LessEqual(Float a, Float b) { return {a.Value <= b.Value}; }
+    inline Mask Greater(Float a, Float b) { return {a.Value > b.Value}; }
+    inline Mask operator&(Mask a, Mask b) { return {a.Value && b.Value}; }
+    inline Mask operator|(Mask a, Mask b) { return {a.Value || b.Value}; }
+
+    inline Float Select(Mask mask, Float a, Float b) { return mask.Value ? a : b; }
+    inline int Bits(Mask mask) { return mask.Value ? 1 : 0; }
+
+#endif
+
+    constexpr glm::uint32 Alignment = Width * sizeof(float);
+
+    inline bool Any(Mask mask) { return Bits(mask) != 0; }
+
+    inline const char *GetInstructionSet()
+    {
+#if defined(BRIAR_AVX2)
+        return "avx2";
+#elif defined(BRIAR_SSE)
+        return "sse2";
+#else
+        return "scalar";
+#endif
+    }
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#define GL_SILENCE_DEPRECATION
+#include <glm/glm.hpp>
+#include "Sphere.h"
+#include "Transform.h"
+#include <vector>
+#include <memory>
+
+class SceneFile;
+
+struct Light
+{
+    glm::vec3 Position;
+    glm::vec3 Color;
+	float Intensity;
+};
+
+struct Material
+{
+    glm::vec3 Albedo{ 1.0f };
+    float Roughness = 1.0f;
+    float Specular = 0.5f; // Intensidad especular
+    float Shininess = 32.0f; // Exponente especular
+};
+
+// struct Sphere
+// {
+// 	glm::vec3 Position{0.0f};
+// 	float Radius = 0.5f;
+
+// 	int MaterialIndex = 0;
+// };
+
+// How the tracer builds the BVH over the scene's spheres
+enum class BVHBuilder
+{
+	SAH,  // Binned surface area heuristic, the fastest tree to trace
+	LBVH, // Morton-code linear BVH, rebuilt in a few milliseconds, for scenes where everything moves every frame
+};
+
+// Shapes defined once in their own object space and placed any number of times by instances.
+// They get a bottom-level BVH of their own, so only bounded shapes belong here.
+struct Geometry
+{
+	std::vector<std::shared_ptr<Shape>> Shapes;
+};
+
+// One placement of Scene::Geometries[GeometryIndex]. MaterialIndex replaces the materials of its shapes
+// unless it is negative.
+struct Instance
+{
+	Transform ObjectToWorld;
+	glm::uint32 GeometryIndex = 0;
+	int MaterialIndex = -1;
+};
+
+struct Scene
+{
+	std::vector<std::shared_ptr<Shape>> Shapes;
+	std::vector<Material> Materials;
+	std::vector<Light> Lights;
+	std::vector<Geometry> Geometries;
+	std::vector<Instance> Instances;
+	glm::vec3 AmbientLight{0.1f};
+	float AmbientIntensity = 0.1f;
+
+	// Set whenever shapes are added or removed so the tracer recompiles them and rebuilds its BVH,
+	// geometries included
+	bool GeometryDirty = true;
+	// Set when instances are added, removed or moved; only the top-level BVH over them is rebuilt
+	bool InstancesDirty = true;
+	// Indices of shapes moved, resized or reoriented in place since the last frame, the tracer
+	// updates just those and refits its BVH instead of rebuilding it, or rebuilds it when Builder is LBVH
+	std::vector<size_t> EditedShapes;
+	// Set when lights are added, removed or edited so the tracer rebuilds the tables it samples them from
+	bool LightsDirty = true;
+	BVHBuilder Builder = BVHBuilder::SAH;
+	// Mapped file the scene was loaded from when it carries a BVH over Shapes (SceneFile). The tracer adopts
+	// that tree instead of building one the first time it compiles the scene, then drops the file.
+	std::shared_ptr<const SceneFile> Prebuilt;
+};
\ No newline at end of file
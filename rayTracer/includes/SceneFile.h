@@ -0,0 +1,46 @@
+#pragma once
+
+#define GL_SILENCE_DEPRECATION
+#include <glm/glm.hpp>
+#include <memory>
+#include <string>
+#include "BVH.h"
+#include "Camera.h"
+#include "Scene.h"
+
+// Versioned binary scene (.bscn). A fixed header with the camera, ambient light and a table of sections is
+// followed by flat, 16-byte aligned arrays of materials, lights, shapes, geometries, instances and mesh data,
+// optionally with the BVH over the spheres and the triangle BVH of every mesh. Records have no pointers and
+// are read straight from the mapped file; with the trees included nothing is built on load either.
+class SceneFile
+{
+public:
+    static constexpr glm::uint32 Version = 1;
+
+    SceneFile(const SceneFile &) = delete;
+    SceneFile &operator=(const SceneFile &) = delete;
+    ~SceneFile();
+
+    // Writes scene and the camera view. With includeBVH the trees are built here with builder and saved too,
+    // the spheres are then stored in the sphere tree's leaf order
+    static bool Save(const std::string &path, const Scene &scene, const Camera &camera, bool includeBVH, BVHBuilder builder);
+    // Maps path and fills scene and camera from it, errors go to std::cerr. A file with a sphere BVH stays
+    // mapped in scene.Prebuilt until the tracer has taken the tree
+    static bool Load(const std::string &path, Scene &scene, Camera &camera);
+
+    // Sphere BVH for the scene as loaded, nodes in BVH::Node layout
+    const BVH::Node *GetBVHNodes() const { return bvhNodes; }
+    size_t GetBVHNodeCount() const { return bvhNodeCount; }
+    BVHBuilder GetBuilder() const { return builder; }
+
+private:
+    SceneFile() = default;
+
+private:
+    const unsigned char *data = nullptr;
+    size_t size = 0;
+
+    const BVH::Node *bvhNodes = nullptr;
+    size_t bvhNodeCount = 0;
+    BVHBuilder builder = BVHBuilder::SAH;
+};
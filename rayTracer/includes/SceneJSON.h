@@ -0,0 +1,76 @@
+#pragma once
+
+#define GL_SILENCE_DEPRECATION
+#include <glm/glm.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Camera.h"
+#include "Scene.h"
+#include "Tracer.h"
+
+// Human-readable JSON scenes. The parser makes one pass over the text and writes straight into a
+// SceneDescription, plain data that is cheap to compare, so SceneWatcher can diff two versions of a file and
+// apply only what changed. Unknown keys are skipped.
+//
+// {
+//   "camera": {"position": [0, 0, 6], "direction": [0, 0, -1]},
+//   "settings": {"bounces": 5, "bvhWidth": 8, ...},   // Tracer::Settings, camelCase
+//   "builder": "sah",
+//   "ambient": {"color": [0.1, 0.1, 0.1], "intensity": 0.1},
+//   "materials": [{"albedo": [1, 0, 1], "roughness": 0, "specular": 0.5, "shininess": 32}],
+//   "lights": [{"position": [3, 4, 4], "color": [1, 1, 1], "intensity": 30}],
+//   "shapes": [{"type": "sphere", "position": [0, 0, 0], "radius": 1, "material": 0},
+//              {"type": "plane", "position": [0, -1, 0], "normal": [0, 1, 0], "material": 1},
+//              {"type": "mesh", "obj": "model.obj", "position": [0, 0, 0], "material": 0}]
+// }
+namespace SceneJSON
+{
+    struct ShapeDescription
+    {
+        ShapeType Type = ShapeType::Sphere;
+        glm::vec3 Position{0.0f};
+        float Radius = 0.5f;
+        glm::vec3 Normal{0.0f, 1.0f, 0.0f};
+        int MaterialIndex = 0;
+        std::string MeshPath; // Meshes, resolved against the scene file's directory
+
+        bool operator==(const ShapeDescription &other) const;
+        bool operator!=(const ShapeDescription &other) const { return !(*this == other); }
+    };
+
+    struct SceneDescription
+    {
+        std::vector<Material> Materials;
+        std::vector<Light> Lights;
+        std::vector<ShapeDescription> Shapes;
+        glm::vec3 AmbientLight{0.1f};
+        float AmbientIntensity = 0.1f;
+        BVHBuilder Builder = BVHBuilder::SAH;
+
+        bool HasCamera = false;
+        glm::vec3 CameraPosition{0.0f, 0.0f, 6.0f};
+        glm::vec3 CameraDirection{0.0f, 0.0f, -1.0f};
+
+        // Keys missing from the file keep their defaults, so they never show up as a change
+        Tracer::Settings Settings;
+    };
+
+    // Parses size bytes of text; on failure error holds the message and line
+    bool Parse(const char *text, size_t size, const std::string &directory, SceneDescription &description, std::string &error);
+    // Reads and parses a file, errors go to std::cerr
+    bool Read(const std::string &path, SceneDescription &description);
+
+    // New shape for a description, loading the OBJ file of a mesh; nullptr when that fails
+    std::shared_ptr<Shape> CreateShape(const ShapeDescription &description);
+    // Copies position, size, orientation and material into an existing shape of the same type
+    void UpdateShape(const ShapeDescription &description, Shape &shape);
+    // Replaces scene with the description and places camera
+    bool Instantiate(const SceneDescription &description, Scene &scene, Camera &camera);
+
+    // Read followed by Instantiate, render settings are left alone
+    bool Load(const std::string &path, Scene &scene, Camera &camera);
+    // Writes spheres, planes, materials, lights and the camera view. Meshes have no file to refer to and
+    // instances no JSON form, both are skipped with a warning
+    bool Save(const std::string &path, const Scene &scene, const Camera &camera);
+}
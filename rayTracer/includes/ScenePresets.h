@@ -0,0 +1,16 @@
+#pragma once
+
+#define GL_SILENCE_DEPRECATION
+#include <string>
+#include <vector>
+#include "Camera.h"
+#include "Scene.h"
+
+// Procedural scenes for the headless renderer and benchmarks
+namespace ScenePresets
+{
+    // Fills scene and places camera, returns false for an unknown name or an OBJ or scene file that fails to load
+    bool Load(const std::string &name, Scene &scene, Camera &camera);
+
+    std::vector<std::string> GetNames();
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#define GL_SILENCE_DEPRECATION
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include "SceneJSON.h"
+
+// Keeps a live scene in step with a JSON scene file. Every reload is parsed into a SceneDescription and compared
+// with the previous one, and only what differs is written into the scene: moved or resized shapes go through
+// Scene::EditedShapes so the tracer refits its BVH, and only adding, removing or retyping shapes rebuilds it.
+// Meshes whose file is unchanged are kept as they are.
+class SceneWatcher
+{
+public:
+    // Loads path into scene, camera and settings and starts watching it
+    bool Open(const std::string &path, Scene &scene, Camera &camera, Tracer::Settings &settings);
+    void Close();
+
+    // Checks the file at most every CheckInterval and applies any change; true when something changed.
+    // A file that fails to parse leaves the scene as it was and is tried again once it is saved anew.
+    bool Poll(Scene &scene, Camera &camera, Tracer::Settings &settings);
+
+    bool IsWatching() const { return !path.empty(); }
+    const std::string &GetPath() const { return path; }
+    // Outcome of the last reload, for the UI
+    const std::string &GetStatus() const { return status; }
+
+    static constexpr std::chrono::milliseconds CheckInterval{250};
+
+private:
+    // False when next cannot be applied, the scene is then left untouched
+    bool Apply(const SceneJSON::SceneDescription &next, Scene &scene, Camera &camera, Tracer::Settings &settings, bool &changed);
+    bool CreateShapes(const SceneJSON::SceneDescription &next, const Scene &scene, std::vector<std::shared_ptr<Shape>> &shapes);
+
+private:
+    std::string path;
+    std::string status;
+    SceneJSON::SceneDescription current;
+    std::filesystem::file_time_type lastWriteTime;
+    std::chrono::steady_clock::time_point lastCheck;
+};
@@ -3,12 +3,14 @@
 #define GL_SILENCE_DEPRECATION
 #include <glm/glm.hpp>
 #include "Ray.h"
+#include "AABB.h"
 #include <vector>
 
 enum class ShapeType
 {
     Sphere,
-    Plane
+    Plane,
+    Mesh
 };
 
 class Shape {
@@ -19,6 +21,12 @@ public:
     virtual bool Intersect(const glm::vec3& RayOrigin, const glm::vec3& RayDirection, float& t) const = 0;
     virtual glm::vec3 GetNormal(const glm::vec3& Point) const = 0;
     virtual float GetClosestHit(const Ray& ray) const = 0;
+    // Occlusion only: true as soon as the ray hits the shape inside (tMin, tMax)
+    virtual bool AnyHit(const Ray& ray, float tMin, float tMax) const = 0;
+
+    // Unbounded shapes (planes) are kept out of the BVH and tested on every ray
+    virtual bool IsBounded() const { return true; }
+    virtual AABB GetBounds() const = 0;
 
     int GetMaterialIndex() const { return MaterialIndex; }
     void SetMaterialIndex(int index) { MaterialIndex = index; }
@@ -26,7 +34,7 @@ public:
     glm::vec3 GetPosition() const { return Position; }
     void SetPosition(const glm::vec3& position) { Position = position; }
     ShapeType GetType() const { return Type; }
-    ShapeType SetType(ShapeType type) { Type = type; }
+    void SetType(ShapeType type) { Type = type; }
 
     glm::vec3 Position{0.0f};
     int MaterialIndex = 0;
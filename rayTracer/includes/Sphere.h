@@ -15,6 +15,8 @@ public:
     bool Intersect(const glm::vec3& RayOrigin, const glm::vec3& RayDirection, float& t) const override;
     glm::vec3 GetNormal(const glm::vec3& Point) const override;
     float GetClosestHit(const Ray& ray) const override;
+    bool AnyHit(const Ray& ray, float tMin, float tMax) const override;
+    AABB GetBounds() const override;
 
     float GetRadius() const { return Radius; }
     void SetRadius(float radius) { Radius = radius; }
@@ -0,0 +1,46 @@
+#pragma once
+
+#define GL_SILENCE_DEPRECATION
+#include <glm/glm.hpp>
+#include "Ray.h"
+#include "SIMD.h"
+
+// One ray against a run of spheres in structure-of-arrays storage, 8 spheres per step with AVX2,
+// 4 with SSE2 and one at a time elsewhere (arm64 macs)
+namespace SphereKernel
+{
+    constexpr glm::uint32 Width = SIMD::Width;
+
+    // The kernels load whole vectors, so every array needs Width - 1 readable floats past the last sphere
+    constexpr glm::uint32 Padding = Width - 1;
+
+    struct Spheres
+    {
+        const float *CenterX;
+        const float *CenterY;
+        const float *CenterZ;
+        const float *RadiusSquared;
+    };
+
+    // The quadratic of Sphere::GetClosestHit with the factors of 2 cancelled:
+    // t = (-b - sqrt(b^2 - a*c)) / a, with oc = origin - center, b = dot(oc, d) and a = dot(d, d).
+    // A negative discriminant gives NaN, which fails every ordered compare, so misses need no separate test.
+    // Single rays and packets both go through here so they agree bit for bit.
+    inline SIMD::Float EntryDistance(SIMD::Float ocX, SIMD::Float ocY, SIMD::Float ocZ, SIMD::Float radiusSquared,
+                                     SIMD::Float directionX, SIMD::Float directionY, SIMD::Float directionZ,
+                                     SIMD::Float a, SIMD::Float negInvA)
+    {
+        SIMD::Float b = SIMD::MultiplyAdd(ocX, directionX, SIMD::MultiplyAdd(ocY, directionY, ocZ * directionZ));
+        SIMD::Float c = SIMD::MultiplyAdd(ocX, ocX, SIMD::MultiplyAdd(ocY, ocY, SIMD::MultiplySub(ocZ, ocZ, radiusSquared)));
+        SIMD::Float discriminant = SIMD::MultiplySub(b, b, a * c);
+        return (b + SIMD::Sqrt(discriminant)) * negInvA;
+    }
+
+    // Nearest entry distance in (0, hitDistance) among spheres [first, first + count),
+    // shrinks hitDistance and returns the sphere slot, or -1 when nothing closer was found
+    int Intersect(const Spheres &spheres, const Ray &ray, glm::uint32 first, glm::uint32 count, float &hitDistance);
+    // True as soon as one sphere in the range is entered inside (tMin, tMax)
+    bool AnyHit(const Spheres &spheres, const Ray &ray, glm::uint32 first, glm::uint32 count, float tMin, float tMax);
+
+    inline const char *GetInstructionSet() { return SIMD::GetInstructionSet(); }
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#define GL_SILENCE_DEPRECATION
+#include <cmath>
+
+// Number parsing over [p, end) ranges of a larger buffer for the text scene readers (ObjLoader, SceneJSON).
+// strtof and friends need a terminated copy of every token and honour the locale, these advance p past what they
+// read and return false without moving it when there is no number.
+namespace TextParsing
+{
+    inline bool IsDigit(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    // Decimal float with optional sign, fraction and exponent
+    inline bool ParseFloat(const char *&p, const char *end, float &value)
+    {
+        const char *start = p;
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+'))
+            negative = *p++ == '-';
+
+        const char *digits = p;
+        double mantissa = 0.0;
+        while (p < end && IsDigit(*p))
+            mantissa = mantissa * 10.0 + (*p++ - '0');
+
+        int exponent = 0;
+        if (p < end && *p == '.')
+        {
+            p++;
+            while (p < end && IsDigit(*p))
+            {
+                mantissa = mantissa * 10.0 + (*p++ - '0');
+                exponent--;
+            }
+        }
+        if (p == digits || (p == digits + 1 && *digits == '.'))
+        {
+            p = start;
+            return false;
+        }
+
+        if (p < end && (*p == 'e' || *p == 'E'))
+        {
+            p++;
+            bool negativeExponent = false;
+            if (p < end && (*p == '-' || *p == '+'))
+                negativeExponent = *p++ == '-';
+            int power = 0;
+            while (p < end && IsDigit(*p))
+            {
+                // Saturates, anything this large is inf or 0 as a float anyway
+                if (power < 10000)
+                    power = power * 10 + (*p - '0');
+                p++;
+            }
+            exponent += negativeExponent ? -power : power;
+        }
+
+        // Exact powers of ten up to 1e22, beyond that the rare exponent goes through pow
+        static const double powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+        if (exponent < 0)
+            mantissa = exponent >= -22 ? mantissa / powers[-exponent] : mantissa * std::pow(10.0, exponent);
+        else if (exponent > 0)
+            mantissa = exponent <= 22 ? mantissa * powers[exponent] : mantissa * std::pow(10.0, exponent);
+
+        value = (float)(negative ? -mantissa : mantissa);
+        return true;
+    }
+
+    inline bool ParseInt(const char *&p, const char *end, long &value)
+    {
+        const char *start = p;
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+'))
+            negative = *p++ == '-';
+
+        const char *digits = p;
+        long result = 0;
+        while (p < end && IsDigit(*p))
+            result = result * 10 + (*p++ - '0');
+        if (p == digits)
+        {
+            p = start;
+            return false;
+        }
+
+        value = negative ? -result : result;
+        return true;
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#define GL_SILENCE_DEPRECATION
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/partitioner.h>
+#include <tbb/task_arena.h>
+
+// Splits the image into square tiles walked in Morton order and hands them to a TBB arena,
+// idle workers steal whole tiles from busy ones
+class TileScheduler
+{
+public:
+    struct Tile
+    {
+        glm::uint32 MinX, MinY;
+        glm::uint32 MaxX, MaxY; // Exclusive
+    };
+
+    TileScheduler();
+    ~TileScheduler();
+
+    // Rebuilds the tile list only when the image or tile size changed
+    void Configure(glm::uint32 width, glm::uint32 height, glm::uint32 tileSize);
+    // 0 uses every hardware thread
+    void SetThreadCount(int count);
+
+    int GetThreadCount() const { return arenaThreads; }
+    static int GetMaxThreadCount();
+
+    const std::vector<Tile> &GetTiles() const { return tiles; }
+
+    template <typename Func>
+    void Run(const Func &func)
+    {
+        arena->execute([&]
+                       { tbb::parallel_for(
+                             tbb::blocked_range<size_t>(0, tiles.size(), 1),
+                             [&](const tbb::blocked_range<size_t> &range)
+                             {
+                                 for (size_t i = range.begin(); i != range.end(); i++)
+                                     func(tiles[i]);
+                             },
+                             tbb::simple_partitioner()); });
+    }
+
+    // Runs func on the arena, so any TBB work it spawns (BVH builds) is limited to the same thread count
+    template <typename Func>
+    void Execute(const Func &func)
+    {
+        arena->execute(func);
+    }
+
+    // Runs func(begin, end) over [0, count) on the same arena, for work that is not tile shaped
+    template <typename Func>
+    void ParallelFor(size_t count, size_t grainSize, const Func &func)
+    {
+        arena->execute([&]
+                       { tbb::parallel_for(
+                             tbb::blocked_range<size_t>(0, count, grainSize),
+                             [&](const tbb::blocked_range<size_t> &range)
+                             { func(range.begin(), range.end()); }); });
+    }
+
+private:
+    std::vector<Tile> tiles;
+    std::unique_ptr<tbb::task_arena> arena;
+
+    int requestedThreads = -1;
+    int arenaThreads = 0;
+
+    glm::uint32 width = 0, height = 0, tileSize = 0;
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#define GL_SILENCE_DEPRECATION
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+#include "BVH.h"
+#include "CompiledScene.h"
+#include "Scene.h"
+#include "Transform.h"
+
+// Two-level acceleration for Scene::Instances. Every Geometry is compiled and gets its own BVH once (the bottom
+// level), instances only add a transform and the top-level BVH is built over their world bounds. Rays that reach
+// an instance are moved into its object space, the geometry itself never moves.
+class TopLevelBVH
+{
+public:
+    struct BuildStats
+    {
+        float BuildTimeMs = 0.0f;         // Top level, last Build or Update
+        float GeometryBuildTimeMs = 0.0f; // All bottom levels, last Build
+        glm::uint32 InstanceCount = 0;
+        glm::uint32 GeometryCount = 0;
+        size_t GeometryShapeCount = 0; // Shapes stored once in the bottom levels
+        size_t InstancedShapeCount = 0; // Shapes the instances place in the world
+        size_t MemorySize = 0;          // Bytes of both levels
+    };
+
+    // Compiles every geometry and builds its BVH, then the top level
+    void Build(const Scene &scene, BVHBuilder builder);
+    // Rebuilds only the top level, after instances were added, removed or moved
+    void Update(const Scene &scene);
+
+    bool IsEmpty() const { return placed.empty(); }
+
+    // Continues a closest-hit search like BVH::IntersectCloser. On a closer hit objectIndex becomes the index of the
+    // shape in its Geometry, instanceIndex the Scene::Instances index and triangle the Mesh triangle (-1 otherwise)
+    bool IntersectCloser(const Ray &ray, float &hitDistance, int &objectIndex, int &instanceIndex, int &triangle) const;
+    bool AnyHit(const Ray &ray, float tMin, float tMax) const;
+
+    // Inverse of Scene::Instances[instanceIndex].ObjectToWorld as of the last Build or Update
+    const Transform &GetWorldToObject(int instanceIndex) const { return worldToObject[instanceIndex]; }
+    const BuildStats &GetStats() const { return stats; }
+
+private:
+    struct BottomLevel
+    {
+        CompiledScene Geometry;
+        BVH Tree; // Points into Geometry, so bottom levels are never moved
+        AABB Bounds; // Tree and meshes, in object space
+    };
+    struct PlacedInstance
+    {
+        Transform WorldToObject;
+        const BVH *Tree;
+        const CompiledScene *Geometry; // For its meshes, which are not in Tree
+        int InstanceIndex;
+    };
+
+private:
+    std::vector<std::unique_ptr<BottomLevel>> bottomLevels;
+    std::vector<PlacedInstance> placed; // Top-level leaf order, instances of empty or missing geometries left out
+    std::vector<Transform> worldToObject; // Scene::Instances order
+    BVH topLevel;
+    BVHBuilder builder = BVHBuilder::SAH;
+
+    BuildStats stats;
+};
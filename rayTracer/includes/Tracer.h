@@ -0,0 +1,167 @@
+#pragma once
+
+#define GL_SILENCE_DEPRECATION
+#include <glm/glm.hpp>
+#include <memory>
+#include "Camera.h"
+#include "Ray.h"
+#include "Scene.h"
+#include "Sphere.h"
+#include "Plane.h"
+#include "Mesh.h"
+#include "BVH.h"
+#include "WideBVH.h"
+#include "TopLevelBVH.h"
+#include "CompiledScene.h"
+#include "RayPacket.h"
+#include "Random.h"
+#include "TileScheduler.h"
+#include "ConvergenceMap.h"
+#include "LightSampler.h"
+#include "LightTree.h"
+
+class WavefrontIntegrator;
+
+// Tracing core shared by the windowed Renderer and the headless tools, no GL or window dependencies
+class Tracer
+{
+public:
+    struct Settings
+    {
+        bool Accumulate = false;
+        int Bounces = 5; // Maximum path depth
+        bool RussianRoulette = true; // Past RouletteDepth bounces paths end at random, more likely the less they still carry
+        int RouletteDepth = 2;
+        int ThreadCount = 0; // 0 uses every hardware thread
+        int TileSize = 32;
+        bool UseBVH = true; // Off tests every ray against every primitive
+        int BVHWidth = 2;   // 2 walks the binary BVH, 4 or 8 the BVH4/BVH8 collapsed from it
+        bool QuantizedBVH = false; // BVH4/BVH8 only, child boxes stored as 8-bit steps (QuantizedWideNode)
+        int PacketSize = 8; // Primary rays are traced in PacketSize x PacketSize packets (4 or 8), 0 traces them one by one
+        bool Wavefront = false; // Traces the frame stage by stage (WavefrontIntegrator) instead of tile by tile
+        bool SortByMaterial = false; // Wavefront only, groups live paths by material before shading
+        bool AdaptiveSampling = false; // Accumulate, tile by tile only: converged tiles stop taking samples (ConvergenceMap)
+        float NoiseThreshold = 0.01f;  // Relative standard error of the pixel means below which a tile has converged
+        LightSampling LightSelection = LightSampling::All;
+        int LightSamples = 1; // Shadow rays per hit when lights are sampled rather than all shaded
+    };
+    struct HitPayload
+    {
+        float HitDistance;
+        glm::vec3 WorldPosition;
+        glm::vec3 WorldNormal;
+
+        int ObjectIndex;
+        int InstanceIndex = -1; // When set, ObjectIndex indexes the shapes of that instance's Geometry
+        int PrimitiveIndex = -1; // Triangle within the Mesh that was hit
+    };
+    struct WavefrontStats
+    {
+        glm::uint32 WaveCount = 0;
+        glm::uint32 PathsTraced = 0; // Closest-hit rays, all bounces
+        glm::uint32 ShadowRays = 0;
+    };
+
+private:
+    glm::uint32 width = 0, height = 0;
+
+    const Scene *activeScene = nullptr;
+    const Camera *activeCamera = nullptr;
+
+    Settings settings;
+
+    CompiledScene compiledScene;
+    BVH bvh;
+    BVH4 bvh4;
+    BVH8 bvh8;
+    QuantizedBVH4 quantizedBVH4;
+    QuantizedBVH8 quantizedBVH8;
+    int builtWideWidth = 0; // Which wide tree matches the current binary tree, 0 for none
+    bool builtQuantized = false;
+    int activeWidth = 2;
+    bool activeQuantized = false;
+    std::vector<glm::uint32> refitSlots;
+    TopLevelBVH instances;
+    LightSampler lightSampler;
+    LightTree lightTree;
+
+    TileScheduler scheduler;
+    std::unique_ptr<WavefrontIntegrator> wavefront; // Created on first use
+
+    friend class WavefrontIntegrator;
+
+    glm::vec4 *accumulationData = nullptr;
+    ConvergenceMap convergence; // Active only while adaptive sampling runs
+    bool adaptive = false;
+    glm::uint32 adaptiveSamples = 1; // Per pixel this frame, for tiles that have not converged
+
+    glm::uint32 frameIndex = 1;
+
+    float lastRenderTimeMs = 0.0f;
+
+public:
+    Tracer();
+    ~Tracer();
+
+    void OnResize(glm::uint32 width, glm::uint32 height);
+    // Makes scene the active scene and recompiles it and its BVH if its geometry or builder changed, or refits the BVH
+    // when shapes were only edited in place; collapses the BVH when a wide one is selected, rebuilds the top-level
+    // BVH when instances moved and refits or rebuilds the light tables when lights changed. Render calls it every frame
+    void PrepareScene(Scene &scene);
+    // Adds one sample per pixel to the accumulation buffer (with adaptive sampling none in converged tiles and up to
+    // 8 elsewhere) and writes the averaged RGBA8 image to data
+    void Render(Scene &scene, const Camera &camera, glm::uint32 *data);
+
+    // primaryHit, when given, replaces tracing the camera ray (it was already traced in a packet)
+    glm::vec4 RayGun(glm::uint32 x, glm::uint32 y, const HitPayload *primaryHit = nullptr); // RayGen
+    void RenderTile(const TileScheduler::Tile &tile, glm::uint32 *data);
+    // AccumulateSample followed by ResolvePixel
+    void WritePixel(glm::uint32 x, glm::uint32 y, const glm::vec4 &color, glm::uint32 *data);
+    void AccumulateSample(glm::uint32 x, glm::uint32 y, const glm::vec4 &color);
+    // Writes the pixel's accumulated mean to data as RGBA8
+    void ResolvePixel(glm::uint32 x, glm::uint32 y, glm::uint32 *data);
+
+    void RefitScene(Scene &scene);
+
+    HitPayload TraceRay(const Ray &ray);
+    void TracePacket(RayPacket &packet);
+    // Shading stages of RayGun, shared with the wavefront integrator so both draw the same samples in the same order
+    const Material &GetMaterial(const HitPayload &payload) const;
+    int GetMaterialIndex(const HitPayload &payload) const;
+    // Shadow rays every hit traces: one per light, or LightSamples when they are sampled
+    glm::uint32 GetShadowRaysPerHit() const;
+    // Light for the shadow ray sample of a hit and the weight its ShadeLight result is multiplied by, -1 for none.
+    // Shading all lights returns light sample itself without drawing from sampler
+    int SelectLight(glm::uint32 sample, const HitPayload &payload, const Material &material, Sampler &sampler, float &weight) const;
+    Ray GenerateShadowRay(const HitPayload &payload, const Light &light, Sampler &sampler, float &lightDistance) const;
+    glm::vec3 ShadeLight(const Ray &ray, const HitPayload &payload, const Material &material, const Light &light, bool inShadow) const;
+    Ray GenerateBounceRay(const Ray &ray, const HitPayload &payload, const Material &material, Sampler &sampler) const;
+    // Russian roulette after bounce: false ends the path, a surviving one has multiplier weighted up to stay unbiased
+    bool ContinuePath(int bounce, float &multiplier, Sampler &sampler) const;
+    glm::vec3 GetSkyColor() const { return glm::vec3(0.0f); }
+    bool TraceShadowRay(const Ray &ray, float maxDistance);
+    HitPayload ClosestHit(const Ray &ray, float hitDistance, int objectIndex, int instanceIndex = -1, int primitiveIndex = -1);
+    HitPayload Miss(const Ray &ray);
+    // Mesh hits use the normal of the triangle that was hit
+    glm::vec3 GetShapeNormal(const Shape &shape, const glm::vec3 &point, int primitiveIndex) const;
+
+    glm::uint32 GetWidth() const { return width; }
+    glm::uint32 GetHeight() const { return height; }
+    // Sum of all samples so far, alpha is each pixel's own sample count: divide by it for the pixel mean
+    const glm::vec4 *GetAccumulationData() const { return accumulationData; }
+    // Frames accumulated, adaptive sampling gives pixels more or fewer samples than this
+    glm::uint32 GetSampleCount() const { return settings.Accumulate ? frameIndex - 1 : 1; }
+    const ConvergenceMap &GetConvergenceMap() const { return convergence; }
+    glm::uint32 GetAdaptiveSamplesPerPixel() const { return adaptive ? adaptiveSamples : 1; }
+
+    void ResetFrameIndex() { frameIndex = 1; }
+    Settings &GetSettings() { return settings; }
+    const BVH::BuildStats &GetBVHStats() const { return bvh.GetStats(); }
+    // Bytes of the nodes of the tree the last PrepareScene selected
+    size_t GetBVHMemorySize() const;
+    const TopLevelBVH::BuildStats &GetInstanceStats() const { return instances.GetStats(); }
+    const LightTree::BuildStats &GetLightTreeStats() const { return lightTree.GetStats(); }
+    const WavefrontStats &GetWavefrontStats() const;
+    float GetLastRenderTime() const { return lastRenderTimeMs; }
+    int GetThreadCount() const { return scheduler.GetThreadCount(); }
+};
@@ -0,0 +1,116 @@
+#pragma once
+
+#define GL_SILENCE_DEPRECATION
+#include <glm/glm.hpp>
+#include <cmath>
+#include "AABB.h"
+#include "Ray.h"
+
+// Affine 3x4 transform stored as three rows, the fourth row of the full matrix is always (0, 0, 0, 1).
+// Rows[i].w is the translation, so a point maps to (dot(Rows[i].xyz, p) + Rows[i].w).
+struct Transform
+{
+    glm::vec4 Rows[3] = {{1.0f, 0.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 1.0f, 0.0f}};
+
+    // Scale first, then rotation about X, Y and Z in that order (degrees), then translation
+    static Transform FromTRS(const glm::vec3 &position, const glm::vec3 &rotationDegrees, const glm::vec3 &scale)
+    {
+        glm::vec3 angles(glm::radians(rotationDegrees.x), glm::radians(rotationDegrees.y), glm::radians(rotationDegrees.z));
+        float cx = std::cos(angles.x), sx = std::sin(angles.x);
+        float cy = std::cos(angles.y), sy = std::sin(angles.y);
+        float cz = std::cos(angles.z), sz = std::sin(angles.z);
+
+        // R = Rz * Ry * Rx
+        glm::vec3 rotation[3] = {
+            {cz * cy, cz * sy * sx - sz * cx, cz * sy * cx + sz * sx},
+            {sz * cy, sz * sy * sx + cz * cx, sz * sy * cx - cz * sx},
+            {-sy, cy * sx, cy * cx}};
+
+        Transform transform;
+        for (int i = 0; i < 3; i++)
+            transform.Rows[i] = glm::vec4(rotation[i] * scale, position[i]);
+        return transform;
+    }
+
+    glm::vec3 GetTranslation() const { return glm::vec3(Rows[0].w, Rows[1].w, Rows[2].w); }
+    void SetTranslation(const glm::vec3 &translation)
+    {
+        Rows[0].w = translation.x;
+        Rows[1].w = translation.y;
+        Rows[2].w = translation.z;
+    }
+
+    glm::vec3 TransformPoint(const glm::vec3 &point) const
+    {
+        return TransformVector(point) + GetTranslation();
+    }
+
+    glm::vec3 TransformVector(const glm::vec3 &vector) const
+    {
+        return glm::vec3(Rows[0].x * vector.x + Rows[0].y * vector.y + Rows[0].z * vector.z,
+                         Rows[1].x * vector.x + Rows[1].y * vector.y + Rows[1].z * vector.z,
+                         Rows[2].x * vector.x + Rows[2].y * vector.y + Rows[2].z * vector.z);
+    }
+
+    // Normals go through the inverse transpose; called on the inverse transform it only needs the transpose
+    glm::vec3 TransformNormalByInverse(const glm::vec3 &normal) const
+    {
+        return glm::vec3(Rows[0].x * normal.x + Rows[1].x * normal.y + Rows[2].x * normal.z,
+                         Rows[0].y * normal.x + Rows[1].y * normal.y + Rows[2].y * normal.z,
+                         Rows[0].z * normal.x + Rows[1].z * normal.y + Rows[2].z * normal.z);
+    }
+
+    // The direction is not renormalized, so a hit distance along the result is the same distance along ray
+    Ray TransformRay(const Ray &ray) const
+    {
+        Ray transformed;
+        transformed.Origin = TransformPoint(ray.Origin);
+        transformed.Direction = TransformVector(ray.Direction);
+        return transformed;
+    }
+
+    // Box around the eight transformed corners, computed per axis from the row magnitudes
+    AABB TransformBounds(const AABB &bounds) const
+    {
+        if (bounds.IsEmpty())
+            return bounds;
+
+        glm::vec3 center = TransformPoint(bounds.GetCenter());
+        glm::vec3 halfExtent = (bounds.Max - bounds.Min) * 0.5f;
+        glm::vec3 extent(std::abs(Rows[0].x) * halfExtent.x + std::abs(Rows[0].y) * halfExtent.y + std::abs(Rows[0].z) * halfExtent.z,
+                         std::abs(Rows[1].x) * halfExtent.x + std::abs(Rows[1].y) * halfExtent.y + std::abs(Rows[1].z) * halfExtent.z,
+                         std::abs(Rows[2].x) * halfExtent.x + std::abs(Rows[2].y) * halfExtent.y + std::abs(Rows[2].z) * halfExtent.z);
+
+        AABB transformed;
+        transformed.Min = center - extent;
+        transformed.Max = center + extent;
+        return transformed;
+    }
+
+    // Singular transforms (a zero scale) have no inverse and come back as the identity
+    Transform Inverse() const
+    {
+        glm::vec3 r0(Rows[0].x, Rows[0].y, Rows[0].z);
+        glm::vec3 r1(Rows[1].x, Rows[1].y, Rows[1].z);
+        glm::vec3 r2(Rows[2].x, Rows[2].y, Rows[2].z);
+
+        // Rows of the inverse of the 3x3 part are the cross products of its columns over the determinant
+        glm::vec3 c0(r0.x, r1.x, r2.x);
+        glm::vec3 c1(r0.y, r1.y, r2.y);
+        glm::vec3 c2(r0.z, r1.z, r2.z);
+        float determinant = glm::dot(c0, glm::cross(c1, c2));
+        if (std::abs(determinant) < 1e-12f)
+            return Transform();
+
+        float invDeterminant = 1.0f / determinant;
+        glm::vec3 inverseRows[3] = {glm::cross(c1, c2) * invDeterminant,
+                                    glm::cross(c2, c0) * invDeterminant,
+                                    glm::cross(c0, c1) * invDeterminant};
+
+        glm::vec3 translation = GetTranslation();
+        Transform inverse;
+        for (int i = 0; i < 3; i++)
+            inverse.Rows[i] = glm::vec4(inverseRows[i], -glm::dot(inverseRows[i], translation));
+        return inverse;
+    }
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#define GL_SILENCE_DEPRECATION
+#include <glm/glm.hpp>
+#include <vector>
+#include "Random.h"
+#include "Ray.h"
+#include "Tracer.h"
+
+// Breadth-first alternative to RayGun: instead of following one pixel's path to the end, every stage
+// (trace, compact, shadow rays, shade) runs over the whole stream of live paths before the next one starts,
+// so each kernel stays hot in cache. Draws the same samples as RayGun and gives the same image.
+class WavefrontIntegrator
+{
+public:
+    using Stats = Tracer::WavefrontStats;
+
+    // Paths in flight at once, the frame is split into waves of whole rows that fit in this budget
+    static constexpr glm::uint32 MaxWaveSize = 1 << 20;
+
+    void Render(Tracer &tracer, glm::uint32 *data);
+
+    const Stats &GetStats() const { return stats; }
+
+private:
+    struct PathState
+    {
+        Ray CurrentRay;
+        glm::vec3 Color{0.0f};
+        float Multiplier = 1.0f;
+        Sampler PathSampler;
+    };
+
+    void GeneratePrimary(Tracer &tracer, glm::uint32 firstRow, glm::uint32 rowCount);
+    void TraceActive(Tracer &tracer);
+    void Compact(Tracer &tracer);
+    void SortByMaterial(Tracer &tracer);
+    void TraceShadows(Tracer &tracer, glm::uint32 bounce);
+    void Shade(Tracer &tracer, glm::uint32 bounce);
+    void Retire();
+    void Write(Tracer &tracer, glm::uint32 firstRow, glm::uint32 rowCount, glm::uint32 *data);
+
+private:
+    // Indexed by path, path i of a wave is pixel firstRow * width + i
+    std::vector<PathState> paths;
+    std::vector<Tracer::HitPayload> hits;
+
+    // Live paths, rebuilt by Compact after every trace
+    std::vector<glm::uint32> active;
+    std::vector<glm::uint32> sorted;
+    std::vector<glm::uint32> materialOffsets;
+
+    // One entry per live path and shadow ray (Tracer::GetShadowRaysPerHit), in active order
+    std::vector<int> shadowLights; // -1 when light sampling found none that contributes
+    std::vector<float> shadowWeights;
+    std::vector<Ray> shadowRays;
+    std::vector<float> shadowDistances;
+    std::vector<unsigned char> occluded;
+
+    Stats stats;
+};
@@ -0,0 +1,86 @@
+#pragma once
+
+#define GL_SILENCE_DEPRECATION
+#include <glm/glm.hpp>
+#include <type_traits>
+#include <vector>
+#include "BVH.h"
+#include "SIMD.h"
+
+// Child boxes of a wide node as plain floats, one array per bound so a SIMD load covers Lanes children
+template <glm::uint32 Lanes>
+struct alignas(SIMD::Alignment) WideNode
+{
+    float MinX[Lanes], MinY[Lanes], MinZ[Lanes];
+    float MaxX[Lanes], MaxY[Lanes], MaxZ[Lanes];
+    glm::uint32 Child[Lanes]; // Node index for inner children, first primitive for leaves
+    glm::uint32 Count[Lanes]; // Primitives in a leaf child, 0 for inner children
+    glm::uint32 ChildCount = 0;
+};
+
+// Child boxes as 8-bit steps on a grid over the node's own box, one power-of-two step per axis:
+// a bound q on axis a sits at Origin[a] + q * 2^(Exponent[a] - 127). Bounds are rounded outwards, so the decoded
+// box always contains the child. 128 bytes for 8 lanes against 288 for WideNode
+template <glm::uint32 Lanes>
+struct alignas(SIMD::Alignment) QuantizedWideNode
+{
+    float Origin[3];
+    glm::uint8 Exponent[3]; // Biased like a float exponent, always a normal float
+    glm::uint8 ChildCount = 0;
+    glm::uint8 MinX[Lanes], MinY[Lanes], MinZ[Lanes];
+    glm::uint8 MaxX[Lanes], MaxY[Lanes], MaxZ[Lanes];
+    glm::uint32 Child[Lanes];
+    glm::uint32 Count[Lanes];
+};
+
+// N-ary BVH collapsed from the binary BVH, every node keeps the boxes of its N children side by side
+// so one SIMD slab test covers all of them. Leaves are stored inline in their parent's child slots
+// and index the same sphere ranges as the binary tree they came from.
+// Quantized trees store QuantizedWideNode instead and decode the child boxes inside the slab test.
+template <glm::uint32 N, bool Quantized = false>
+class WideBVH
+{
+public:
+    // A BVH4 on AVX2 still loads a whole 8-wide vector, the spare slots are never valid children
+    static constexpr glm::uint32 Lanes = N > SIMD::Width ? N : SIMD::Width;
+
+    using Node = std::conditional_t<Quantized, QuantizedWideNode<Lanes>, WideNode<Lanes>>;
+    struct BuildStats
+    {
+        float BuildTimeMs = 0.0f;
+        glm::uint32 NodeCount = 0;
+        glm::uint32 LeafCount = 0;
+        glm::uint32 MaxDepth = 0;
+    };
+
+    // Keeps a pointer to the scene the binary tree was built over, both must outlive this tree
+    void Build(const BVH &binary);
+    // Encodes again the nodes holding a child whose bounds binary changed in its last Refit
+    void Refit(const BVH &binary);
+
+    // Same contracts as the binary BVH queries
+    bool Intersect(const Ray &ray, float &hitDistance, int &objectIndex) const;
+    bool AnyHit(const Ray &ray, float tMin, float tMax) const;
+    void IntersectPacket(RayPacket &packet) const;
+
+    const BuildStats &GetStats() const { return stats; }
+    size_t GetMemorySize() const { return nodes.size() * sizeof(Node); }
+
+private:
+    void Collapse(const std::vector<BVH::Node> &binaryNodes, glm::uint32 binaryIndex, glm::uint32 nodeIndex, glm::uint32 depth);
+    void EncodeNode(const std::vector<BVH::Node> &binaryNodes, glm::uint32 nodeIndex);
+
+private:
+    std::vector<Node> nodes;
+    std::vector<glm::uint32> binarySlots; // Binary node -> nodeIndex * Lanes + lane of the slot holding it, or ~0
+    std::vector<glm::uint32> slotBinaries; // The other way round, nodeIndex * Lanes + lane -> binary node
+
+    const CompiledScene *scene = nullptr;
+
+    BuildStats stats;
+};
+
+using BVH4 = WideBVH<4>;
+using BVH8 = WideBVH<8>;
+using QuantizedBVH4 = WideBVH<4, true>;
+using QuantizedBVH8 = WideBVH<8, true>;
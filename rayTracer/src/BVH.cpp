@@ -0,0 +1,989 @@
+#include "BVH.h"
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <functional>
+#include <type_traits>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_invoke.h>
+#include <tbb/parallel_reduce.h>
+
+namespace
+{
+    constexpr float TraversalCost = 1.0f;
+    constexpr float IntersectionCost = 1.0f;
+    constexpr glm::uint32 NoParent = ~0u;
+
+    // Below these sizes the work is not worth a task
+    constexpr glm::uint32 ParallelBinningThreshold = 1 << 16;
+    constexpr glm::uint32 ParallelSubtreeThreshold = 1 << 12;
+    constexpr size_t BinningGrainSize = 1 << 13;
+    constexpr size_t RadixGrainSize = 1 << 14;
+    // The LBVH sorts 30-bit Morton codes, half the bytes and passes of 63-bit ones, unless more than this share
+    // of the sorted codes repeat their neighbour; then it starts over with 63-bit codes so dense clusters still split
+    constexpr float MaxDuplicateCodeShare = 1.0f / 16.0f;
+
+    bool SameBounds(const AABB &a, const AABB &b)
+    {
+        return a.Min == b.Min && a.Max == b.Max;
+    }
+
+    // Maps centroids to the BinCount equal slices of the centroid bounds on one axis
+    struct BinMapping
+    {
+        float Min;
+        float Scale;
+
+        // Flat axes map everything to bin 0 instead of dividing by zero
+        BinMapping(const AABB &centroidBounds, int axis)
+            : Min(centroidBounds.Min[axis]), Scale(0.0f)
+        {
+            float extent = centroidBounds.Max[axis] - centroidBounds.Min[axis];
+            if (extent > 0.0f)
+                Scale = BVH::BinCount / extent;
+        }
+
+        glm::uint32 GetBin(float centroid) const
+        {
+            int bin = (int)((centroid - Min) * Scale);
+            return (glm::uint32)std::clamp(bin, 0, (int)BVH::BinCount - 1);
+        }
+    };
+}
+
+namespace
+{
+    template <typename Key>
+    struct MortonRef
+    {
+        Key Code;
+        glm::uint32 Index;
+    };
+
+    template <typename Key>
+    constexpr int MortonBitsPerAxis = std::is_same<Key, glm::uint64>::value ? 21 : 10;
+
+    // Spreads the low bits of value so two zero bits separate each of them
+    glm::uint32 ExpandBits(glm::uint32 value)
+    {
+        value &= 0x3ff;
+        value = (value | (value << 16)) & 0x030000ff;
+        value = (value | (value << 8)) & 0x0300f00f;
+        value = (value | (value << 4)) & 0x030c30c3;
+        value = (value | (value << 2)) & 0x09249249;
+        return value;
+    }
+
+    glm::uint64 ExpandBits(glm::uint64 value)
+    {
+        value &= 0x1fffff;
+        value = (value | (value << 32)) & 0x001f00000000ffffull;
+        value = (value | (value << 16)) & 0x001f0000ff0000ffull;
+        value = (value | (value << 8)) & 0x100f00f00f00f00full;
+        value = (value | (value << 4)) & 0x10c30c30c30c30c3ull;
+        value = (value | (value << 2)) & 0x1249249249249249ull;
+        return value;
+    }
+
+    // position is the centroid scaled to [0, 1] inside the centroid bounds
+    template <typename Key>
+    Key EncodeMorton(const glm::vec3 &position)
+    {
+        constexpr float Cells = (float)(1u << MortonBitsPerAxis<Key>);
+        Key cell[3];
+        for (int axis = 0; axis < 3; axis++)
+            cell[axis] = (Key)std::clamp(position[axis] * Cells, 0.0f, Cells - 1.0f);
+        return (ExpandBits(cell[0]) << 2) | (ExpandBits(cell[1]) << 1) | ExpandBits(cell[2]);
+    }
+
+    int CountLeadingZeros(glm::uint32 value) { return value == 0 ? 32 : __builtin_clz(value); }
+    int CountLeadingZeros(glm::uint64 value) { return value == 0 ? 64 : __builtin_clzll(value); }
+
+    // Stable LSD radix sort, 8 bits per pass. Every chunk histograms its slice, the offsets are scanned digit by digit
+    // across chunks, and every chunk scatters its slice into place. Passes where all keys share the digit are skipped.
+    template <typename Key>
+    void RadixSort(std::vector<MortonRef<Key>> &items, std::vector<MortonRef<Key>> &scratch, int keyBits)
+    {
+        constexpr int DigitBits = 8;
+        constexpr size_t BucketCount = 1 << DigitBits;
+
+        size_t count = items.size();
+        size_t chunkCount = std::max<size_t>(1, (count + RadixGrainSize - 1) / RadixGrainSize);
+        size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+        std::vector<size_t> offsets(chunkCount * BucketCount);
+        scratch.resize(count);
+
+        for (int shift = 0; shift < keyBits; shift += DigitBits)
+        {
+            tbb::parallel_for(size_t(0), chunkCount, [&](size_t chunk)
+                              {
+                                  size_t *histogram = &offsets[chunk * BucketCount];
+                                  std::fill(histogram, histogram + BucketCount, 0);
+                                  size_t end = std::min(count, (chunk + 1) * chunkSize);
+                                  for (size_t i = chunk * chunkSize; i < end; i++)
+                                      histogram[(items[i].Code >> shift) & (BucketCount - 1)]++;
+                              });
+
+            size_t sum = 0;
+            bool allInOneBucket = false;
+            for (size_t digit = 0; digit < BucketCount && !allInOneBucket; digit++)
+            {
+                size_t digitStart = sum;
+                for (size_t chunk = 0; chunk < chunkCount; chunk++)
+                {
+                    size_t &offset = offsets[chunk * BucketCount + digit];
+                    size_t chunkItems = offset;
+                    offset = sum;
+                    sum += chunkItems;
+                }
+                allInOneBucket = sum - digitStart == count;
+            }
+            if (allInOneBucket)
+                continue;
+
+            tbb::parallel_for(size_t(0), chunkCount, [&](size_t chunk)
+                              {
+                                  size_t *offset = &offsets[chunk * BucketCount];
+                                  size_t end = std::min(count, (chunk + 1) * chunkSize);
+                                  for (size_t i = chunk * chunkSize; i < end; i++)
+                                      scratch[offset[(items[i].Code >> shift) & (BucketCount - 1)]++] = items[i];
+                              });
+            items.swap(scratch);
+        }
+    }
+
+    // Length of the common prefix of the codes at positions i and j, or -1 when j is out of range;
+    // equal codes fall back to comparing the positions so every key is unique
+    template <typename Key>
+    int CommonPrefix(const std::vector<MortonRef<Key>> &items, glm::int64 i, glm::int64 j)
+    {
+        if (j < 0 || j >= (glm::int64)items.size())
+            return -1;
+        Key a = items[i].Code;
+        Key b = items[j].Code;
+        if (a != b)
+            return CountLeadingZeros(a ^ b);
+        return (int)sizeof(Key) * 8 + CountLeadingZeros((glm::uint32)i ^ (glm::uint32)j);
+    }
+
+    // Karras, "Maximizing Parallelism in the Construction of BVHs, Octrees, and k-d Trees" (2012): internal node i
+    // covers the sorted range that starts or ends at i and shares a longer prefix than its neighbour on the other
+    // side. Returns the last position of its left child, the left child is internal node split unless it is a
+    // single primitive, the right child internal node split + 1 likewise.
+    template <typename Key>
+    glm::uint32 FindLinearSplit(const std::vector<MortonRef<Key>> &items, glm::int64 i)
+    {
+        int direction = CommonPrefix(items, i, i + 1) > CommonPrefix(items, i, i - 1) ? 1 : -1;
+        int minPrefix = CommonPrefix(items, i, i - direction);
+
+        // Exponential then binary search for the other end of the range
+        glm::int64 maxLength = 2;
+        while (CommonPrefix(items, i, i + maxLength * direction) > minPrefix)
+            maxLength *= 2;
+        glm::int64 length = 0;
+        for (glm::int64 step = maxLength / 2; step >= 1; step /= 2)
+        {
+            if (CommonPrefix(items, i, i + (length + step) * direction) > minPrefix)
+                length += step;
+        }
+        glm::int64 j = i + length * direction;
+
+        // Binary search for the highest differing bit inside the range
+        int nodePrefix = CommonPrefix(items, i, j);
+        glm::int64 split = 0;
+        for (glm::int64 divisor = 2, step = (length + 1) / 2; ; divisor *= 2, step = (length + divisor - 1) / divisor)
+        {
+            if (CommonPrefix(items, i, i + (split + step) * direction) > nodePrefix)
+                split += step;
+            if (step <= 1)
+                break;
+        }
+        return (glm::uint32)(i + split * direction + std::min(direction, 0));
+    }
+}
+
+struct BVH::Bins
+{
+    AABB Bounds[3][BinCount];
+    glm::uint32 Count[3][BinCount] = {};
+
+    void Merge(const Bins &other)
+    {
+        for (int axis = 0; axis < 3; axis++)
+        {
+            for (glm::uint32 bin = 0; bin < BinCount; bin++)
+            {
+                Bounds[axis][bin].Grow(other.Bounds[axis][bin]);
+                Count[axis][bin] += other.Count[axis][bin];
+            }
+        }
+    }
+};
+
+struct BVH::BinnedSplit
+{
+    int Axis = -1;
+    glm::uint32 Bin = 0; // First bin of the right child
+    float Cost = std::numeric_limits<float>::max();
+    glm::uint32 LeftCount = 0;
+    AABB LeftBounds, RightBounds;
+};
+
+void BVH::Build(CompiledScene &scene, BVHBuilder builder)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    this->scene = &scene;
+    primitiveIndices.clear();
+    BuildTree((glm::uint32)scene.GetSpheres().Size(), [&scene](glm::uint32 i)
+              { return scene.GetSphereBounds(i); }, builder);
+
+    // Leaves index the sphere arrays directly, so store them in leaf order
+    if (!references.empty())
+    {
+        std::vector<glm::uint32> order(references.size());
+        for (size_t i = 0; i < references.size(); i++)
+            order[i] = references[i].PrimitiveIndex;
+        scene.PermuteSpheres(order);
+    }
+
+    FinishBuild((glm::uint32)references.size(), builder, start);
+}
+
+void BVH::Build(const std::vector<AABB> &primitiveBounds, BVHBuilder builder)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    scene = nullptr;
+    BuildTree((glm::uint32)primitiveBounds.size(), [&primitiveBounds](glm::uint32 i)
+              { return primitiveBounds[i]; }, builder);
+
+    primitiveIndices.resize(references.size());
+    for (size_t i = 0; i < references.size(); i++)
+        primitiveIndices[i] = references[i].PrimitiveIndex;
+
+    FinishBuild((glm::uint32)references.size(), builder, start);
+}
+
+bool BVH::Restore(CompiledScene &scene, const Node *savedNodes, size_t nodeCount, BVHBuilder builder)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    this->scene = &scene;
+    primitiveIndices.clear();
+    glm::uint32 primitiveCount = (glm::uint32)scene.GetSpheres().Size();
+    if (!RestoreNodes(primitiveCount, savedNodes, nodeCount))
+        return false;
+
+    FinishBuild(primitiveCount, builder, start);
+    return true;
+}
+
+bool BVH::Restore(glm::uint32 primitiveCount, const Node *savedNodes, size_t nodeCount, BVHBuilder builder)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    scene = nullptr;
+    if (!RestoreNodes(primitiveCount, savedNodes, nodeCount))
+        return false;
+
+    primitiveIndices.resize(primitiveCount);
+    for (glm::uint32 i = 0; i < primitiveCount; i++)
+        primitiveIndices[i] = i;
+
+    FinishBuild(primitiveCount, builder, start);
+    return true;
+}
+
+// Children must come after their parent, FinishBuild relies on it, and no deeper than the fixed traversal stacks
+bool BVH::RestoreNodes(glm::uint32 primitiveCount, const Node *savedNodes, size_t nodeCount)
+{
+    stats = BuildStats();
+    references.clear();
+    nodes.clear();
+    if ((nodeCount == 0) != (primitiveCount == 0))
+        return false;
+
+    std::vector<glm::uint32> depths(nodeCount, 0);
+    for (size_t i = 0; i < nodeCount; i++)
+    {
+        const Node &node = savedNodes[i];
+        if (node.IsLeaf())
+        {
+            if ((size_t)node.LeftFirst + node.Count > primitiveCount)
+                return false;
+            continue;
+        }
+        if (node.LeftFirst <= i || (size_t)node.LeftFirst + 1 >= nodeCount || depths[i] >= MaxDepth)
+            return false;
+        depths[node.LeftFirst] = depths[node.LeftFirst + 1] = depths[i] + 1;
+    }
+
+    nodes.assign(savedNodes, savedNodes + nodeCount);
+    return true;
+}
+
+template <typename GetBounds>
+void BVH::BuildTree(glm::uint32 primitiveCount, const GetBounds &getBounds, BVHBuilder builder)
+{
+    stats = BuildStats();
+    references.resize(primitiveCount);
+    if (primitiveCount == 0)
+    {
+        nodes.clear();
+        return;
+    }
+
+    // A binary tree over n primitives never needs more than 2n - 1 nodes, allocating them all up front
+    // lets subtrees built by different tasks claim node pairs with one atomic add. Every claimed node is
+    // written in full, so the ones kept from the last build are not reset.
+    nodes.resize(references.size() * 2 - 1);
+    std::atomic<glm::uint32> nodeCount{1};
+
+    Node &root = nodes[0];
+    root.LeftFirst = 0;
+    root.Count = (glm::uint32)references.size();
+
+    using BoundsPair = std::pair<AABB, AABB>;
+    BoundsPair rootBounds = tbb::parallel_reduce(
+        tbb::blocked_range<size_t>(0, references.size(), BinningGrainSize), BoundsPair(),
+        [&](const tbb::blocked_range<size_t> &range, BoundsPair bounds)
+        {
+            for (size_t i = range.begin(); i != range.end(); i++)
+            {
+                PrimitiveRef &ref = references[i];
+                ref.Bounds = getBounds((glm::uint32)i);
+                ref.Centroid = ref.Bounds.GetCenter();
+                ref.PrimitiveIndex = (glm::uint32)i;
+                bounds.first.Grow(ref.Bounds);
+                bounds.second.Grow(ref.Centroid);
+            }
+            return bounds;
+        },
+        [](BoundsPair a, const BoundsPair &b)
+        {
+            a.first.Grow(b.first);
+            a.second.Grow(b.second);
+            return a;
+        });
+    root.Bounds = rootBounds.first;
+    if (builder == BVHBuilder::LBVH)
+    {
+        if (!BuildLinear<glm::uint32>(rootBounds.second, nodeCount))
+            BuildLinear<glm::uint64>(rootBounds.second, nodeCount);
+    }
+    else
+    {
+        Subdivide(0, rootBounds.second, 0, nodeCount);
+    }
+    nodes.resize(nodeCount);
+}
+
+void BVH::FinishBuild(glm::uint32 primitiveCount, BVHBuilder builder, std::chrono::high_resolution_clock::time_point start)
+{
+    // Children are always allocated after their parent, so one forward pass sees every parent first
+    std::vector<glm::uint32> depths(nodes.size(), 0);
+    parents.assign(nodes.size(), NoParent);
+    sphereLeaves.assign(primitiveCount, 0);
+    refitted.assign(nodes.size(), 0);
+    refittedNodes.clear();
+    weightedAreaSum = 0.0;
+    for (glm::uint32 i = 0; i < (glm::uint32)nodes.size(); i++)
+    {
+        const Node &node = nodes[i];
+        weightedAreaSum += (double)GetNodeCost(node) * node.Bounds.GetSurfaceArea();
+        stats.MaxDepth = std::max(stats.MaxDepth, depths[i]);
+        if (node.IsLeaf())
+        {
+            stats.LeafCount++;
+            for (glm::uint32 j = 0; j < node.Count; j++)
+                sphereLeaves[node.LeftFirst + j] = i;
+        }
+        else
+        {
+            parents[node.LeftFirst] = i;
+            parents[node.LeftFirst + 1] = i;
+            depths[node.LeftFirst] = depths[node.LeftFirst + 1] = depths[i] + 1;
+        }
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+
+    stats.Builder = builder;
+    stats.BuildTimeMs = std::chrono::duration<float, std::milli>(end - start).count();
+    stats.NodeCount = (glm::uint32)nodes.size();
+    stats.BoundedCount = primitiveCount;
+    stats.UnboundedCount = scene ? (glm::uint32)scene->GetPlanes().Size() : 0;
+    stats.SAHCost = ComputeSAHCost();
+    stats.BuildSAHCost = stats.SAHCost;
+}
+
+bool BVH::Refit(const std::vector<glm::uint32> &sphereSlots)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    for (glm::uint32 node : refittedNodes)
+        refitted[node] = 0;
+    refittedNodes.clear();
+    if (nodes.empty() || scene == nullptr)
+        return true;
+
+    // Leaves first, so every walk up below sees final bounds on the other dirty paths
+    for (glm::uint32 slot : sphereSlots)
+    {
+        if (slot >= sphereLeaves.size())
+            continue;
+        glm::uint32 leaf = sphereLeaves[slot];
+        if (refitted[leaf])
+            continue;
+
+        AABB bounds;
+        for (glm::uint32 i = 0; i < nodes[leaf].Count; i++)
+            bounds.Grow(scene->GetSphereBounds(nodes[leaf].LeftFirst + i));
+        SetNodeBounds(leaf, bounds);
+    }
+
+    // Walk up from every changed leaf until a parent comes out unchanged, then everything above it is current too
+    size_t leafCount = refittedNodes.size();
+    for (size_t i = 0; i < leafCount; i++)
+    {
+        for (glm::uint32 parent = parents[refittedNodes[i]]; parent != NoParent; parent = parents[parent])
+        {
+            const Node &node = nodes[parent];
+            AABB bounds = nodes[node.LeftFirst].Bounds;
+            bounds.Grow(nodes[node.LeftFirst + 1].Bounds);
+            if (SameBounds(bounds, node.Bounds))
+                break;
+            SetNodeBounds(parent, bounds);
+        }
+    }
+
+    float rootArea = nodes[0].Bounds.GetSurfaceArea();
+    stats.SAHCost = rootArea > 0.0f ? (float)(weightedAreaSum / rootArea) : 0.0f;
+    stats.RefitCount++;
+
+    auto end = std::chrono::high_resolution_clock::now();
+    stats.RefitTimeMs = std::chrono::duration<float, std::milli>(end - start).count();
+
+    return stats.SAHCost <= stats.BuildSAHCost * (1.0f + MaxSAHGrowth);
+}
+
+void BVH::SetNodeBounds(glm::uint32 nodeIndex, const AABB &bounds)
+{
+    Node &node = nodes[nodeIndex];
+    float cost = GetNodeCost(node);
+    weightedAreaSum += (double)(bounds.GetSurfaceArea() - node.Bounds.GetSurfaceArea()) * cost;
+    node.Bounds = bounds;
+
+    if (!refitted[nodeIndex])
+    {
+        refitted[nodeIndex] = 1;
+        refittedNodes.push_back(nodeIndex);
+    }
+}
+
+void BVH::UpdateNodeBounds(glm::uint32 nodeIndex)
+{
+    Node &node = nodes[nodeIndex];
+    node.Bounds = AABB();
+    for (glm::uint32 i = 0; i < node.Count; i++)
+        node.Bounds.Grow(references[node.LeftFirst + i].Bounds);
+}
+
+float BVH::FindBestSplit(const Node &node, int &bestAxis, glm::uint32 &bestSplit)
+{
+    float bestCost = std::numeric_limits<float>::max();
+    auto first = references.begin() + node.LeftFirst;
+    auto last = first + node.Count;
+
+    float rightAreas[MaxSweepCount];
+    for (int axis = 0; axis < 3; axis++)
+    {
+        std::sort(first, last, [axis](const PrimitiveRef &a, const PrimitiveRef &b)
+                  { return a.Centroid[axis] < b.Centroid[axis]; });
+
+        // Sweep from the right to get the area of every suffix, then from the left to evaluate each split
+        AABB right;
+        for (glm::uint32 i = node.Count - 1; i > 0; i--)
+        {
+            right.Grow(first[i].Bounds);
+            rightAreas[i] = right.GetSurfaceArea();
+        }
+        AABB left;
+        for (glm::uint32 i = 1; i < node.Count; i++)
+        {
+            left.Grow(first[i - 1].Bounds);
+            float cost = left.GetSurfaceArea() * i + rightAreas[i] * (node.Count - i);
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = i;
+            }
+        }
+    }
+    return bestCost;
+}
+
+void BVH::BinReferences(const Node &node, const AABB &centroidBounds, Bins &bins) const
+{
+    BinMapping mappings[3] = {{centroidBounds, 0}, {centroidBounds, 1}, {centroidBounds, 2}};
+    auto binRange = [&](size_t begin, size_t end, Bins &target)
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            const PrimitiveRef &ref = references[i];
+            glm::uint32 binX = mappings[0].GetBin(ref.Centroid.x);
+            glm::uint32 binY = mappings[1].GetBin(ref.Centroid.y);
+            glm::uint32 binZ = mappings[2].GetBin(ref.Centroid.z);
+            target.Bounds[0][binX].Grow(ref.Bounds);
+            target.Bounds[1][binY].Grow(ref.Bounds);
+            target.Bounds[2][binZ].Grow(ref.Bounds);
+            target.Count[0][binX]++;
+            target.Count[1][binY]++;
+            target.Count[2][binZ]++;
+        }
+    };
+
+    size_t first = node.LeftFirst;
+    size_t last = first + node.Count;
+    if (node.Count < ParallelBinningThreshold)
+    {
+        binRange(first, last, bins);
+        return;
+    }
+
+    // Each chunk fills its own bins, the reduction merges them
+    bins = tbb::parallel_reduce(
+        tbb::blocked_range<size_t>(first, last, BinningGrainSize), Bins(),
+        [&](const tbb::blocked_range<size_t> &range, Bins partial)
+        {
+            binRange(range.begin(), range.end(), partial);
+            return partial;
+        },
+        [](Bins a, const Bins &b)
+        {
+            a.Merge(b);
+            return a;
+        });
+}
+
+bool BVH::FindBinnedSplit(const Node &node, const AABB &centroidBounds, BinnedSplit &split) const
+{
+    Bins bins;
+    BinReferences(node, centroidBounds, bins);
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        // All centroids in one plane, nothing to split on this axis
+        if (!(centroidBounds.Max[axis] > centroidBounds.Min[axis]))
+            continue;
+
+        float rightAreas[BinCount];
+        glm::uint32 rightCounts[BinCount];
+        AABB right;
+        glm::uint32 rightCount = 0;
+        for (glm::uint32 bin = BinCount - 1; bin > 0; bin--)
+        {
+            right.Grow(bins.Bounds[axis][bin]);
+            rightCount += bins.Count[axis][bin];
+            rightAreas[bin] = right.GetSurfaceArea();
+            rightCounts[bin] = rightCount;
+        }
+
+        AABB left;
+        glm::uint32 leftCount = 0;
+        for (glm::uint32 bin = 1; bin < BinCount; bin++)
+        {
+            left.Grow(bins.Bounds[axis][bin - 1]);
+            leftCount += bins.Count[axis][bin - 1];
+            if (leftCount == 0 || rightCounts[bin] == 0)
+                continue;
+
+            float cost = left.GetSurfaceArea() * leftCount + rightAreas[bin] * rightCounts[bin];
+            if (cost < split.Cost)
+            {
+                split.Cost = cost;
+                split.Axis = axis;
+                split.Bin = bin;
+                split.LeftCount = leftCount;
+            }
+        }
+    }
+    if (split.Axis < 0)
+        return false;
+
+    // Child bounds fall out of the bins, no extra pass over the primitives
+    split.LeftBounds = split.RightBounds = AABB();
+    for (glm::uint32 bin = 0; bin < BinCount; bin++)
+        (bin < split.Bin ? split.LeftBounds : split.RightBounds).Grow(bins.Bounds[split.Axis][bin]);
+    return true;
+}
+
+void BVH::Subdivide(glm::uint32 nodeIndex, const AABB &centroidBounds, glm::uint32 depth, std::atomic<glm::uint32> &nodeCount)
+{
+    Node &node = nodes[nodeIndex];
+    if (node.Count == 1 || depth >= MaxDepth)
+        return;
+
+    glm::uint32 first = node.LeftFirst;
+    glm::uint32 count = node.Count;
+    float parentArea = node.Bounds.GetSurfaceArea();
+    float leafCost = IntersectionCost * count;
+
+    glm::uint32 split = count / 2;
+    BinnedSplit binned;
+    bool useBins = count > MaxSweepCount;
+    float splitCost;
+    if (useBins)
+    {
+        // Identical centroids give no binned split, halving the range still bounds the leaf size
+        if (!FindBinnedSplit(node, centroidBounds, binned))
+            useBins = false;
+        splitCost = binned.Cost;
+    }
+    else
+    {
+        int axis = 0;
+        splitCost = FindBestSplit(node, axis, split);
+
+        // The sweep leaves the range sorted on the last axis
+        if (axis != 2)
+        {
+            std::sort(references.begin() + first, references.begin() + first + count,
+                      [axis](const PrimitiveRef &a, const PrimitiveRef &b)
+                      { return a.Centroid[axis] < b.Centroid[axis]; });
+        }
+    }
+
+    // Surface area heuristic, both costs relative to the probability of hitting this node
+    splitCost = parentArea > 0.0f ? TraversalCost + IntersectionCost * splitCost / parentArea : leafCost;
+    if (splitCost >= leafCost && count <= MaxLeafSize)
+        return;
+
+    AABB leftCentroids, rightCentroids;
+    if (useBins)
+    {
+        // Two-pointer partition by bin, gathering the children's centroid bounds on the way
+        BinMapping mapping(centroidBounds, binned.Axis);
+        int axis = binned.Axis;
+        glm::uint32 left = first;
+        glm::uint32 right = first + count;
+        while (left < right)
+        {
+            const glm::vec3 &centroid = references[left].Centroid;
+            if (mapping.GetBin(centroid[axis]) < binned.Bin)
+            {
+                leftCentroids.Grow(centroid);
+                left++;
+            }
+            else
+            {
+                rightCentroids.Grow(centroid);
+                std::swap(references[left], references[--right]);
+            }
+        }
+        split = binned.LeftCount;
+    }
+
+    glm::uint32 leftIndex = nodeCount.fetch_add(2);
+    Node &leftChild = nodes[leftIndex];
+    leftChild.LeftFirst = first;
+    leftChild.Count = split;
+    Node &rightChild = nodes[leftIndex + 1];
+    rightChild.LeftFirst = first + split;
+    rightChild.Count = count - split;
+
+    node.LeftFirst = leftIndex;
+    node.Count = 0;
+
+    if (useBins)
+    {
+        leftChild.Bounds = binned.LeftBounds;
+        rightChild.Bounds = binned.RightBounds;
+    }
+    else
+    {
+        // Only the sweep and the degenerate fallback get here, both on ranges small enough or rare enough to rescan
+        UpdateNodeBounds(leftIndex);
+        UpdateNodeBounds(leftIndex + 1);
+        for (glm::uint32 i = 0; i < split; i++)
+            leftCentroids.Grow(references[first + i].Centroid);
+        for (glm::uint32 i = split; i < count; i++)
+            rightCentroids.Grow(references[first + i].Centroid);
+    }
+
+    if (count >= ParallelSubtreeThreshold)
+    {
+        tbb::parallel_invoke([&]
+                             { Subdivide(leftIndex, leftCentroids, depth + 1, nodeCount); },
+                             [&]
+                             { Subdivide(leftIndex + 1, rightCentroids, depth + 1, nodeCount); });
+    }
+    else
+    {
+        Subdivide(leftIndex, leftCentroids, depth + 1, nodeCount);
+        Subdivide(leftIndex + 1, rightCentroids, depth + 1, nodeCount);
+    }
+}
+
+template <typename Key>
+bool BVH::BuildLinear(const AABB &centroidBounds, std::atomic<glm::uint32> &nodeCount)
+{
+    size_t count = references.size();
+    glm::vec3 extent = centroidBounds.Max - centroidBounds.Min;
+    glm::vec3 scale(extent.x > 0.0f ? 1.0f / extent.x : 0.0f,
+                    extent.y > 0.0f ? 1.0f / extent.y : 0.0f,
+                    extent.z > 0.0f ? 1.0f / extent.z : 0.0f);
+
+    std::vector<MortonRef<Key>> items(count), scratch;
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, count, BinningGrainSize),
+                      [&](const tbb::blocked_range<size_t> &range)
+                      {
+                          for (size_t i = range.begin(); i != range.end(); i++)
+                          {
+                              items[i].Code = EncodeMorton<Key>((references[i].Centroid - centroidBounds.Min) * scale);
+                              items[i].Index = (glm::uint32)i;
+                          }
+                      });
+    RadixSort(items, scratch, 3 * MortonBitsPerAxis<Key>);
+
+    if (std::is_same<Key, glm::uint32>::value)
+    {
+        size_t duplicates = tbb::parallel_reduce(
+            tbb::blocked_range<size_t>(1, std::max<size_t>(count, 1), BinningGrainSize), size_t(0),
+            [&](const tbb::blocked_range<size_t> &range, size_t partial)
+            {
+                for (size_t i = range.begin(); i != range.end(); i++)
+                    partial += items[i].Code == items[i - 1].Code;
+                return partial;
+            },
+            std::plus<size_t>());
+        if (duplicates > count * MaxDuplicateCodeShare)
+            return false;
+    }
+
+    // Leaves cover runs of the sorted order, so put the references in that order
+    std::vector<PrimitiveRef> sorted(count);
+    std::vector<glm::uint32> splits(count - 1);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, count, BinningGrainSize),
+                      [&](const tbb::blocked_range<size_t> &range)
+                      {
+                          for (size_t i = range.begin(); i != range.end(); i++)
+                          {
+                              sorted[i] = references[items[i].Index];
+                              if (i + 1 < count)
+                                  splits[i] = FindLinearSplit(items, (glm::int64)i);
+                          }
+                      });
+    references.swap(sorted);
+
+    EmitLinear(0, splits, 0, 0, (glm::uint32)count - 1, 0, nodeCount);
+    return true;
+}
+
+// Walks the Karras hierarchy from internal node internalIndex, which covers [first, last], and writes it into
+// nodes in the same child-pair layout Subdivide produces. Small ranges become leaves; bounds come back up.
+AABB BVH::EmitLinear(glm::uint32 nodeIndex, const std::vector<glm::uint32> &splits, glm::uint32 internalIndex,
+                     glm::uint32 first, glm::uint32 last, glm::uint32 depth, std::atomic<glm::uint32> &nodeCount)
+{
+    Node &node = nodes[nodeIndex];
+    glm::uint32 count = last - first + 1;
+    if (count <= MaxLinearLeafSize || depth >= MaxDepth)
+    {
+        node.LeftFirst = first;
+        node.Count = count;
+        node.Bounds = AABB();
+        for (glm::uint32 i = first; i <= last; i++)
+            node.Bounds.Grow(references[i].Bounds);
+        return node.Bounds;
+    }
+
+    glm::uint32 split = splits[internalIndex];
+    glm::uint32 leftIndex = nodeCount.fetch_add(2);
+    node.LeftFirst = leftIndex;
+    node.Count = 0;
+
+    AABB left, right;
+    if (count >= ParallelSubtreeThreshold)
+    {
+        tbb::parallel_invoke([&]
+                             { left = EmitLinear(leftIndex, splits, split, first, split, depth + 1, nodeCount); },
+                             [&]
+                             { right = EmitLinear(leftIndex + 1, splits, split + 1, split + 1, last, depth + 1, nodeCount); });
+    }
+    else
+    {
+        left = EmitLinear(leftIndex, splits, split, first, split, depth + 1, nodeCount);
+        right = EmitLinear(leftIndex + 1, splits, split + 1, split + 1, last, depth + 1, nodeCount);
+    }
+
+    node.Bounds = left;
+    node.Bounds.Grow(right);
+    return node.Bounds;
+}
+
+float BVH::ComputeSAHCost() const
+{
+    if (nodes.empty())
+        return 0.0f;
+
+    float rootArea = nodes[0].Bounds.GetSurfaceArea();
+    if (rootArea <= 0.0f)
+        return 0.0f;
+
+    float cost = 0.0f;
+    for (const Node &node : nodes)
+        cost += GetNodeCost(node) * node.Bounds.GetSurfaceArea() / rootArea;
+    return cost;
+}
+
+float BVH::GetNodeCost(const Node &node) const
+{
+    return node.IsLeaf() ? IntersectionCost * node.Count : TraversalCost;
+}
+
+bool BVH::Intersect(const Ray &ray, float &hitDistance, int &objectIndex) const
+{
+    hitDistance = std::numeric_limits<float>::max();
+    objectIndex = -1;
+    return IntersectCloser(ray, hitDistance, objectIndex);
+}
+
+bool BVH::IntersectCloser(const Ray &ray, float &hitDistance, int &objectIndex) const
+{
+    if (scene == nullptr)
+        return false;
+
+    // Unbounded shapes first, a plane hit usually gives a tight upper bound for the tree walk
+    float incomingDistance = hitDistance;
+    scene->IntersectPlanes(ray, hitDistance, objectIndex);
+
+    if (nodes.empty())
+        return hitDistance < incomingDistance;
+
+    struct StackEntry
+    {
+        glm::uint32 Node;
+        float Distance;
+    };
+    StackEntry stack[MaxDepth + 4];
+    int stackSize = 0;
+
+    glm::vec3 invDirection = 1.0f / ray.Direction;
+    float rootDistance = nodes[0].Bounds.Intersect(ray, invDirection, hitDistance);
+    if (rootDistance < hitDistance)
+        stack[stackSize++] = {0, rootDistance};
+
+    while (stackSize > 0)
+    {
+        StackEntry entry = stack[--stackSize];
+        if (entry.Distance >= hitDistance)
+            continue;
+
+        const Node &node = nodes[entry.Node];
+        if (node.IsLeaf())
+        {
+            scene->IntersectSpheres(ray, node.LeftFirst, node.Count, hitDistance, objectIndex);
+            continue;
+        }
+
+        // Visit the nearer child first so the far one is likely culled by the updated hit distance
+        glm::uint32 nearChild = node.LeftFirst;
+        glm::uint32 farChild = node.LeftFirst + 1;
+        float nearDistance = nodes[nearChild].Bounds.Intersect(ray, invDirection, hitDistance);
+        float farDistance = nodes[farChild].Bounds.Intersect(ray, invDirection, hitDistance);
+        if (farDistance < nearDistance)
+        {
+            std::swap(nearChild, farChild);
+            std::swap(nearDistance, farDistance);
+        }
+        if (farDistance < hitDistance)
+            stack[stackSize++] = {farChild, farDistance};
+        if (nearDistance < hitDistance)
+            stack[stackSize++] = {nearChild, nearDistance};
+    }
+
+    return hitDistance < incomingDistance;
+}
+
+bool BVH::AnyHit(const Ray &ray, float tMin, float tMax) const
+{
+    if (scene == nullptr)
+        return false;
+
+    if (scene->AnyHitPlanes(ray, tMin, tMax))
+        return true;
+
+    if (nodes.empty())
+        return false;
+
+    glm::uint32 stack[MaxDepth + 4];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+
+    // No ordering needed, any blocker ends the query
+    glm::vec3 invDirection = 1.0f / ray.Direction;
+    while (stackSize > 0)
+    {
+        const Node &node = nodes[stack[--stackSize]];
+        if (node.Bounds.Intersect(ray, invDirection, tMax) == std::numeric_limits<float>::max())
+            continue;
+
+        if (node.IsLeaf())
+        {
+            if (scene->AnyHitSpheres(ray, node.LeftFirst, node.Count, tMin, tMax))
+                return true;
+            continue;
+        }
+
+        stack[stackSize++] = node.LeftFirst + 1;
+        stack[stackSize++] = node.LeftFirst;
+    }
+
+    return false;
+}
+
+void BVH::IntersectPacket(RayPacket &packet) const
+{
+    if (scene == nullptr)
+        return;
+
+    scene->IntersectPlanes(packet);
+
+    if (nodes.empty())
+        return;
+
+    glm::uint32 stack[MaxDepth + 4];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+
+    // The centre ray decides the visiting order, it is representative enough for a coherent packet
+    Ray centerRay;
+    centerRay.Origin = packet.Origin;
+    centerRay.Direction = packet.GetDirection(packet.Size / 2);
+    glm::vec3 invDirection = 1.0f / centerRay.Direction;
+
+    while (stackSize > 0)
+    {
+        const Node &node = nodes[stack[--stackSize]];
+        if (!packet.HitsBounds(node.Bounds))
+            continue;
+
+        if (node.IsLeaf())
+        {
+            scene->IntersectSpheres(packet, node.LeftFirst, node.Count);
+            continue;
+        }
+
+        glm::uint32 nearChild = node.LeftFirst;
+        glm::uint32 farChild = node.LeftFirst + 1;
+        float nearDistance = nodes[nearChild].Bounds.Intersect(centerRay, invDirection, std::numeric_limits<float>::max());
+        float farDistance = nodes[farChild].Bounds.Intersect(centerRay, invDirection, std::numeric_limits<float>::max());
+        if (farDistance < nearDistance)
+            std::swap(nearChild, farChild);
+        stack[stackSize++] = farChild;
+        stack[stackSize++] = nearChild;
+    }
+}
@@ -1,94 +1,23 @@
 #include "Camera.h"
-#include "Window.h"
 #include <iostream>
 
-#define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtc/quaternion.hpp>
-#include <glm/gtx/quaternion.hpp>
 
-Camera::Camera(float verticalFOV, float nearClip, float farClip, Window &window)
-    : VerticalFOV(verticalFOV), NearClip(nearClip), FarClip(farClip), newWindow(window)
+Camera::Camera(float verticalFOV, float nearClip, float farClip)
+    : VerticalFOV(verticalFOV), NearClip(nearClip), FarClip(farClip)
 {
     ForwardDirection = glm::vec3(0, 0, -1);
     Position = glm::vec3(0, 0, 6);
+    RecalculateView();
 }
 
-bool Camera::OnUpdate(float ts)
+void Camera::SetView(const glm::vec3 &position, const glm::vec3 &direction)
 {
-    glm::vec2 mousePos = newWindow.GetMousePosition();
-    glm::vec2 delta = (mousePos - LastMousePosition) * 0.002f;
-    LastMousePosition = mousePos;
+    Position = position;
+    ForwardDirection = glm::normalize(direction);
 
-    if (!newWindow.IsMouseButtonDown(MouseButton::Right))
-    {
-        newWindow.SetCursorMode(CursorMode::Normal);
-        return false;
-    }
-
-    newWindow.SetCursorMode(CursorMode::Locked);
-
-    bool moved = false;
-
-    constexpr float upX = 0.0f;
-    constexpr float upY = 1.0f;
-    constexpr float upZ = 0.0f;
-    const glm::vec3 upDirection(upX, upY, upZ);
-    glm::vec3 rightDirection = glm::cross(ForwardDirection, upDirection);
-
-    float speed = 0.0003f;
-
-    // Movement
-    if (newWindow.IsKeyDown(KeyCode::W))
-    {
-        Position += ForwardDirection * speed * ts;
-        moved = true;
-    }
-    else if (newWindow.IsKeyDown(KeyCode::S))
-    {
-        Position -= ForwardDirection * speed * ts;
-        moved = true;
-    }
-    if (newWindow.IsKeyDown(KeyCode::A))
-    {
-        Position -= rightDirection * speed * ts;
-        moved = true;
-    }
-    else if (newWindow.IsKeyDown(KeyCode::D))
-    {
-        Position += rightDirection * speed * ts;
-        moved = true;
-    }
-    if (newWindow.IsKeyDown(KeyCode::E))
-    {
-        Position -= upDirection * speed * ts;
-        moved = true;
-    }
-    else if (newWindow.IsKeyDown(KeyCode::Q))
-    {
-        Position += upDirection * speed * ts;
-        moved = true;
-    }
-
-    // Rotation
-    if (delta.x != 0.0f || delta.y != 0.0f)
-    {
-        float pitchDelta = delta.y * GetRotationSpeed();
-        float yawDelta = delta.x * GetRotationSpeed();
-
-        glm::quat q = glm::normalize(glm::cross(glm::angleAxis(-pitchDelta, rightDirection),
-                                                glm::angleAxis(-yawDelta, glm::vec3(0.f, 1.0f, 0.0f))));
-        ForwardDirection = glm::rotate(q, ForwardDirection);
-
-        moved = true;
-    }
-
-    if (moved)
-    {
-        RecalculateView();
-        RecalculateRayDirections();
-    }
-    return moved;
+    RecalculateView();
+    RecalculateRayDirections();
 }
 
 void Camera::OnResize(uint32_t width, uint32_t height)
@@ -103,11 +32,6 @@ void Camera::OnResize(uint32_t width, uint32_t height)
     RecalculateRayDirections();
 }
 
-float Camera::GetRotationSpeed()
-{
-    return 0.3f;
-}
-
 void Camera::RecalculateProjection()
 {
     Projection = glm::perspectiveFov(glm::radians(VerticalFOV), (float)ViewportWidth, (float)ViewportHeight, NearClip, FarClip);
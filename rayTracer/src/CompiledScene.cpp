@@ -0,0 +1,326 @@
+#include "CompiledScene.h"
+#include "Sphere.h"
+#include "Plane.h"
+#include "Mesh.h"
+#include <cmath>
+#include <limits>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+void CompiledScene::Compile(const Scene &scene)
+{
+    Compile(scene.Shapes);
+}
+
+void CompiledScene::Compile(const std::vector<std::shared_ptr<Shape>> &shapes)
+{
+    spheres = SphereData();
+    planes = PlaneData();
+    meshes = MeshData();
+    shapeSlots.assign(shapes.size(), 0);
+
+    for (size_t i = 0; i < shapes.size(); i++)
+    {
+        const Shape &shape = *shapes[i];
+        switch (shape.GetType())
+        {
+        case ShapeType::Sphere:
+        {
+            const Sphere &sphere = static_cast<const Sphere &>(shape);
+            shapeSlots[i] = (glm::uint32)spheres.ShapeIndex.size();
+            spheres.CenterX.push_back(sphere.Position.x);
+            spheres.CenterY.push_back(sphere.Position.y);
+            spheres.CenterZ.push_back(sphere.Position.z);
+            spheres.RadiusSquared.push_back(sphere.Radius * sphere.Radius);
+            spheres.ShapeIndex.push_back((int)i);
+            break;
+        }
+        case ShapeType::Plane:
+        {
+            const Plane &plane = static_cast<const Plane &>(shape);
+            shapeSlots[i] = (glm::uint32)planes.ShapeIndex.size();
+            planes.NormalX.push_back(plane.Normal.x);
+            planes.NormalY.push_back(plane.Normal.y);
+            planes.NormalZ.push_back(plane.Normal.z);
+            planes.Offset.push_back(glm::dot(plane.Normal, plane.Position));
+            planes.ShapeIndex.push_back((int)i);
+            break;
+        }
+        case ShapeType::Mesh:
+        {
+            const Mesh &mesh = static_cast<const Mesh &>(shape);
+            AABB bounds = mesh.GetBounds();
+            bounds.Min -= mesh.Position;
+            bounds.Max -= mesh.Position;
+            shapeSlots[i] = (glm::uint32)meshes.ShapeIndex.size();
+            meshes.Meshes.push_back(&mesh);
+            meshes.Bounds.push_back(bounds);
+            meshes.ShapeIndex.push_back((int)i);
+            break;
+        }
+        }
+    }
+    PadSpheres();
+}
+
+void CompiledScene::PermuteSpheres(const std::vector<glm::uint32> &order)
+{
+    SphereData sorted;
+    sorted.CenterX.resize(order.size());
+    sorted.CenterY.resize(order.size());
+    sorted.CenterZ.resize(order.size());
+    sorted.RadiusSquared.resize(order.size());
+    sorted.ShapeIndex.resize(order.size());
+
+    // order is a permutation, so every slot and every shapeSlots entry is written by exactly one iteration
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, order.size(), 1 << 13),
+                      [&](const tbb::blocked_range<size_t> &range)
+                      {
+                          for (size_t i = range.begin(); i != range.end(); i++)
+                          {
+                              glm::uint32 from = order[i];
+                              sorted.CenterX[i] = spheres.CenterX[from];
+                              sorted.CenterY[i] = spheres.CenterY[from];
+                              sorted.CenterZ[i] = spheres.CenterZ[from];
+                              sorted.RadiusSquared[i] = spheres.RadiusSquared[from];
+                              sorted.ShapeIndex[i] = spheres.ShapeIndex[from];
+                              shapeSlots[sorted.ShapeIndex[i]] = (glm::uint32)i;
+                          }
+                      });
+    spheres = std::move(sorted);
+    PadSpheres();
+}
+
+int CompiledScene::UpdateShape(const Scene &scene, size_t shapeIndex)
+{
+    if (shapeIndex >= shapeSlots.size() || shapeIndex >= scene.Shapes.size())
+        return -1;
+
+    const Shape &shape = *scene.Shapes[shapeIndex];
+    glm::uint32 slot = shapeSlots[shapeIndex];
+    switch (shape.GetType())
+    {
+    case ShapeType::Sphere:
+    {
+        const Sphere &sphere = static_cast<const Sphere &>(shape);
+        spheres.CenterX[slot] = sphere.Position.x;
+        spheres.CenterY[slot] = sphere.Position.y;
+        spheres.CenterZ[slot] = sphere.Position.z;
+        spheres.RadiusSquared[slot] = sphere.Radius * sphere.Radius;
+        return (int)slot;
+    }
+    case ShapeType::Plane:
+    {
+        const Plane &plane = static_cast<const Plane &>(shape);
+        planes.NormalX[slot] = plane.Normal.x;
+        planes.NormalY[slot] = plane.Normal.y;
+        planes.NormalZ[slot] = plane.Normal.z;
+        planes.Offset[slot] = glm::dot(plane.Normal, plane.Position);
+        return -1;
+    }
+    case ShapeType::Mesh:
+        // Meshes are tested at their current Position, nothing to copy
+        return -1;
+    }
+    return -1;
+}
+
+AABB CompiledScene::GetSphereBounds(glm::uint32 index) const
+{
+    glm::vec3 center(spheres.CenterX[index], spheres.CenterY[index], spheres.CenterZ[index]);
+    glm::vec3 extent(std::sqrt(spheres.RadiusSquared[index]));
+
+    AABB bounds;
+    bounds.Min = center - extent;
+    bounds.Max = center + extent;
+    return bounds;
+}
+
+SphereKernel::Spheres CompiledScene::GetSphereKernelData() const
+{
+    SphereKernel::Spheres data;
+    data.CenterX = spheres.CenterX.data();
+    data.CenterY = spheres.CenterY.data();
+    data.CenterZ = spheres.CenterZ.data();
+    data.RadiusSquared = spheres.RadiusSquared.data();
+    return data;
+}
+
+void CompiledScene::PadSpheres()
+{
+    // Padding lanes are masked out by the kernels, the values only need to be finite
+    size_t size = spheres.Size() + SphereKernel::Padding;
+    spheres.CenterX.resize(size, 0.0f);
+    spheres.CenterY.resize(size, 0.0f);
+    spheres.CenterZ.resize(size, 0.0f);
+    spheres.RadiusSquared.resize(size, -1.0f);
+}
+
+void CompiledScene::IntersectSpheres(const Ray &ray, glm::uint32 first, glm::uint32 count, float &hitDistance, int &hitIndex) const
+{
+    int slot = SphereKernel::Intersect(GetSphereKernelData(), ray, first, count, hitDistance);
+    if (slot >= 0)
+        hitIndex = spheres.ShapeIndex[slot];
+}
+
+bool CompiledScene::AnyHitSpheres(const Ray &ray, glm::uint32 first, glm::uint32 count, float tMin, float tMax) const
+{
+    return SphereKernel::AnyHit(GetSphereKernelData(), ray, first, count, tMin, tMax);
+}
+
+bool CompiledScene::Intersect(const Ray &ray, float &hitDistance, int &hitIndex) const
+{
+    hitDistance = std::numeric_limits<float>::max();
+    hitIndex = -1;
+    IntersectPlanes(ray, hitDistance, hitIndex);
+    IntersectSpheres(ray, 0, (glm::uint32)spheres.Size(), hitDistance, hitIndex);
+    return hitIndex >= 0;
+}
+
+bool CompiledScene::AnyHit(const Ray &ray, float tMin, float tMax) const
+{
+    return AnyHitPlanes(ray, tMin, tMax) || AnyHitSpheres(ray, 0, (glm::uint32)spheres.Size(), tMin, tMax);
+}
+
+// One-sided like Plane::Intersect: only rays with dot(Normal, Direction) > 0 can hit
+void CompiledScene::IntersectPlanes(const Ray &ray, float &hitDistance, int &hitIndex) const
+{
+    for (size_t i = 0; i < planes.Size(); i++)
+    {
+        float denom = planes.NormalX[i] * ray.Direction.x + planes.NormalY[i] * ray.Direction.y + planes.NormalZ[i] * ray.Direction.z;
+        if (denom <= 1e-6f)
+            continue;
+
+        float originDistance = planes.NormalX[i] * ray.Origin.x + planes.NormalY[i] * ray.Origin.y + planes.NormalZ[i] * ray.Origin.z;
+        float t = (planes.Offset[i] - originDistance) / denom;
+        if (t > 0.0f && t < hitDistance)
+        {
+            hitDistance = t;
+            hitIndex = planes.ShapeIndex[i];
+        }
+    }
+}
+
+bool CompiledScene::AnyHitPlanes(const Ray &ray, float tMin, float tMax) const
+{
+    for (size_t i = 0; i < planes.Size(); i++)
+    {
+        float denom = planes.NormalX[i] * ray.Direction.x + planes.NormalY[i] * ray.Direction.y + planes.NormalZ[i] * ray.Direction.z;
+        if (denom <= 1e-6f)
+            continue;
+
+        float originDistance = planes.NormalX[i] * ray.Origin.x + planes.NormalY[i] * ray.Origin.y + planes.NormalZ[i] * ray.Origin.z;
+        float t = (planes.Offset[i] - originDistance) / denom;
+        if (t >= 0.0f && t > tMin && t < tMax)
+            return true;
+    }
+    return false;
+}
+
+bool CompiledScene::IntersectMeshes(const Ray &ray, float &hitDistance, int &hitIndex, int &triangle) const
+{
+    bool hit = false;
+    glm::vec3 invDirection = 1.0f / ray.Direction;
+    for (size_t i = 0; i < meshes.Size(); i++)
+    {
+        // The box test against the compiled copy skips the mesh without touching it
+        Ray local;
+        local.Origin = ray.Origin - meshes.Meshes[i]->Position;
+        local.Direction = ray.Direction;
+        if (meshes.Bounds[i].Intersect(local, invDirection, hitDistance) == std::numeric_limits<float>::max())
+            continue;
+
+        if (meshes.Meshes[i]->IntersectCloser(ray, hitDistance, triangle))
+        {
+            hitIndex = meshes.ShapeIndex[i];
+            hit = true;
+        }
+    }
+    return hit;
+}
+
+bool CompiledScene::AnyHitMeshes(const Ray &ray, float tMin, float tMax) const
+{
+    for (size_t i = 0; i < meshes.Size(); i++)
+    {
+        if (meshes.Meshes[i]->AnyHit(ray, tMin, tMax))
+            return true;
+    }
+    return false;
+}
+
+namespace
+{
+    void StoreObjectIndex(RayPacket &packet, glm::uint32 group, int hitBits, int objectIndex)
+    {
+        for (glm::uint32 lane = 0; lane < SIMD::Width; lane++)
+        {
+            if (hitBits & (1 << lane))
+                packet.ObjectIndex[group + lane] = objectIndex;
+        }
+    }
+}
+
+// With the shared origin, oc is the same for every lane and only the direction terms vary
+void CompiledScene::IntersectSpheres(RayPacket &packet, glm::uint32 first, glm::uint32 count) const
+{
+    const SIMD::Float zero = SIMD::Broadcast(0.0f);
+
+    for (glm::uint32 i = first; i < first + count; i++)
+    {
+        SIMD::Float ocX = SIMD::Broadcast(packet.Origin.x - spheres.CenterX[i]);
+        SIMD::Float ocY = SIMD::Broadcast(packet.Origin.y - spheres.CenterY[i]);
+        SIMD::Float ocZ = SIMD::Broadcast(packet.Origin.z - spheres.CenterZ[i]);
+        SIMD::Float radiusSquared = SIMD::Broadcast(spheres.RadiusSquared[i]);
+
+        for (glm::uint32 group = 0; group < packet.Size; group += SIMD::Width)
+        {
+            SIMD::Float t = SphereKernel::EntryDistance(ocX, ocY, ocZ, radiusSquared,
+                                                        SIMD::Load(packet.DirectionX + group),
+                                                        SIMD::Load(packet.DirectionY + group),
+                                                        SIMD::Load(packet.DirectionZ + group),
+                                                        SIMD::Load(packet.LengthSquared + group),
+                                                        SIMD::Load(packet.NegInvLengthSquared + group));
+
+            SIMD::Float hitDistance = SIMD::Load(packet.HitDistance + group);
+            SIMD::Mask hit = SIMD::Greater(t, zero) & SIMD::Less(t, hitDistance);
+            int hitBits = SIMD::Bits(hit);
+            if (hitBits == 0)
+                continue;
+
+            SIMD::Store(packet.HitDistance + group, SIMD::Select(hit, t, hitDistance));
+            StoreObjectIndex(packet, group, hitBits, spheres.ShapeIndex[i]);
+        }
+    }
+}
+
+void CompiledScene::IntersectPlanes(RayPacket &packet) const
+{
+    const SIMD::Float zero = SIMD::Broadcast(0.0f);
+    const SIMD::Float epsilon = SIMD::Broadcast(1e-6f);
+
+    for (size_t i = 0; i < planes.Size(); i++)
+    {
+        SIMD::Float normalX = SIMD::Broadcast(planes.NormalX[i]);
+        SIMD::Float normalY = SIMD::Broadcast(planes.NormalY[i]);
+        SIMD::Float normalZ = SIMD::Broadcast(planes.NormalZ[i]);
+        float originDistance = planes.NormalX[i] * packet.Origin.x + planes.NormalY[i] * packet.Origin.y + planes.NormalZ[i] * packet.Origin.z;
+        SIMD::Float numerator = SIMD::Broadcast(planes.Offset[i] - originDistance);
+
+        for (glm::uint32 group = 0; group < packet.Size; group += SIMD::Width)
+        {
+            SIMD::Float denom = normalX * SIMD::Load(packet.DirectionX + group) + normalY * SIMD::Load(packet.DirectionY + group) + normalZ * SIMD::Load(packet.DirectionZ + group);
+            // Lanes failing the one-sided test may divide by zero, the denom compare masks them out
+            SIMD::Float distance = numerator / denom;
+
+            SIMD::Float hitDistance = SIMD::Load(packet.HitDistance + group);
+            SIMD::Mask hit = SIMD::Greater(denom, epsilon) & SIMD::Greater(distance, zero) & SIMD::Less(distance, hitDistance);
+            int hitBits = SIMD::Bits(hit);
+            if (hitBits == 0)
+                continue;
+
+            SIMD::Store(packet.HitDistance + group, SIMD::Select(hit, distance, hitDistance));
+            StoreObjectIndex(packet, group, hitBits, planes.ShapeIndex[i]);
+        }
+    }
+}
@@ -0,0 +1,121 @@
+#include "ConvergenceMap.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+    // Keeps nearly black pixels, whose relative error is large but invisible, from holding their tile back
+    const float DarkLuminance = 1.0f / 64.0f;
+}
+
+void ConvergenceMap::Reset(glm::uint32 width, glm::uint32 height)
+{
+    this->width = width;
+    this->height = height;
+    squaredSums.assign((size_t)width * height, 0.0f);
+    tileSize = 0;
+}
+
+void ConvergenceMap::Configure(glm::uint32 tileSize, float threshold)
+{
+    tileSize = std::max(tileSize, 1u);
+    if (tileSize == this->tileSize && threshold == this->threshold)
+        return;
+
+    this->tileSize = tileSize;
+    this->threshold = threshold;
+    tilesX = (width + tileSize - 1) / tileSize;
+    tilesY = (height + tileSize - 1) / tileSize;
+    errors.assign((size_t)tilesX * tilesY, std::numeric_limits<float>::max());
+    converged.assign((size_t)tilesX * tilesY, 0);
+}
+
+void ConvergenceMap::Clear()
+{
+    squaredSums.clear();
+    errors.clear();
+    converged.clear();
+    tileSize = 0;
+}
+
+void ConvergenceMap::UpdateTile(const TileScheduler::Tile &tile, const glm::vec4 *accumulation)
+{
+    float errorSum = 0.0f;
+    bool enoughSamples = true;
+    for (glm::uint32 y = tile.MinY; y < tile.MaxY; y++)
+    {
+        for (glm::uint32 x = tile.MinX; x < tile.MaxX; x++)
+        {
+            glm::uint32 pixel = x + y * width;
+            float count = accumulation[pixel].a;
+            if (count < (float)MinSamples)
+            {
+                enoughSamples = false;
+                continue;
+            }
+
+            // Unbiased variance of the samples, over count for the variance of their mean
+            float mean = GetLuminance(glm::vec3(accumulation[pixel])) / count;
+            float variance = std::max(squaredSums[pixel] / count - mean * mean, 0.0f) * count / (count - 1.0f);
+            errorSum += std::sqrt(variance / count) / (mean + DarkLuminance);
+        }
+    }
+
+    size_t index = GetTileIndex(tile);
+    float error = errorSum / ((tile.MaxX - tile.MinX) * (tile.MaxY - tile.MinY));
+    errors[index] = enoughSamples ? error : std::numeric_limits<float>::max();
+    converged[index] = enoughSamples && error < threshold;
+}
+
+glm::uint32 ConvergenceMap::GetSamplesPerPixel(glm::uint32 maxSamples) const
+{
+    size_t active = std::count(converged.begin(), converged.end(), 0);
+    if (active == 0)
+        return 1;
+    return (glm::uint32)std::clamp<size_t>(converged.size() / active, 1, maxSamples);
+}
+
+float ConvergenceMap::GetConvergedFraction() const
+{
+    if (width == 0 || height == 0 || converged.empty())
+        return 0.0f;
+
+    size_t pixels = 0;
+    for (glm::uint32 ty = 0; ty < tilesY; ty++)
+    {
+        for (glm::uint32 tx = 0; tx < tilesX; tx++)
+        {
+            if (!converged[ty * tilesX + tx])
+                continue;
+            glm::uint32 tileWidth = std::min(tileSize, width - tx * tileSize);
+            glm::uint32 tileHeight = std::min(tileSize, height - ty * tileSize);
+            pixels += (size_t)tileWidth * tileHeight;
+        }
+    }
+    return (float)pixels / ((float)width * height);
+}
+
+void ConvergenceMap::Draw(glm::uint32 *data) const
+{
+    if (converged.empty())
+        return;
+
+    for (glm::uint32 y = 0; y < height; y++)
+    {
+        for (glm::uint32 x = 0; x < width; x++)
+        {
+            size_t tile = (y / tileSize) * tilesX + x / tileSize;
+            glm::vec3 tint(0.0f, 1.0f, 0.0f);
+            if (!converged[tile])
+                tint = glm::vec3(1.0f, std::clamp(1.0f - errors[tile] / (4.0f * threshold), 0.0f, 1.0f), 0.0f);
+
+            // Half the image, half the tint, so the picture stays readable underneath
+            glm::uint32 &pixel = data[x + y * width];
+            glm::uint32 r = ((pixel & 0xff) + (glm::uint32)(tint.r * 255.0f)) / 2;
+            glm::uint32 g = (((pixel >> 8) & 0xff) + (glm::uint32)(tint.g * 255.0f)) / 2;
+            glm::uint32 b = (((pixel >> 16) & 0xff) + (glm::uint32)(tint.b * 255.0f)) / 2;
+            pixel = (pixel & 0xff000000) | (b << 16) | (g << 8) | r;
+        }
+    }
+}
@@ -0,0 +1,151 @@
+#include "LightSampler.h"
+#include <algorithm>
+
+namespace
+{
+    // Share of the proposal spread evenly over all lights, so a light with little power still gets candidates where
+    // it is the only one that reaches
+    const float UniformShare = 0.1f;
+}
+
+float LightSampler::GetLuminance(const Light &light)
+{
+    return std::max(glm::dot(light.Color, glm::vec3(0.2126f, 0.7152f, 0.0722f)), 0.0f);
+}
+
+float LightSampler::GetPower(const Light &light)
+{
+    return std::max(light.Intensity, 0.0f) * GetLuminance(light);
+}
+
+void LightSampler::Build(const std::vector<Light> &lights)
+{
+    size_t count = lights.size();
+    thresholds.assign(count, 1.0f);
+    aliases.resize(count);
+    probabilities.resize(count);
+    if (count == 0)
+        return;
+
+    float totalPower = 0.0f;
+    for (const Light &light : lights)
+        totalPower += GetPower(light);
+
+    float uniform = totalPower > 0.0f ? UniformShare : 1.0f;
+    for (size_t i = 0; i < count; i++)
+    {
+        float power = totalPower > 0.0f ? GetPower(lights[i]) / totalPower : 0.0f;
+        probabilities[i] = (1.0f - uniform) * power + uniform / count;
+    }
+
+    // Vose's method: every slot holds its own light and at most one alias topping it up to an even share
+    std::vector<float> scaled(count);
+    std::vector<glm::uint32> small, large;
+    for (size_t i = 0; i < count; i++)
+    {
+        aliases[i] = (glm::uint32)i;
+        scaled[i] = probabilities[i] * count;
+        (scaled[i] < 1.0f ? small : large).push_back((glm::uint32)i);
+    }
+    while (!small.empty() && !large.empty())
+    {
+        glm::uint32 under = small.back();
+        small.pop_back();
+        glm::uint32 over = large.back();
+
+        thresholds[under] = scaled[under];
+        aliases[under] = over;
+        scaled[over] -= 1.0f - scaled[under];
+        if (scaled[over] < 1.0f)
+        {
+            large.pop_back();
+            small.push_back(over);
+        }
+    }
+    // Whatever is left is within rounding of an even share
+    for (glm::uint32 i : small)
+        thresholds[i] = 1.0f;
+    for (glm::uint32 i : large)
+        thresholds[i] = 1.0f;
+}
+
+glm::uint32 LightSampler::SampleAlias(float u, float &probability) const
+{
+    // The integer part picks the slot, what is left over decides between the slot's light and its alias
+    float slot = u * thresholds.size();
+    glm::uint32 index = std::min((glm::uint32)slot, (glm::uint32)thresholds.size() - 1);
+    if (slot - index >= thresholds[index])
+        index = aliases[index];
+    probability = probabilities[index];
+    return index;
+}
+
+float LightSampler::GetContribution(const Light &light, const glm::vec3 &position, const glm::vec3 &normal, float specular)
+{
+    glm::vec3 toLight = light.Position - position;
+    float distanceSquared = std::max(glm::dot(toLight, toLight), 1e-8f);
+    float cosine = std::max(glm::dot(normal, toLight), 0.0f) / std::sqrt(distanceSquared);
+    return GetPower(light) * cosine / distanceSquared + GetLuminance(light) * specular;
+}
+
+int LightSampler::Sample(const std::vector<Light> &lights, const glm::vec3 &position, const glm::vec3 &normal, float specular,
+                         Sampler &sampler, float &weight) const
+{
+    weight = 0.0f;
+    glm::uint32 count = (glm::uint32)std::min(lights.size(), thresholds.size());
+    if (count == 0)
+        return -1;
+
+    // Few enough lights to weigh them all: sample the target exactly
+    if (count <= CandidateCount)
+    {
+        float contributions[CandidateCount];
+        float total = 0.0f;
+        for (glm::uint32 i = 0; i < count; i++)
+        {
+            contributions[i] = GetContribution(lights[i], position, normal, specular);
+            total += contributions[i];
+        }
+
+        float u = sampler.Float() * total;
+        if (total <= 0.0f)
+            return -1;
+        // Ends on the last light that contributes when rounding leaves u just short of zero
+        int chosen = -1;
+        for (glm::uint32 i = 0; i < count; i++)
+        {
+            if (contributions[i] <= 0.0f)
+                continue;
+            chosen = (int)i;
+            u -= contributions[i];
+            if (u < 0.0f)
+                break;
+        }
+        weight = total / contributions[chosen];
+        return chosen;
+    }
+
+    // Resampled importance sampling: a reservoir keeps one candidate in proportion to target over proposal
+    int chosen = -1;
+    float chosenContribution = 0.0f;
+    float weightSum = 0.0f;
+    for (glm::uint32 candidate = 0; candidate < CandidateCount; candidate++)
+    {
+        float probability;
+        glm::uint32 index = SampleAlias(sampler.Float(), probability);
+        float contribution = GetContribution(lights[index], position, normal, specular);
+        float candidateWeight = contribution / probability;
+        weightSum += candidateWeight;
+        float u = sampler.Float();
+        if (candidateWeight > 0.0f && u * weightSum < candidateWeight)
+        {
+            chosen = (int)index;
+            chosenContribution = contribution;
+        }
+    }
+
+    if (chosen < 0)
+        return -1;
+    weight = weightSum / (CandidateCount * chosenContribution);
+    return chosen;
+}
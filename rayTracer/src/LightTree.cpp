@@ -0,0 +1,321 @@
+#include "LightTree.h"
+#include "LightSampler.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+    const float Pi = 3.14159265358979323846f;
+    const float OneMinusEpsilon = 0x1.fffffep-1f;
+    // How far from the cone's directions a light still shines, point lights light the hemisphere around each one
+    const float EmissionCosTheta = 0.0f;
+
+    float SafeAcos(float x)
+    {
+        return std::acos(std::clamp(x, -1.0f, 1.0f));
+    }
+
+    float SafeSqrt(float x)
+    {
+        return std::sqrt(std::max(x, 0.0f));
+    }
+
+    // cos(max(a - b, 0)) and sin(max(a - b, 0)) from the sines and cosines of angles a and b in [0, pi]
+    float CosSubClamped(float sinA, float cosA, float sinB, float cosB)
+    {
+        return cosA > cosB ? 1.0f : cosA * cosB + sinA * sinB;
+    }
+
+    float SinSubClamped(float sinA, float cosA, float sinB, float cosB)
+    {
+        return cosA > cosB ? 0.0f : sinA * cosB - cosA * sinB;
+    }
+
+    // Rotates v by angle around the unit axis
+    glm::vec3 Rotate(const glm::vec3 &v, const glm::vec3 &axis, float angle)
+    {
+        float c = std::cos(angle);
+        float s = std::sin(angle);
+        return v * c + glm::cross(axis, v) * s + axis * glm::dot(axis, v) * (1.0f - c);
+    }
+
+    // Smallest cone around both
+    LightTree::Cone Union(const LightTree::Cone &a, const LightTree::Cone &b)
+    {
+        float thetaA = SafeAcos(a.CosTheta);
+        float thetaB = SafeAcos(b.CosTheta);
+        float thetaD = SafeAcos(glm::dot(a.Axis, b.Axis));
+        if (std::min(thetaD + thetaB, Pi) <= thetaA)
+            return a;
+        if (std::min(thetaD + thetaA, Pi) <= thetaB)
+            return b;
+
+        float thetaO = (thetaA + thetaD + thetaB) * 0.5f;
+        glm::vec3 rotationAxis = glm::cross(a.Axis, b.Axis);
+        if (thetaO >= Pi || glm::dot(rotationAxis, rotationAxis) < 1e-12f)
+            return LightTree::Cone();
+
+        LightTree::Cone cone;
+        cone.Axis = glm::normalize(Rotate(a.Axis, glm::normalize(rotationAxis), thetaO - thetaA));
+        cone.CosTheta = std::cos(thetaO);
+        return cone;
+    }
+
+    // Solid angle weighted by the cosine falloff of everything the cone's lights can reach
+    float GetOrientationMeasure(const LightTree::Cone &cone)
+    {
+        float thetaO = SafeAcos(cone.CosTheta);
+        float thetaW = std::min(thetaO + SafeAcos(EmissionCosTheta), Pi);
+        float sinThetaO = std::sin(thetaO);
+        return 2.0f * Pi * (1.0f - cone.CosTheta) +
+               Pi * 0.5f * (2.0f * thetaW * sinThetaO - std::cos(thetaO - 2.0f * thetaW) - 2.0f * thetaO * sinThetaO + cone.CosTheta);
+    }
+
+    // Surface area orientation heuristic, axis stretches it for nodes thin along the split axis (-1 for none)
+    float GetNodeCost(const LightTree::Node &node, int axis)
+    {
+        glm::vec3 extent = node.Bounds.Max - node.Bounds.Min;
+        float stretch = 1.0f;
+        if (axis >= 0 && extent[axis] > 0.0f)
+            stretch = std::max(std::max(extent.x, extent.y), extent.z) / extent[axis];
+        return node.Power * GetOrientationMeasure(node.Orientation) * stretch * node.Bounds.GetSurfaceArea();
+    }
+
+    LightTree::Node MakeLeaf(const Light &light, glm::uint32 lightIndex)
+    {
+        LightTree::Node leaf;
+        leaf.Bounds.Grow(light.Position);
+        leaf.Power = LightSampler::GetPower(light);
+        leaf.Luminance = LightSampler::GetLuminance(light);
+        leaf.Child = lightIndex;
+        leaf.Leaf = true;
+        return leaf;
+    }
+
+    LightTree::Node Combine(const LightTree::Node &a, const LightTree::Node &b)
+    {
+        LightTree::Node node;
+        node.Bounds = a.Bounds;
+        node.Bounds.Grow(b.Bounds);
+        node.Orientation = Union(a.Orientation, b.Orientation);
+        node.Power = a.Power + b.Power;
+        node.Luminance = a.Luminance + b.Luminance;
+        return node;
+    }
+}
+
+void LightTree::Build(const std::vector<Light> &lights)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    nodes.clear();
+    stats = BuildStats();
+    if (!lights.empty())
+    {
+        std::vector<Node> leaves(lights.size());
+        for (size_t i = 0; i < lights.size(); i++)
+            leaves[i] = MakeLeaf(lights[i], (glm::uint32)i);
+
+        nodes.reserve(lights.size() * 2 - 1);
+        BuildRecursive(leaves, 0, leaves.size(), 0);
+    }
+
+    stats.NodeCount = (glm::uint32)nodes.size();
+    stats.Cost = GetCost();
+    stats.BuildCost = stats.Cost;
+    stats.BuildTimeMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+glm::uint32 LightTree::BuildRecursive(std::vector<Node> &leaves, size_t begin, size_t end, glm::uint32 depth)
+{
+    glm::uint32 index = (glm::uint32)nodes.size();
+    nodes.emplace_back();
+    stats.MaxDepth = std::max(stats.MaxDepth, depth);
+    if (end - begin == 1)
+    {
+        nodes[index] = leaves[begin];
+        return index;
+    }
+
+    AABB centroidBounds;
+    for (size_t i = begin; i < end; i++)
+        centroidBounds.Grow(leaves[i].Bounds.GetCenter());
+    glm::vec3 extent = centroidBounds.Max - centroidBounds.Min;
+    int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+
+    // Binned split with the lowest SAOH cost, or halves when the lights all sit in one spot
+    size_t middle = begin + (end - begin) / 2;
+    if (extent[axis] > 0.0f)
+    {
+        float scale = BinCount / extent[axis];
+        auto getBin = [&](const Node &leaf)
+        {
+            return std::min((glm::uint32)((leaf.Bounds.GetCenter()[axis] - centroidBounds.Min[axis]) * scale), BinCount - 1);
+        };
+
+        Node bins[BinCount];
+        glm::uint32 counts[BinCount] = {};
+        for (size_t i = begin; i < end; i++)
+        {
+            glm::uint32 bin = getBin(leaves[i]);
+            bins[bin] = counts[bin]++ == 0 ? leaves[i] : Combine(bins[bin], leaves[i]);
+        }
+
+        // Cost of everything below each split from the right, then sweep from the left
+        float rightCosts[BinCount] = {};
+        Node right;
+        glm::uint32 rightCount = 0;
+        for (glm::uint32 bin = BinCount - 1; bin > 0; bin--)
+        {
+            if (counts[bin] > 0)
+                right = rightCount == 0 ? bins[bin] : Combine(right, bins[bin]);
+            rightCount += counts[bin];
+            rightCosts[bin] = rightCount > 0 ? GetNodeCost(right, axis) : 0.0f;
+        }
+
+        float bestCost = std::numeric_limits<float>::max();
+        glm::uint32 bestSplit = 0;
+        Node left;
+        glm::uint32 leftCount = 0;
+        for (glm::uint32 split = 1; split < BinCount; split++)
+        {
+            if (counts[split - 1] > 0)
+                left = leftCount == 0 ? bins[split - 1] : Combine(left, bins[split - 1]);
+            leftCount += counts[split - 1];
+            if (leftCount == 0 || leftCount == end - begin)
+                continue;
+            float cost = GetNodeCost(left, axis) + rightCosts[split];
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestSplit = split;
+            }
+        }
+
+        if (bestSplit > 0)
+        {
+            auto split = std::partition(leaves.begin() + begin, leaves.begin() + end, [&](const Node &leaf)
+                                        { return getBin(leaf) < bestSplit; });
+            middle = split - leaves.begin();
+        }
+    }
+
+    BuildRecursive(leaves, begin, middle, depth + 1);
+    glm::uint32 second = BuildRecursive(leaves, middle, end, depth + 1);
+    nodes[index] = Combine(nodes[index + 1], nodes[second]);
+    nodes[index].Child = second;
+    return index;
+}
+
+bool LightTree::Refit(const std::vector<Light> &lights)
+{
+    if (nodes.empty() || lights.size() * 2 - 1 != nodes.size())
+        return false;
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // Children always come after their parent
+    for (size_t i = nodes.size(); i-- > 0;)
+    {
+        Node &node = nodes[i];
+        if (node.Leaf)
+        {
+            node = MakeLeaf(lights[node.Child], node.Child);
+            continue;
+        }
+        glm::uint32 second = node.Child;
+        node = Combine(nodes[i + 1], nodes[second]);
+        node.Child = second;
+    }
+
+    stats.Cost = GetCost();
+    stats.RefitCount++;
+    stats.RefitTimeMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    return stats.Cost <= stats.BuildCost * (1.0f + MaxCostGrowth);
+}
+
+float LightTree::GetCost() const
+{
+    float cost = 0.0f;
+    for (const Node &node : nodes)
+    {
+        if (!node.Leaf)
+            cost += GetNodeCost(node, -1);
+    }
+    return cost;
+}
+
+float LightTree::GetImportance(const Node &node, const glm::vec3 &position, const glm::vec3 &normal, float specular)
+{
+    float diffuse = 0.0f;
+    if (node.Power > 0.0f)
+    {
+        glm::vec3 diagonal = node.Bounds.Max - node.Bounds.Min;
+        glm::vec3 toPosition = position - node.Bounds.GetCenter();
+        float centerDistanceSquared = glm::dot(toPosition, toPosition);
+        // Closer than half the diagonal the center says little about the distance to the lights
+        float distanceSquared = std::max(std::max(centerDistanceSquared, glm::length(diagonal) * 0.5f), 1e-8f);
+
+        // Half the angle the bounds' enclosing sphere covers seen from position; inside it every direction is possible
+        float radiusSquared = glm::dot(diagonal, diagonal) * 0.25f;
+        if (centerDistanceSquared <= radiusSquared)
+            return node.Power / distanceSquared + node.Luminance * specular;
+        float sinThetaB = std::sqrt(radiusSquared / centerDistanceSquared);
+        float cosThetaB = SafeSqrt(1.0f - sinThetaB * sinThetaB);
+        glm::vec3 direction = toPosition / std::sqrt(centerDistanceSquared);
+
+        // Smallest angle any light in the node can make between an emitted direction and position, the cone
+        // widened by its own spread and then by the bounds
+        float cosThetaW = glm::dot(node.Orientation.Axis, direction);
+        float cosThetaO = node.Orientation.CosTheta;
+        float cosThetaX = CosSubClamped(SafeSqrt(1.0f - cosThetaW * cosThetaW), cosThetaW, SafeSqrt(1.0f - cosThetaO * cosThetaO), cosThetaO);
+        float sinThetaX = SinSubClamped(SafeSqrt(1.0f - cosThetaW * cosThetaW), cosThetaW, SafeSqrt(1.0f - cosThetaO * cosThetaO), cosThetaO);
+        float cosEmission = CosSubClamped(sinThetaX, cosThetaX, sinThetaB, cosThetaB);
+
+        // And between the surface normal and a direction to the lights
+        float cosThetaI = -glm::dot(normal, direction);
+        float cosIncidence = CosSubClamped(SafeSqrt(1.0f - cosThetaI * cosThetaI), cosThetaI, sinThetaB, cosThetaB);
+        if (cosEmission > EmissionCosTheta && cosIncidence > 0.0f)
+            diffuse = node.Power * cosEmission * cosIncidence / distanceSquared;
+    }
+    return diffuse + node.Luminance * specular;
+}
+
+int LightTree::Sample(const glm::vec3 &position, const glm::vec3 &normal, float specular, Sampler &sampler, float &weight) const
+{
+    weight = 0.0f;
+    if (nodes.empty())
+        return -1;
+
+    // One number picks the path down: what is left of it after each choice is stretched back to [0, 1)
+    float u = sampler.Float();
+    float probability = 1.0f;
+    glm::uint32 index = 0;
+    while (!nodes[index].Leaf)
+    {
+        const Node &node = nodes[index];
+        float first = GetImportance(nodes[index + 1], position, normal, specular);
+        float second = GetImportance(nodes[node.Child], position, normal, specular);
+        if (first + second <= 0.0f)
+            return -1;
+
+        float p = first / (first + second);
+        if (u < p)
+        {
+            u = std::min(u / p, OneMinusEpsilon);
+            probability *= p;
+            index = index + 1;
+        }
+        else
+        {
+            u = std::min((u - p) / (1.0f - p), OneMinusEpsilon);
+            probability *= 1.0f - p;
+            index = node.Child;
+        }
+    }
+
+    weight = 1.0f / probability;
+    return (int)nodes[index].Child;
+}
@@ -0,0 +1,287 @@
+#include "Mesh.h"
+#include <cmath>
+#include <limits>
+
+namespace
+{
+    // Per-ray setup of the watertight test (Woop, Benthin and Wald 2013): the axis the ray mostly runs along becomes z
+    // and a shear moves the ray onto the z axis, so every triangle is tested in the same 2D frame and an edge shared by
+    // two triangles is evaluated with the same arithmetic from both sides.
+    struct WatertightRay
+    {
+        glm::vec3 Origin;
+        int X, Y, Z;
+        float ShearX, ShearY, ShearZ;
+    };
+
+    WatertightRay SetupRay(const Ray &ray)
+    {
+        glm::vec3 direction = glm::abs(ray.Direction);
+        WatertightRay setup;
+        setup.Origin = ray.Origin;
+        setup.Z = direction.x > direction.y ? (direction.x > direction.z ? 0 : 2) : (direction.y > direction.z ? 1 : 2);
+        setup.X = (setup.Z + 1) % 3;
+        setup.Y = (setup.X + 1) % 3;
+        // Keeps the winding of the 2D projection independent of the ray direction
+        if (ray.Direction[setup.Z] < 0.0f)
+            std::swap(setup.X, setup.Y);
+
+        setup.ShearX = ray.Direction[setup.X] / ray.Direction[setup.Z];
+        setup.ShearY = ray.Direction[setup.Y] / ray.Direction[setup.Z];
+        setup.ShearZ = 1.0f / ray.Direction[setup.Z];
+        return setup;
+    }
+
+    // Hit distance inside (0, tMax) in t, both windings count
+    bool IntersectTriangle(const WatertightRay &ray, const glm::vec3 &v0, const glm::vec3 &v1, const glm::vec3 &v2, float tMax, float &t)
+    {
+        glm::vec3 a = v0 - ray.Origin;
+        glm::vec3 b = v1 - ray.Origin;
+        glm::vec3 c = v2 - ray.Origin;
+
+        float ax = a[ray.X] - ray.ShearX * a[ray.Z];
+        float ay = a[ray.Y] - ray.ShearY * a[ray.Z];
+        float bx = b[ray.X] - ray.ShearX * b[ray.Z];
+        float by = b[ray.Y] - ray.ShearY * b[ray.Z];
+        float cx = c[ray.X] - ray.ShearX * c[ray.Z];
+        float cy = c[ray.Y] - ray.ShearY * c[ray.Z];
+
+        // Scaled barycentrics, twice the signed areas of the sub-triangles seen from the ray
+        float u = cx * by - cy * bx;
+        float v = ax * cy - ay * cx;
+        float w = bx * ay - by * ax;
+
+        // A ray through an edge or vertex: redo the edge functions in double so the neighbours agree on the sign
+        if (u == 0.0f || v == 0.0f || w == 0.0f)
+        {
+            u = (float)((double)cx * by - (double)cy * bx);
+            v = (float)((double)ax * cy - (double)ay * cx);
+            w = (float)((double)bx * ay - (double)by * ax);
+        }
+
+        if ((u < 0.0f || v < 0.0f || w < 0.0f) && (u > 0.0f || v > 0.0f || w > 0.0f))
+            return false;
+
+        float determinant = u + v + w;
+        if (determinant == 0.0f)
+            return false;
+
+        // Scaled distance, compared against the range before the one division
+        float scaled = u * ray.ShearZ * a[ray.Z] + v * ray.ShearZ * b[ray.Z] + w * ray.ShearZ * c[ray.Z];
+        if (determinant < 0.0f ? (scaled >= 0.0f || scaled <= tMax * determinant) : (scaled <= 0.0f || scaled >= tMax * determinant))
+            return false;
+
+        t = scaled / determinant;
+        return true;
+    }
+}
+
+Mesh::Mesh()
+{
+    Position = glm::vec3(0.0f);
+    MaterialIndex = 0;
+
+    SetType(ShapeType::Mesh);
+}
+
+Mesh::~Mesh()
+{
+}
+
+void Mesh::Build(BVHBuilder builder)
+{
+    glm::uint32 triangleCount = GetTriangleCount();
+    std::vector<AABB> bounds(triangleCount);
+    for (glm::uint32 i = 0; i < triangleCount; i++)
+    {
+        bounds[i].Grow(Vertices[Indices[i * 3 + 0]]);
+        bounds[i].Grow(Vertices[Indices[i * 3 + 1]]);
+        bounds[i].Grow(Vertices[Indices[i * 3 + 2]]);
+    }
+    tree.Build(bounds, builder);
+
+    // Store the triangles in leaf order, so a leaf covers a contiguous range of them
+    const std::vector<glm::uint32> &order = tree.GetPrimitiveIndices();
+    std::vector<glm::uint32> sorted(order.size() * 3);
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        sorted[i * 3 + 0] = Indices[order[i] * 3 + 0];
+        sorted[i * 3 + 1] = Indices[order[i] * 3 + 1];
+        sorted[i * 3 + 2] = Indices[order[i] * 3 + 2];
+    }
+    Indices = std::move(sorted);
+}
+
+bool Mesh::Restore(const BVH::Node *nodes, size_t nodeCount, BVHBuilder builder)
+{
+    return tree.Restore(GetTriangleCount(), nodes, nodeCount, builder);
+}
+
+bool Mesh::IntersectCloser(const Ray &ray, float &hitDistance, int &triangle) const
+{
+    const std::vector<BVH::Node> &nodes = tree.GetNodes();
+    if (nodes.empty())
+        return false;
+
+    // Everything below runs in object space, which only differs from world space by Position
+    Ray local;
+    local.Origin = ray.Origin - Position;
+    local.Direction = ray.Direction;
+    WatertightRay setup = SetupRay(local);
+    float incomingDistance = hitDistance;
+
+    struct StackEntry
+    {
+        glm::uint32 Node;
+        float Distance;
+    };
+    StackEntry stack[BVH::MaxDepth + 4];
+    int stackSize = 0;
+
+    glm::vec3 invDirection = 1.0f / local.Direction;
+    float rootDistance = nodes[0].Bounds.Intersect(local, invDirection, hitDistance);
+    if (rootDistance < hitDistance)
+        stack[stackSize++] = {0, rootDistance};
+
+    while (stackSize > 0)
+    {
+        StackEntry entry = stack[--stackSize];
+        if (entry.Distance >= hitDistance)
+            continue;
+
+        const BVH::Node &node = nodes[entry.Node];
+        if (node.IsLeaf())
+        {
+            for (glm::uint32 i = node.LeftFirst; i < node.LeftFirst + node.Count; i++)
+            {
+                float t;
+                if (IntersectTriangle(setup, Vertices[Indices[i * 3 + 0]], Vertices[Indices[i * 3 + 1]], Vertices[Indices[i * 3 + 2]], hitDistance, t))
+                {
+                    hitDistance = t;
+                    triangle = (int)i;
+                }
+            }
+            continue;
+        }
+
+        glm::uint32 nearChild = node.LeftFirst;
+        glm::uint32 farChild = node.LeftFirst + 1;
+        float nearDistance = nodes[nearChild].Bounds.Intersect(local, invDirection, hitDistance);
+        float farDistance = nodes[farChild].Bounds.Intersect(local, invDirection, hitDistance);
+        if (farDistance < nearDistance)
+        {
+            std::swap(nearChild, farChild);
+            std::swap(nearDistance, farDistance);
+        }
+        if (farDistance < hitDistance)
+            stack[stackSize++] = {farChild, farDistance};
+        if (nearDistance < hitDistance)
+            stack[stackSize++] = {nearChild, nearDistance};
+    }
+
+    return hitDistance < incomingDistance;
+}
+
+bool Mesh::AnyHit(const Ray &ray, float tMin, float tMax) const
+{
+    const std::vector<BVH::Node> &nodes = tree.GetNodes();
+    if (nodes.empty())
+        return false;
+
+    Ray local;
+    local.Origin = ray.Origin - Position;
+    local.Direction = ray.Direction;
+    WatertightRay setup = SetupRay(local);
+
+    glm::uint32 stack[BVH::MaxDepth + 4];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+
+    glm::vec3 invDirection = 1.0f / local.Direction;
+    while (stackSize > 0)
+    {
+        const BVH::Node &node = nodes[stack[--stackSize]];
+        if (node.Bounds.Intersect(local, invDirection, tMax) == std::numeric_limits<float>::max())
+            continue;
+
+        if (node.IsLeaf())
+        {
+            for (glm::uint32 i = node.LeftFirst; i < node.LeftFirst + node.Count; i++)
+            {
+                float t;
+                if (IntersectTriangle(setup, Vertices[Indices[i * 3 + 0]], Vertices[Indices[i * 3 + 1]], Vertices[Indices[i * 3 + 2]], tMax, t) && t > tMin)
+                    return true;
+            }
+            continue;
+        }
+
+        stack[stackSize++] = node.LeftFirst + 1;
+        stack[stackSize++] = node.LeftFirst;
+    }
+
+    return false;
+}
+
+bool Mesh::Intersect(const glm::vec3 &RayOrigin, const glm::vec3 &RayDirection, float &t) const
+{
+    Ray ray;
+    ray.Origin = RayOrigin;
+    ray.Direction = RayDirection;
+    float hitDistance = std::numeric_limits<float>::max();
+    int triangle = -1;
+    if (!IntersectCloser(ray, hitDistance, triangle))
+        return false;
+
+    t = hitDistance;
+    return true;
+}
+
+float Mesh::GetClosestHit(const Ray &ray) const
+{
+    float t = 0.0f;
+    if (Intersect(ray.Origin, ray.Direction, t))
+        return t;
+    return -1.0f;
+}
+
+glm::vec3 Mesh::GetTriangleNormal(int triangle) const
+{
+    const glm::vec3 &v0 = Vertices[Indices[triangle * 3 + 0]];
+    const glm::vec3 &v1 = Vertices[Indices[triangle * 3 + 1]];
+    const glm::vec3 &v2 = Vertices[Indices[triangle * 3 + 2]];
+    return glm::normalize(glm::cross(v1 - v0, v2 - v0));
+}
+
+glm::vec3 Mesh::GetNormal(const glm::vec3 &Point) const
+{
+    int closest = -1;
+    float closestDistance = std::numeric_limits<float>::max();
+    for (glm::uint32 i = 0; i < GetTriangleCount(); i++)
+    {
+        glm::vec3 normal = GetTriangleNormal((int)i);
+        float distance = std::abs(glm::dot(normal, Point - Vertices[Indices[i * 3]]));
+        if (distance < closestDistance)
+        {
+            closest = (int)i;
+            closestDistance = distance;
+        }
+    }
+    return closest >= 0 ? GetTriangleNormal(closest) : glm::vec3(0.0f, 1.0f, 0.0f);
+}
+
+AABB Mesh::GetBounds() const
+{
+    const std::vector<BVH::Node> &nodes = tree.GetNodes();
+    if (nodes.empty())
+        return AABB();
+
+    AABB bounds = nodes[0].Bounds;
+    bounds.Min += Position;
+    bounds.Max += Position;
+    return bounds;
+}
+
+size_t Mesh::GetMemorySize() const
+{
+    return Vertices.size() * sizeof(glm::vec3) + Indices.size() * sizeof(glm::uint32) + tree.GetNodes().size() * sizeof(BVH::Node);
+}
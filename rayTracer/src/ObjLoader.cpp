@@ -0,0 +1,179 @@
+#include "ObjLoader.h"
+#include "TextParsing.h"
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+    const size_t BlockSize = 1 << 20;
+
+    bool IsSpace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    const char *SkipSpaces(const char *p, const char *end)
+    {
+        while (p < end && IsSpace(*p))
+            p++;
+        return p;
+    }
+
+    class Parser
+    {
+    public:
+        explicit Parser(Mesh &mesh) : mesh(mesh) {}
+
+        // One line without its terminator
+        bool ParseLine(const char *p, const char *end)
+        {
+            lineNumber++;
+            p = SkipSpaces(p, end);
+            if (end - p < 2 || !IsSpace(p[1]))
+                return true;
+
+            if (p[0] == 'v')
+                return ParseVertex(p + 1, end);
+            if (p[0] == 'f')
+                return ParseFace(p + 1, end);
+            return true;
+        }
+
+    private:
+        bool ParseVertex(const char *p, const char *end)
+        {
+            glm::vec3 position;
+            for (int axis = 0; axis < 3; axis++)
+            {
+                p = SkipSpaces(p, end);
+                if (!TextParsing::ParseFloat(p, end, position[axis]))
+                    return Fail("malformed vertex");
+            }
+            mesh.Vertices.push_back(position);
+            return true;
+        }
+
+        // Corners are i, i/t, i//n or i/t/n, only i is kept; negative indices count back from the last vertex
+        bool ParseFace(const char *p, const char *end)
+        {
+            glm::uint32 first = 0;
+            glm::uint32 previous = 0;
+            int corners = 0;
+            while (true)
+            {
+                p = SkipSpaces(p, end);
+                if (p == end || *p == '#')
+                    break;
+
+                long index;
+                if (!TextParsing::ParseInt(p, end, index))
+                    return Fail("malformed face");
+                while (p < end && !IsSpace(*p))
+                    p++;
+
+                long vertexCount = (long)mesh.Vertices.size();
+                long resolved = index < 0 ? vertexCount + index : index - 1;
+                if (index == 0 || resolved < 0 || resolved >= vertexCount)
+                    return Fail("face index out of range");
+
+                glm::uint32 corner = (glm::uint32)resolved;
+                if (corners == 0)
+                    first = corner;
+                else if (corners >= 2)
+                {
+                    mesh.Indices.push_back(first);
+                    mesh.Indices.push_back(previous);
+                    mesh.Indices.push_back(corner);
+                }
+                previous = corner;
+                corners++;
+            }
+
+            if (corners < 3)
+                return Fail("face with fewer than three corners");
+            return true;
+        }
+
+        bool Fail(const char *message)
+        {
+            std::cerr << "ObjLoader: " << message << " on line " << lineNumber << std::endl;
+            return false;
+        }
+
+    private:
+        Mesh &mesh;
+        size_t lineNumber = 0;
+    };
+}
+
+namespace ObjLoader
+{
+    bool Load(const std::string &path, Mesh &mesh, BVHBuilder builder)
+    {
+        FILE *file = std::fopen(path.c_str(), "rb");
+        if (!file)
+        {
+            std::cerr << "ObjLoader: cannot open " << path << std::endl;
+            return false;
+        }
+
+        // Closed meshes have about twice as many triangles as vertices, which makes roughly 70 bytes of text per vertex
+        std::fseek(file, 0, SEEK_END);
+        long fileSize = std::ftell(file);
+        std::fseek(file, 0, SEEK_SET);
+        mesh.Vertices.clear();
+        mesh.Indices.clear();
+        if (fileSize > 0)
+        {
+            mesh.Vertices.reserve((size_t)fileSize / 70);
+            mesh.Indices.reserve((size_t)fileSize / 70 * 6);
+        }
+
+        // A line cut by the end of a block is moved to the front before the next read
+        std::vector<char> buffer(BlockSize);
+        size_t carried = 0;
+        Parser parser(mesh);
+        bool ok = true;
+        while (ok)
+        {
+            if (carried == buffer.size())
+                buffer.resize(buffer.size() * 2);
+
+            size_t read = std::fread(buffer.data() + carried, 1, buffer.size() - carried, file);
+            size_t filled = carried + read;
+            bool last = read == 0;
+
+            const char *line = buffer.data();
+            const char *end = buffer.data() + filled;
+            while (ok)
+            {
+                const char *newline = (const char *)std::memchr(line, '\n', end - line);
+                if (!newline)
+                    break;
+                ok = parser.ParseLine(line, newline);
+                line = newline + 1;
+            }
+
+            carried = end - line;
+            if (last)
+            {
+                if (ok && carried > 0)
+                    ok = parser.ParseLine(line, end);
+                break;
+            }
+            std::memmove(buffer.data(), line, carried);
+        }
+        std::fclose(file);
+
+        if (!ok)
+        {
+            mesh.Vertices.clear();
+            mesh.Indices.clear();
+            return false;
+        }
+
+        mesh.Build(builder);
+        return true;
+    }
+}
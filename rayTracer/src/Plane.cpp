@@ -39,4 +39,15 @@ float Plane::GetClosestHit(const Ray& ray) const
         return t;
     }
     return -1.0f;
-}
\ No newline at end of file
+}
+
+bool Plane::AnyHit(const Ray& ray, float tMin, float tMax) const
+{
+    float t = 0.0f;
+    return Intersect(ray.Origin, ray.Direction, t) && t > tMin && t < tMax;
+}
+
+AABB Plane::GetBounds() const
+{
+    return AABB();
+}
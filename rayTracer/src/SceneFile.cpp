@@ -0,0 +1,566 @@
+#include "SceneFile.h"
+#include "Sphere.h"
+#include "Plane.h"
+#include "Mesh.h"
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    const char Magic[8] = {'B', 'R', 'I', 'A', 'R', 'S', 'C', 'N'};
+    const glm::uint32 ByteOrderMark = 0x01020304;
+    const glm::uint32 HasBVHFlag = 1;
+    const size_t SectionAlignment = 16;
+
+    enum Section
+    {
+        Materials,
+        Lights,
+        Shapes,
+        Geometries,
+        GeometryShapes,
+        Instances,
+        Meshes,
+        MeshVertices,
+        MeshIndices,
+        MeshNodes,
+        BVHNodes,
+        SectionCount
+    };
+
+    struct SectionEntry
+    {
+        glm::uint64 Offset; // From the start of the file, a multiple of SectionAlignment
+        glm::uint64 Count;  // Records, not bytes
+    };
+
+    struct Header
+    {
+        char Magic[8];
+        glm::uint32 Version;
+        glm::uint32 ByteOrder; // Reads back as ByteOrderMark only with the writer's endianness
+        glm::uint32 Builder;   // BVHBuilder of the sphere BVH
+        glm::uint32 Flags;
+        float CameraPosition[3];
+        float CameraDirection[3];
+        float AmbientLight[3];
+        float AmbientIntensity;
+        SectionEntry Sections[SectionCount];
+    };
+
+    struct MaterialRecord
+    {
+        float Albedo[3];
+        float Roughness;
+        float Specular;
+        float Shininess;
+    };
+
+    struct LightRecord
+    {
+        float Position[3];
+        float Color[3];
+        float Intensity;
+    };
+
+    struct ShapeRecord
+    {
+        glm::uint32 Type; // ShapeType
+        glm::int32 MaterialIndex;
+        float Position[3];
+        float Radius;          // Spheres
+        float Normal[3];       // Planes
+        glm::uint32 MeshIndex; // Meshes, into the Meshes section
+    };
+
+    // A run of the GeometryShapes section
+    struct GeometryRecord
+    {
+        glm::uint32 FirstShape;
+        glm::uint32 ShapeCount;
+    };
+
+    struct InstanceRecord
+    {
+        float Rows[3][4]; // Transform::Rows
+        glm::uint32 GeometryIndex;
+        glm::int32 MaterialIndex;
+    };
+
+    // Runs of the MeshVertices, MeshIndices and MeshNodes sections; NodeCount is 0 when the tree was not saved
+    struct MeshRecord
+    {
+        glm::uint64 FirstVertex, VertexCount;
+        glm::uint64 FirstIndex, IndexCount;
+        glm::uint64 FirstNode, NodeCount;
+        glm::uint32 Builder;
+        glm::uint32 Padding;
+    };
+
+    static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "mesh vertices are stored as glm::vec3");
+    static_assert(sizeof(BVH::Node) == 32, "BVH nodes are stored as BVH::Node");
+
+    class SectionWriter
+    {
+    public:
+        explicit SectionWriter(FILE *file) : file(file) {}
+
+        template <typename T>
+        bool Write(SectionEntry &entry, const T *records, size_t count)
+        {
+            size_t padding = (SectionAlignment - offset % SectionAlignment) % SectionAlignment;
+            const char zeros[SectionAlignment] = {};
+            if (std::fwrite(zeros, 1, padding, file) != padding)
+                return false;
+            offset += padding;
+
+            entry.Offset = offset;
+            entry.Count = count;
+            if (count > 0 && std::fwrite(records, sizeof(T), count, file) != count)
+                return false;
+            offset += count * sizeof(T);
+            return true;
+        }
+
+        template <typename T>
+        bool Write(SectionEntry &entry, const std::vector<T> &records)
+        {
+            return Write(entry, records.data(), records.size());
+        }
+
+    private:
+        FILE *file;
+        size_t offset = sizeof(Header);
+    };
+
+    struct SaveData
+    {
+        std::vector<MeshRecord> Meshes;
+        std::vector<glm::vec3> Vertices;
+        std::vector<glm::uint32> Indices;
+        std::vector<BVH::Node> Nodes;
+    };
+
+    ShapeRecord MakeShapeRecord(const Shape &shape, bool includeBVH, SaveData &save)
+    {
+        ShapeRecord record = {};
+        record.Type = (glm::uint32)shape.GetType();
+        record.MaterialIndex = shape.MaterialIndex;
+        std::memcpy(record.Position, &shape.Position, sizeof(record.Position));
+        switch (shape.GetType())
+        {
+        case ShapeType::Sphere:
+            record.Radius = static_cast<const Sphere &>(shape).Radius;
+            break;
+        case ShapeType::Plane:
+            std::memcpy(record.Normal, &static_cast<const Plane &>(shape).Normal, sizeof(record.Normal));
+            break;
+        case ShapeType::Mesh:
+        {
+            // The triangles are already in the leaf order of the mesh's own tree, which is saved as it is
+            const Mesh &mesh = static_cast<const Mesh &>(shape);
+            MeshRecord meshRecord = {};
+            meshRecord.FirstVertex = save.Vertices.size();
+            meshRecord.VertexCount = mesh.Vertices.size();
+            meshRecord.FirstIndex = save.Indices.size();
+            meshRecord.IndexCount = mesh.Indices.size();
+            meshRecord.FirstNode = save.Nodes.size();
+            meshRecord.NodeCount = includeBVH ? mesh.GetBVHNodes().size() : 0;
+            meshRecord.Builder = (glm::uint32)mesh.GetBVHStats().Builder;
+            save.Vertices.insert(save.Vertices.end(), mesh.Vertices.begin(), mesh.Vertices.end());
+            save.Indices.insert(save.Indices.end(), mesh.Indices.begin(), mesh.Indices.end());
+            if (includeBVH)
+                save.Nodes.insert(save.Nodes.end(), mesh.GetBVHNodes().begin(), mesh.GetBVHNodes().end());
+            record.MeshIndex = (glm::uint32)save.Meshes.size();
+            save.Meshes.push_back(meshRecord);
+            break;
+        }
+        }
+        return record;
+    }
+
+    // Bounds-checked view of the mapped sections
+    class Reader
+    {
+    public:
+        Reader(const unsigned char *data, size_t size) : data(data), size(size) {}
+
+        const Header &GetHeader() const { return *reinterpret_cast<const Header *>(data); }
+
+        template <typename T>
+        bool GetSection(Section section, const T *&records, size_t &count) const
+        {
+            const SectionEntry &entry = GetHeader().Sections[section];
+            if (entry.Offset % SectionAlignment != 0 || entry.Offset > size || entry.Count > (size - entry.Offset) / sizeof(T))
+                return false;
+            records = reinterpret_cast<const T *>(data + entry.Offset);
+            count = (size_t)entry.Count;
+            return true;
+        }
+
+    private:
+        const unsigned char *data;
+        size_t size;
+    };
+
+    struct MappedMeshes
+    {
+        const MeshRecord *Records = nullptr;
+        size_t Count = 0;
+        const glm::vec3 *Vertices = nullptr;
+        size_t VertexCount = 0;
+        const glm::uint32 *Indices = nullptr;
+        size_t IndexCount = 0;
+        const BVH::Node *Nodes = nullptr;
+        size_t NodeCount = 0;
+    };
+
+    std::shared_ptr<Shape> LoadShape(const ShapeRecord &record, size_t materialCount, const MappedMeshes &meshes)
+    {
+        if (record.MaterialIndex < 0 || (size_t)record.MaterialIndex >= materialCount)
+            return nullptr;
+
+        glm::vec3 position(record.Position[0], record.Position[1], record.Position[2]);
+        switch ((ShapeType)record.Type)
+        {
+        case ShapeType::Sphere:
+        {
+            std::shared_ptr<Sphere> sphere = std::make_shared<Sphere>();
+            sphere->SetPosition(position);
+            sphere->SetRadius(record.Radius);
+            sphere->SetMaterialIndex(record.MaterialIndex);
+            return sphere;
+        }
+        case ShapeType::Plane:
+        {
+            std::shared_ptr<Plane> plane = std::make_shared<Plane>();
+            plane->Position = position;
+            plane->Normal = glm::vec3(record.Normal[0], record.Normal[1], record.Normal[2]);
+            plane->MaterialIndex = record.MaterialIndex;
+            return plane;
+        }
+        case ShapeType::Mesh:
+        {
+            if (record.MeshIndex >= meshes.Count)
+                return nullptr;
+            const MeshRecord &meshRecord = meshes.Records[record.MeshIndex];
+            if (meshRecord.FirstVertex > meshes.VertexCount || meshRecord.VertexCount > meshes.VertexCount - meshRecord.FirstVertex ||
+                meshRecord.FirstIndex > meshes.IndexCount || meshRecord.IndexCount > meshes.IndexCount - meshRecord.FirstIndex ||
+                meshRecord.FirstNode > meshes.NodeCount || meshRecord.NodeCount > meshes.NodeCount - meshRecord.FirstNode ||
+                meshRecord.IndexCount % 3 != 0)
+                return nullptr;
+
+            std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>();
+            mesh->Position = position;
+            mesh->MaterialIndex = record.MaterialIndex;
+            const glm::vec3 *vertices = meshes.Vertices + meshRecord.FirstVertex;
+            const glm::uint32 *indices = meshes.Indices + meshRecord.FirstIndex;
+            mesh->Vertices.assign(vertices, vertices + meshRecord.VertexCount);
+            mesh->Indices.assign(indices, indices + meshRecord.IndexCount);
+            for (glm::uint32 index : mesh->Indices)
+            {
+                if (index >= meshRecord.VertexCount)
+                    return nullptr;
+            }
+
+            if (meshRecord.NodeCount == 0)
+                mesh->Build();
+            else if (!mesh->Restore(meshes.Nodes + meshRecord.FirstNode, (size_t)meshRecord.NodeCount,
+                                        meshRecord.Builder == (glm::uint32)BVHBuilder::LBVH ? BVHBuilder::LBVH : BVHBuilder::SAH))
+                return nullptr;
+            return mesh;
+        }
+        }
+        return nullptr;
+    }
+
+    bool LoadShapes(const ShapeRecord *records, size_t count, size_t materialCount, const MappedMeshes &meshes,
+                    std::vector<std::shared_ptr<Shape>> &shapes)
+    {
+        shapes.reserve(shapes.size() + count);
+        for (size_t i = 0; i < count; i++)
+        {
+            std::shared_ptr<Shape> shape = LoadShape(records[i], materialCount, meshes);
+            if (!shape)
+                return false;
+            shapes.push_back(shape);
+        }
+        return true;
+    }
+}
+
+SceneFile::~SceneFile()
+{
+    if (!data)
+        return;
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+#else
+    munmap((void *)data, size);
+#endif
+}
+
+bool SceneFile::Save(const std::string &path, const Scene &scene, const Camera &camera, bool includeBVH, BVHBuilder builder)
+{
+    // Spheres go first in the sphere tree's leaf order, so the tracer's compiled scene comes out in that order
+    std::vector<size_t> order;
+    order.reserve(scene.Shapes.size());
+    std::vector<BVH::Node> bvhNodes;
+    if (includeBVH)
+    {
+        CompiledScene compiled;
+        compiled.Compile(scene);
+        BVH bvh;
+        bvh.Build(compiled, builder);
+        bvhNodes = bvh.GetNodes();
+
+        const CompiledScene::SphereData &spheres = compiled.GetSpheres();
+        for (size_t slot = 0; slot < spheres.Size(); slot++)
+            order.push_back((size_t)spheres.ShapeIndex[slot]);
+        for (size_t i = 0; i < scene.Shapes.size(); i++)
+        {
+            if (scene.Shapes[i]->GetType() != ShapeType::Sphere)
+                order.push_back(i);
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < scene.Shapes.size(); i++)
+            order.push_back(i);
+    }
+
+    SaveData save;
+    std::vector<ShapeRecord> shapes;
+    shapes.reserve(order.size());
+    for (size_t index : order)
+        shapes.push_back(MakeShapeRecord(*scene.Shapes[index], includeBVH, save));
+
+    std::vector<GeometryRecord> geometries;
+    std::vector<ShapeRecord> geometryShapes;
+    for (const Geometry &geometry : scene.Geometries)
+    {
+        geometries.push_back({(glm::uint32)geometryShapes.size(), (glm::uint32)geometry.Shapes.size()});
+        for (const std::shared_ptr<Shape> &shape : geometry.Shapes)
+            geometryShapes.push_back(MakeShapeRecord(*shape, includeBVH, save));
+    }
+
+    std::vector<MaterialRecord> materials;
+    for (const Material &material : scene.Materials)
+    {
+        materials.push_back({{material.Albedo.x, material.Albedo.y, material.Albedo.z},
+                             material.Roughness, material.Specular, material.Shininess});
+    }
+
+    std::vector<LightRecord> lights;
+    for (const Light &light : scene.Lights)
+    {
+        lights.push_back({{light.Position.x, light.Position.y, light.Position.z},
+                          {light.Color.x, light.Color.y, light.Color.z}, light.Intensity});
+    }
+
+    std::vector<InstanceRecord> instances;
+    for (const Instance &instance : scene.Instances)
+    {
+        InstanceRecord record = {};
+        for (int row = 0; row < 3; row++)
+        {
+            for (int column = 0; column < 4; column++)
+                record.Rows[row][column] = instance.ObjectToWorld.Rows[row][column];
+        }
+        record.GeometryIndex = instance.GeometryIndex;
+        record.MaterialIndex = instance.MaterialIndex;
+        instances.push_back(record);
+    }
+
+    Header header = {};
+    std::memcpy(header.Magic, Magic, sizeof(Magic));
+    header.Version = Version;
+    header.ByteOrder = ByteOrderMark;
+    header.Builder = (glm::uint32)builder;
+    header.Flags = includeBVH ? HasBVHFlag : 0;
+    std::memcpy(header.CameraPosition, &camera.GetPosition(), sizeof(header.CameraPosition));
+    std::memcpy(header.CameraDirection, &camera.GetDirection(), sizeof(header.CameraDirection));
+    std::memcpy(header.AmbientLight, &scene.AmbientLight, sizeof(header.AmbientLight));
+    header.AmbientIntensity = scene.AmbientIntensity;
+
+    FILE *file = std::fopen(path.c_str(), "wb");
+    if (!file)
+    {
+        std::cerr << "SceneFile: cannot write " << path << std::endl;
+        return false;
+    }
+
+    // The header goes last, once the section table is known
+    SectionWriter writer(file);
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+              writer.Write(header.Sections[Materials], materials) &&
+              writer.Write(header.Sections[Lights], lights) &&
+              writer.Write(header.Sections[Shapes], shapes) &&
+              writer.Write(header.Sections[Geometries], geometries) &&
+              writer.Write(header.Sections[GeometryShapes], geometryShapes) &&
+              writer.Write(header.Sections[Instances], instances) &&
+              writer.Write(header.Sections[Meshes], save.Meshes) &&
+              writer.Write(header.Sections[MeshVertices], save.Vertices) &&
+              writer.Write(header.Sections[MeshIndices], save.Indices) &&
+              writer.Write(header.Sections[MeshNodes], save.Nodes) &&
+              writer.Write(header.Sections[BVHNodes], bvhNodes) &&
+              std::fseek(file, 0, SEEK_SET) == 0 &&
+              std::fwrite(&header, sizeof(header), 1, file) == 1;
+    ok = std::fclose(file) == 0 && ok;
+
+    if (!ok)
+    {
+        std::cerr << "SceneFile: failed writing " << path << std::endl;
+        std::remove(path.c_str());
+    }
+    return ok;
+}
+
+bool SceneFile::Load(const std::string &path, Scene &scene, Camera &camera)
+{
+    std::shared_ptr<SceneFile> file(new SceneFile());
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    LARGE_INTEGER fileSize;
+    if (handle != INVALID_HANDLE_VALUE && GetFileSizeEx(handle, &fileSize) && fileSize.QuadPart >= (LONGLONG)sizeof(Header))
+    {
+        // The view keeps the file open, both handles can go right away
+        HANDLE mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping)
+        {
+            file->data = (const unsigned char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            file->size = (size_t)fileSize.QuadPart;
+            CloseHandle(mapping);
+        }
+    }
+    if (handle != INVALID_HANDLE_VALUE)
+        CloseHandle(handle);
+#else
+    int descriptor = open(path.c_str(), O_RDONLY);
+    struct stat status;
+    if (descriptor >= 0 && fstat(descriptor, &status) == 0 && (size_t)status.st_size >= sizeof(Header))
+    {
+        // The mapping keeps the file open, the descriptor can go right away
+        void *mapped = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (mapped != MAP_FAILED)
+        {
+            file->data = (const unsigned char *)mapped;
+            file->size = (size_t)status.st_size;
+        }
+    }
+    if (descriptor >= 0)
+        close(descriptor);
+#endif
+    if (!file->data)
+    {
+        std::cerr << "SceneFile: cannot map " << path << std::endl;
+        return false;
+    }
+
+    Reader reader(file->data, file->size);
+    const Header &header = reader.GetHeader();
+    if (std::memcmp(header.Magic, Magic, sizeof(Magic)) != 0 || header.ByteOrder != ByteOrderMark)
+    {
+        std::cerr << "SceneFile: " << path << " is not a scene file for this machine" << std::endl;
+        return false;
+    }
+    if (header.Version != Version)
+    {
+        std::cerr << "SceneFile: " << path << " has version " << header.Version << ", expected " << Version << std::endl;
+        return false;
+    }
+
+    const MaterialRecord *materials;
+    const LightRecord *lights;
+    const ShapeRecord *shapes, *geometryShapes;
+    const GeometryRecord *geometries;
+    const InstanceRecord *instances;
+    size_t materialCount, lightCount, shapeCount, geometryShapeCount, geometryCount, instanceCount;
+    MappedMeshes meshes;
+    if (header.Builder > (glm::uint32)BVHBuilder::LBVH ||
+        !reader.GetSection(Materials, materials, materialCount) ||
+        !reader.GetSection(Lights, lights, lightCount) ||
+        !reader.GetSection(Shapes, shapes, shapeCount) ||
+        !reader.GetSection(Geometries, geometries, geometryCount) ||
+        !reader.GetSection(GeometryShapes, geometryShapes, geometryShapeCount) ||
+        !reader.GetSection(Instances, instances, instanceCount) ||
+        !reader.GetSection(Meshes, meshes.Records, meshes.Count) ||
+        !reader.GetSection(MeshVertices, meshes.Vertices, meshes.VertexCount) ||
+        !reader.GetSection(MeshIndices, meshes.Indices, meshes.IndexCount) ||
+        !reader.GetSection(MeshNodes, meshes.Nodes, meshes.NodeCount) ||
+        !reader.GetSection(BVHNodes, file->bvhNodes, file->bvhNodeCount))
+    {
+        std::cerr << "SceneFile: " << path << " is truncated or corrupt" << std::endl;
+        return false;
+    }
+
+    Scene loaded;
+    loaded.Builder = (BVHBuilder)header.Builder;
+    loaded.AmbientLight = glm::vec3(header.AmbientLight[0], header.AmbientLight[1], header.AmbientLight[2]);
+    loaded.AmbientIntensity = header.AmbientIntensity;
+
+    loaded.Materials.resize(materialCount);
+    for (size_t i = 0; i < materialCount; i++)
+    {
+        Material &material = loaded.Materials[i];
+        material.Albedo = glm::vec3(materials[i].Albedo[0], materials[i].Albedo[1], materials[i].Albedo[2]);
+        material.Roughness = materials[i].Roughness;
+        material.Specular = materials[i].Specular;
+        material.Shininess = materials[i].Shininess;
+    }
+
+    loaded.Lights.resize(lightCount);
+    for (size_t i = 0; i < lightCount; i++)
+    {
+        Light &light = loaded.Lights[i];
+        light.Position = glm::vec3(lights[i].Position[0], lights[i].Position[1], lights[i].Position[2]);
+        light.Color = glm::vec3(lights[i].Color[0], lights[i].Color[1], lights[i].Color[2]);
+        light.Intensity = lights[i].Intensity;
+    }
+
+    bool ok = LoadShapes(shapes, shapeCount, materialCount, meshes, loaded.Shapes);
+    for (size_t i = 0; ok && i < geometryCount; i++)
+    {
+        const GeometryRecord &geometry = geometries[i];
+        ok = geometry.FirstShape <= geometryShapeCount && geometry.ShapeCount <= geometryShapeCount - geometry.FirstShape;
+        loaded.Geometries.emplace_back();
+        ok = ok && LoadShapes(geometryShapes + geometry.FirstShape, geometry.ShapeCount, materialCount, meshes, loaded.Geometries.back().Shapes);
+    }
+    loaded.Instances.resize(instanceCount);
+    for (size_t i = 0; ok && i < instanceCount; i++)
+    {
+        Instance &instance = loaded.Instances[i];
+        for (int row = 0; row < 3; row++)
+            instance.ObjectToWorld.Rows[row] = glm::vec4(instances[i].Rows[row][0], instances[i].Rows[row][1], instances[i].Rows[row][2], instances[i].Rows[row][3]);
+        instance.GeometryIndex = instances[i].GeometryIndex;
+        instance.MaterialIndex = instances[i].MaterialIndex;
+        ok = instance.MaterialIndex < (int)materialCount;
+    }
+    if (!ok)
+    {
+        std::cerr << "SceneFile: " << path << " has a shape, mesh or instance out of range" << std::endl;
+        return false;
+    }
+
+    glm::vec3 direction(header.CameraDirection[0], header.CameraDirection[1], header.CameraDirection[2]);
+    if (glm::dot(direction, direction) > 0.0f)
+        camera.SetView(glm::vec3(header.CameraPosition[0], header.CameraPosition[1], header.CameraPosition[2]), glm::normalize(direction));
+
+    // Everything else was copied out, only a file with a sphere tree has to stay mapped
+    file->builder = loaded.Builder;
+    if ((header.Flags & HasBVHFlag) != 0)
+        loaded.Prebuilt = file;
+    scene = std::move(loaded);
+    return true;
+}
@@ -0,0 +1,731 @@
+#include "SceneJSON.h"
+#include "TextParsing.h"
+#include "Sphere.h"
+#include "Plane.h"
+#include "Mesh.h"
+#include "ObjLoader.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string_view>
+
+namespace
+{
+    // Nesting allowed inside values that are skipped, keeps hostile files from exhausting the stack
+    const int MaxSkipDepth = 64;
+
+    // Recursive descent straight into the description, no document tree is built. Keys are compared in place
+    // as views of the text; only strings that are kept (mesh paths) are copied and unescaped.
+    class Parser
+    {
+    public:
+        Parser(const char *text, size_t size, const std::string &directory)
+            : begin(text), p(text), end(text + size), directory(directory) {}
+
+        bool ParseScene(SceneJSON::SceneDescription &description)
+        {
+            bool ok = ParseObject([&](std::string_view key)
+                                  {
+                if (key == "camera")
+                    return ParseCamera(description);
+                if (key == "settings")
+                    return ParseSettings(description.Settings);
+                if (key == "builder")
+                    return ParseBuilder(description.Builder);
+                if (key == "ambient")
+                    return ParseObject([&](std::string_view ambientKey)
+                                       {
+                        if (ambientKey == "color")
+                            return ParseVec3(description.AmbientLight);
+                        if (ambientKey == "intensity")
+                            return ParseFloat(description.AmbientIntensity);
+                        return SkipValue(0); });
+                if (key == "materials")
+                    return ParseArray([&]
+                                      {
+                        description.Materials.emplace_back();
+                        return ParseMaterial(description.Materials.back()); });
+                if (key == "lights")
+                    return ParseArray([&]
+                                      {
+                        description.Lights.push_back({glm::vec3(0.0f), glm::vec3(1.0f), 1.0f});
+                        return ParseLight(description.Lights.back()); });
+                if (key == "shapes")
+                    return ParseArray([&]
+                                      {
+                        description.Shapes.emplace_back();
+                        return ParseShape(description.Shapes.back()); });
+                return SkipValue(0); });
+            if (!ok)
+                return false;
+
+            SkipWhitespace();
+            if (p != end)
+                return Fail("trailing characters after the scene object");
+            return true;
+        }
+
+        // "message on line n"
+        std::string GetError() const
+        {
+            size_t line = 1 + std::count(begin, std::min(errorAt, end), '\n');
+            return error + " on line " + std::to_string(line);
+        }
+
+    private:
+        bool ParseCamera(SceneJSON::SceneDescription &description)
+        {
+            description.HasCamera = true;
+            return ParseObject([&](std::string_view key)
+                               {
+                if (key == "position")
+                    return ParseVec3(description.CameraPosition);
+                if (key == "direction")
+                    return ParseVec3(description.CameraDirection);
+                return SkipValue(0); });
+        }
+
+        bool ParseSettings(Tracer::Settings &settings)
+        {
+            return ParseObject([&](std::string_view key)
+                               {
+                if (key == "accumulate")
+                    return ParseBool(settings.Accumulate);
+                if (key == "bounces")
+                    return ParseInt(settings.Bounces);
+                if (key == "russianRoulette")
+                    return ParseBool(settings.RussianRoulette);
+                if (key == "rouletteDepth")
+                    return ParseInt(settings.RouletteDepth);
+                if (key == "threads")
+                    return ParseInt(settings.ThreadCount);
+                if (key == "tileSize")
+                    return ParseInt(settings.TileSize);
+                if (key == "useBVH")
+                    return ParseBool(settings.UseBVH);
+                if (key == "bvhWidth")
+                    return ParseInt(settings.BVHWidth);
+                if (key == "quantizedBVH")
+                    return ParseBool(settings.QuantizedBVH);
+                if (key == "packetSize")
+                    return ParseInt(settings.PacketSize);
+                if (key == "wavefront")
+                    return ParseBool(settings.Wavefront);
+                if (key == "sortByMaterial")
+                    return ParseBool(settings.SortByMaterial);
+                if (key == "adaptiveSampling")
+                    return ParseBool(settings.AdaptiveSampling);
+                if (key == "noiseThreshold")
+                    return ParseFloat(settings.NoiseThreshold);
+                if (key == "lightSampling")
+                    return ParseLightSampling(settings.LightSelection);
+                if (key == "lightSamples")
+                    return ParseInt(settings.LightSamples);
+                return SkipValue(0); });
+        }
+
+        bool ParseBuilder(BVHBuilder &builder)
+        {
+            std::string_view name;
+            bool escaped;
+            if (!ParseString(name, escaped))
+                return false;
+            if (name == "sah")
+                builder = BVHBuilder::SAH;
+            else if (name == "lbvh")
+                builder = BVHBuilder::LBVH;
+            else
+                return Fail("unknown builder");
+            return true;
+        }
+
+        bool ParseLightSampling(LightSampling &sampling)
+        {
+            std::string_view name;
+            bool escaped;
+            if (!ParseString(name, escaped))
+                return false;
+            if (name == "all")
+                sampling = LightSampling::All;
+            else if (name == "resampled")
+                sampling = LightSampling::Resampled;
+            else if (name == "tree")
+                sampling = LightSampling::Tree;
+            else
+                return Fail("unknown light sampling");
+            return true;
+        }
+
+        bool ParseMaterial(Material &material)
+        {
+            return ParseObject([&](std::string_view key)
+                               {
+                if (key == "albedo")
+                    return ParseVec3(material.Albedo);
+                if (key == "roughness")
+                    return ParseFloat(material.Roughness);
+                if (key == "specular")
+                    return ParseFloat(material.Specular);
+                if (key == "shininess")
+                    return ParseFloat(material.Shininess);
+                return SkipValue(0); });
+        }
+
+        bool ParseLight(Light &light)
+        {
+            return ParseObject([&](std::string_view key)
+                               {
+                if (key == "position")
+                    return ParseVec3(light.Position);
+                if (key == "color")
+                    return ParseVec3(light.Color);
+                if (key == "intensity")
+                    return ParseFloat(light.Intensity);
+                return SkipValue(0); });
+        }
+
+        bool ParseShape(SceneJSON::ShapeDescription &shape)
+        {
+            bool typed = false;
+            bool ok = ParseObject([&](std::string_view key)
+                                  {
+                if (key == "type")
+                {
+                    std::string_view type;
+                    bool escaped;
+                    if (!ParseString(type, escaped))
+                        return false;
+                    if (type == "sphere")
+                        shape.Type = ShapeType::Sphere;
+                    else if (type == "plane")
+                        shape.Type = ShapeType::Plane;
+                    else if (type == "mesh")
+                        shape.Type = ShapeType::Mesh;
+                    else
+                        return Fail("unknown shape type");
+                    typed = true;
+                    return true;
+                }
+                if (key == "position")
+                    return ParseVec3(shape.Position);
+                if (key == "radius")
+                    return ParseFloat(shape.Radius);
+                if (key == "normal")
+                    return ParseVec3(shape.Normal);
+                if (key == "material")
+                    return ParseInt(shape.MaterialIndex);
+                if (key == "obj")
+                    return ParsePath(shape.MeshPath);
+                return SkipValue(0); });
+            if (!ok)
+                return false;
+
+            if (!typed)
+                return Fail("shape without a type");
+            if (shape.Type == ShapeType::Mesh && shape.MeshPath.empty())
+                return Fail("mesh without an obj path");
+            return true;
+        }
+
+        bool ParsePath(std::string &path)
+        {
+            std::string_view raw;
+            bool escaped;
+            if (!ParseString(raw, escaped))
+                return false;
+            path = escaped ? Unescape(raw) : std::string(raw);
+
+            std::filesystem::path file(path);
+            if (file.is_relative() && !directory.empty())
+                path = (std::filesystem::path(directory) / file).lexically_normal().string();
+            return true;
+        }
+
+        // Calls onKey for every key with p on its value, which onKey must consume
+        template <typename OnKey>
+        bool ParseObject(OnKey &&onKey)
+        {
+            if (!Expect('{'))
+                return false;
+            SkipWhitespace();
+            if (p < end && *p == '}')
+            {
+                p++;
+                return true;
+            }
+
+            while (true)
+            {
+                std::string_view key;
+                bool escaped;
+                SkipWhitespace();
+                if (!ParseString(key, escaped) || !Expect(':'))
+                    return false;
+                SkipWhitespace();
+                if (!onKey(key))
+                    return false;
+
+                SkipWhitespace();
+                if (p < end && *p == ',')
+                {
+                    p++;
+                    continue;
+                }
+                return Expect('}');
+            }
+        }
+
+        // Calls onElement with p on every element, which onElement must consume
+        template <typename OnElement>
+        bool ParseArray(OnElement &&onElement)
+        {
+            if (!Expect('['))
+                return false;
+            SkipWhitespace();
+            if (p < end && *p == ']')
+            {
+                p++;
+                return true;
+            }
+
+            while (true)
+            {
+                SkipWhitespace();
+                if (!onElement())
+                    return false;
+
+                SkipWhitespace();
+                if (p < end && *p == ',')
+                {
+                    p++;
+                    continue;
+                }
+                return Expect(']');
+            }
+        }
+
+        // View of the characters between the quotes, escaped tells whether any backslash needs decoding
+        bool ParseString(std::string_view &value, bool &escaped)
+        {
+            if (!Expect('"'))
+                return false;
+
+            const char *start = p;
+            escaped = false;
+            while (true)
+            {
+                const char *quote = (const char *)std::memchr(p, '"', end - p);
+                if (!quote)
+                    return Fail("unterminated string");
+
+                // A quote is escaped when an odd number of backslashes precede it
+                const char *backslash = quote;
+                while (backslash > start && backslash[-1] == '\\')
+                    backslash--;
+                p = quote + 1;
+                if ((quote - backslash) % 2 == 0)
+                    break;
+            }
+            value = std::string_view(start, p - 1 - start);
+            escaped = std::memchr(start, '\\', value.size()) != nullptr;
+            return true;
+        }
+
+        // Simple escapes only, \uXXXX keeps the code unit if it fits in one byte and drops it otherwise
+        std::string Unescape(std::string_view raw) const
+        {
+            std::string result;
+            result.reserve(raw.size());
+            for (size_t i = 0; i < raw.size(); i++)
+            {
+                if (raw[i] != '\\' || i + 1 == raw.size())
+                {
+                    result += raw[i];
+                    continue;
+                }
+
+                char c = raw[++i];
+                switch (c)
+                {
+                case 'n':
+                    result += '\n';
+                    break;
+                case 't':
+                    result += '\t';
+                    break;
+                case 'r':
+                    result += '\r';
+                    break;
+                case 'b':
+                    result += '\b';
+                    break;
+                case 'f':
+                    result += '\f';
+                    break;
+                case 'u':
+                    if (i + 4 < raw.size())
+                    {
+                        unsigned long code = std::strtoul(std::string(raw.substr(i + 1, 4)).c_str(), nullptr, 16);
+                        if (code < 0x80)
+                            result += (char)code;
+                        i += 4;
+                    }
+                    break;
+                default:
+                    result += c;
+                    break;
+                }
+            }
+            return result;
+        }
+
+        bool ParseFloat(float &value)
+        {
+            if (!TextParsing::ParseFloat(p, end, value))
+                return Fail("expected a number");
+            return true;
+        }
+
+        bool ParseInt(int &value)
+        {
+            long parsed;
+            if (!TextParsing::ParseInt(p, end, parsed) || (p < end && (*p == '.' || *p == 'e' || *p == 'E')))
+                return Fail("expected an integer");
+            value = (int)std::clamp(parsed, -2147483647L, 2147483647L);
+            return true;
+        }
+
+        bool ParseBool(bool &value)
+        {
+            if (end - p >= 4 && std::memcmp(p, "true", 4) == 0)
+            {
+                value = true;
+                p += 4;
+                return true;
+            }
+            if (end - p >= 5 && std::memcmp(p, "false", 5) == 0)
+            {
+                value = false;
+                p += 5;
+                return true;
+            }
+            return Fail("expected true or false");
+        }
+
+        bool ParseVec3(glm::vec3 &value)
+        {
+            int axis = 0;
+            bool ok = ParseArray([&]
+                                 {
+                if (axis == 3)
+                    return Fail("expected three numbers");
+                return ParseFloat(value[axis++]); });
+            if (ok && axis != 3)
+                return Fail("expected three numbers");
+            return ok;
+        }
+
+        // Any value, checked only as far as needed to find where it ends
+        bool SkipValue(int depth)
+        {
+            if (depth > MaxSkipDepth)
+                return Fail("nested too deeply");
+            if (p == end)
+                return Fail("unexpected end of file");
+
+            switch (*p)
+            {
+            case '{':
+                return ParseObject([&](std::string_view)
+                                   { return SkipValue(depth + 1); });
+            case '[':
+                return ParseArray([&]
+                                  { return SkipValue(depth + 1); });
+            case '"':
+            {
+                std::string_view value;
+                bool escaped;
+                return ParseString(value, escaped);
+            }
+            case 't':
+            case 'f':
+            {
+                bool value;
+                return ParseBool(value);
+            }
+            case 'n':
+                if (end - p >= 4 && std::memcmp(p, "null", 4) == 0)
+                {
+                    p += 4;
+                    return true;
+                }
+                return Fail("unexpected character");
+            default:
+            {
+                float value;
+                return ParseFloat(value);
+            }
+            }
+        }
+
+        void SkipWhitespace()
+        {
+            while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t'))
+                p++;
+        }
+
+        bool Expect(char c)
+        {
+            SkipWhitespace();
+            if (p == end || *p != c)
+            {
+                char message[] = "expected ' '";
+                message[10] = c;
+                return Fail(message);
+            }
+            p++;
+            return true;
+        }
+
+        bool Fail(const char *message)
+        {
+            // The innermost failure is the useful one, callers unwinding past it keep it
+            if (error.empty())
+            {
+                error = message;
+                errorAt = p;
+            }
+            return false;
+        }
+
+    private:
+        const char *begin;
+        const char *p;
+        const char *end;
+        const std::string &directory;
+
+        std::string error;
+        const char *errorAt = nullptr;
+    };
+
+    void WriteVec3(FILE *file, const glm::vec3 &value)
+    {
+        std::fprintf(file, "[%.9g, %.9g, %.9g]", value.x, value.y, value.z);
+    }
+}
+
+namespace SceneJSON
+{
+    bool ShapeDescription::operator==(const ShapeDescription &other) const
+    {
+        return Type == other.Type && Position == other.Position && Radius == other.Radius && Normal == other.Normal &&
+               MaterialIndex == other.MaterialIndex && MeshPath == other.MeshPath;
+    }
+
+    bool Parse(const char *text, size_t size, const std::string &directory, SceneDescription &description, std::string &error)
+    {
+        description = SceneDescription();
+        Parser parser(text, size, directory);
+        if (!parser.ParseScene(description))
+        {
+            error = parser.GetError();
+            return false;
+        }
+
+        if (description.Materials.empty() && !description.Shapes.empty())
+        {
+            error = "shapes without any materials";
+            return false;
+        }
+        for (const ShapeDescription &shape : description.Shapes)
+        {
+            if (shape.MaterialIndex < 0 || shape.MaterialIndex >= (int)description.Materials.size())
+            {
+                error = "shape material " + std::to_string(shape.MaterialIndex) + " out of range";
+                return false;
+            }
+        }
+        if (description.HasCamera && glm::length(description.CameraDirection) == 0.0f)
+        {
+            error = "camera direction is zero";
+            return false;
+        }
+        return true;
+    }
+
+    bool Read(const std::string &path, SceneDescription &description)
+    {
+        FILE *file = std::fopen(path.c_str(), "rb");
+        if (!file)
+        {
+            std::cerr << "SceneJSON: cannot open " << path << std::endl;
+            return false;
+        }
+
+        // The whole file in one buffer, the parser never looks back more than a string's length
+        std::fseek(file, 0, SEEK_END);
+        long fileSize = std::ftell(file);
+        std::fseek(file, 0, SEEK_SET);
+        std::vector<char> text(fileSize > 0 ? (size_t)fileSize : 0);
+        size_t read = text.empty() ? 0 : std::fread(text.data(), 1, text.size(), file);
+        std::fclose(file);
+        if (read != text.size())
+        {
+            std::cerr << "SceneJSON: cannot read " << path << std::endl;
+            return false;
+        }
+
+        std::string error;
+        std::string directory = std::filesystem::path(path).parent_path().string();
+        if (!Parse(text.data(), text.size(), directory, description, error))
+        {
+            std::cerr << "SceneJSON: " << path << ": " << error << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    std::shared_ptr<Shape> CreateShape(const ShapeDescription &description)
+    {
+        std::shared_ptr<Shape> shape;
+        switch (description.Type)
+        {
+        case ShapeType::Sphere:
+            shape = std::make_shared<Sphere>();
+            break;
+        case ShapeType::Plane:
+            shape = std::make_shared<Plane>();
+            break;
+        case ShapeType::Mesh:
+        {
+            std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>();
+            if (!ObjLoader::Load(description.MeshPath, *mesh))
+                return nullptr;
+            shape = mesh;
+            break;
+        }
+        }
+        shape->SetType(description.Type);
+        UpdateShape(description, *shape);
+        return shape;
+    }
+
+    void UpdateShape(const ShapeDescription &description, Shape &shape)
+    {
+        shape.Position = description.Position;
+        shape.MaterialIndex = description.MaterialIndex;
+        if (description.Type == ShapeType::Sphere)
+            static_cast<Sphere &>(shape).Radius = description.Radius;
+        else if (description.Type == ShapeType::Plane)
+            static_cast<Plane &>(shape).Normal = glm::normalize(description.Normal);
+    }
+
+    bool Instantiate(const SceneDescription &description, Scene &scene, Camera &camera)
+    {
+        std::vector<std::shared_ptr<Shape>> shapes;
+        shapes.reserve(description.Shapes.size());
+        for (const ShapeDescription &shapeDescription : description.Shapes)
+        {
+            std::shared_ptr<Shape> shape = CreateShape(shapeDescription);
+            if (!shape)
+                return false;
+            shapes.push_back(std::move(shape));
+        }
+
+        scene = Scene();
+        scene.Shapes = std::move(shapes);
+        scene.Materials = description.Materials;
+        scene.Lights = description.Lights;
+        scene.AmbientLight = description.AmbientLight;
+        scene.AmbientIntensity = description.AmbientIntensity;
+        scene.Builder = description.Builder;
+        if (description.HasCamera)
+            camera.SetView(description.CameraPosition, glm::normalize(description.CameraDirection));
+        return true;
+    }
+
+    bool Load(const std::string &path, Scene &scene, Camera &camera)
+    {
+        SceneDescription description;
+        return Read(path, description) && Instantiate(description, scene, camera);
+    }
+
+    bool Save(const std::string &path, const Scene &scene, const Camera &camera)
+    {
+        FILE *file = std::fopen(path.c_str(), "wb");
+        if (!file)
+        {
+            std::cerr << "SceneJSON: cannot write " << path << std::endl;
+            return false;
+        }
+
+        std::fprintf(file, "{\n  \"camera\": {\"position\": ");
+        WriteVec3(file, camera.GetPosition());
+        std::fprintf(file, ", \"direction\": ");
+        WriteVec3(file, camera.GetDirection());
+        std::fprintf(file, "},\n  \"builder\": \"%s\",\n", scene.Builder == BVHBuilder::LBVH ? "lbvh" : "sah");
+        std::fprintf(file, "  \"ambient\": {\"color\": ");
+        WriteVec3(file, scene.AmbientLight);
+        std::fprintf(file, ", \"intensity\": %.9g},\n", scene.AmbientIntensity);
+
+        std::fprintf(file, "  \"materials\": [");
+        for (size_t i = 0; i < scene.Materials.size(); i++)
+        {
+            const Material &material = scene.Materials[i];
+            std::fprintf(file, "%s\n    {\"albedo\": ", i ? "," : "");
+            WriteVec3(file, material.Albedo);
+            std::fprintf(file, ", \"roughness\": %.9g, \"specular\": %.9g, \"shininess\": %.9g}", material.Roughness,
+                         material.Specular, material.Shininess);
+        }
+        std::fprintf(file, "\n  ],\n  \"lights\": [");
+        for (size_t i = 0; i < scene.Lights.size(); i++)
+        {
+            const Light &light = scene.Lights[i];
+            std::fprintf(file, "%s\n    {\"position\": ", i ? "," : "");
+            WriteVec3(file, light.Position);
+            std::fprintf(file, ", \"color\": ");
+            WriteVec3(file, light.Color);
+            std::fprintf(file, ", \"intensity\": %.9g}", light.Intensity);
+        }
+
+        std::fprintf(file, "\n  ],\n  \"shapes\": [");
+        size_t written = 0;
+        size_t skipped = 0;
+        for (const std::shared_ptr<Shape> &shape : scene.Shapes)
+        {
+            if (shape->GetType() == ShapeType::Mesh)
+            {
+                skipped++;
+                continue;
+            }
+
+            std::fprintf(file, "%s\n    {\"type\": ", written++ ? "," : "");
+            if (shape->GetType() == ShapeType::Sphere)
+            {
+                std::fprintf(file, "\"sphere\", \"position\": ");
+                WriteVec3(file, shape->Position);
+                std::fprintf(file, ", \"radius\": %.9g", static_cast<const Sphere &>(*shape).Radius);
+            }
+            else
+            {
+                std::fprintf(file, "\"plane\", \"position\": ");
+                WriteVec3(file, shape->Position);
+                std::fprintf(file, ", \"normal\": ");
+                WriteVec3(file, static_cast<const Plane &>(*shape).Normal);
+            }
+            std::fprintf(file, ", \"material\": %d}", shape->MaterialIndex);
+        }
+        std::fprintf(file, "\n  ]\n}\n");
+        bool ok = std::fclose(file) == 0;
+
+        if (skipped > 0)
+            std::cerr << "SceneJSON: skipped " << skipped << " meshes, they have no OBJ file to refer to" << std::endl;
+        if (!scene.Instances.empty())
+            std::cerr << "SceneJSON: skipped " << scene.Instances.size() << " instances" << std::endl;
+        if (!ok)
+            std::cerr << "SceneJSON: cannot write " << path << std::endl;
+        return ok;
+    }
+}
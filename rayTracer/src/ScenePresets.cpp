@@ -0,0 +1,308 @@
+#include "ScenePresets.h"
+#include "Sphere.h"
+#include "Mesh.h"
+#include "ObjLoader.h"
+#include "SceneFile.h"
+#include "SceneJSON.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+
+namespace
+{
+    void AddSphere(Scene &scene, const glm::vec3 &position, float radius, int materialIndex)
+    {
+        std::shared_ptr<Sphere> sphere = std::make_shared<Sphere>();
+        sphere->SetPosition(position);
+        sphere->SetRadius(radius);
+        sphere->SetMaterialIndex(materialIndex);
+        scene.Shapes.push_back(sphere);
+    }
+
+    void AddLight(Scene &scene, const glm::vec3 &position, const glm::vec3 &color, float intensity)
+    {
+        Light light;
+        light.Position = position;
+        light.Color = color;
+        light.Intensity = intensity;
+        scene.Lights.push_back(light);
+    }
+
+    // Same materials the editor starts with, plus a grey ground
+    void LoadDefault(Scene &scene, Camera &camera)
+    {
+        Material pinkSphere;
+        pinkSphere.Albedo = {1.0f, 0.0f, 1.0f};
+        pinkSphere.Roughness = 0.0f;
+        scene.Materials.push_back(pinkSphere);
+
+        Material blueSphere;
+        blueSphere.Albedo = {0.2f, 0.3f, 1.0f};
+        blueSphere.Roughness = 0.1f;
+        scene.Materials.push_back(blueSphere);
+
+        Material ground;
+        ground.Albedo = {0.6f, 0.6f, 0.6f};
+        ground.Specular = 0.1f;
+        scene.Materials.push_back(ground);
+
+        AddSphere(scene, {0.0f, 0.0f, 0.0f}, 1.0f, 0);
+        AddSphere(scene, {2.2f, -0.4f, -1.0f}, 0.6f, 1);
+        AddSphere(scene, {0.0f, -101.0f, 0.0f}, 100.0f, 2);
+        AddLight(scene, {3.0f, 4.0f, 4.0f}, {1.0f, 1.0f, 1.0f}, 30.0f);
+
+        camera.SetView({0.0f, 0.0f, 6.0f}, {0.0f, 0.0f, -1.0f});
+    }
+
+    // count random spheres in a cube sized for roughly constant density
+    void LoadRandomSpheres(Scene &scene, Camera &camera, size_t count)
+    {
+        const glm::vec3 palette[] = {{0.9f, 0.2f, 0.2f}, {0.2f, 0.8f, 0.3f}, {0.2f, 0.3f, 1.0f}, {0.9f, 0.9f, 0.9f}};
+        for (const glm::vec3 &albedo : palette)
+        {
+            Material material;
+            material.Albedo = albedo;
+            material.Roughness = 0.5f;
+            scene.Materials.push_back(material);
+        }
+
+        float extent = 2.0f * std::cbrt((float)count);
+        std::mt19937 engine(1337);
+        std::uniform_real_distribution<float> coordinate(-extent, extent);
+        std::uniform_real_distribution<float> radius(0.3f, 0.6f);
+        std::uniform_int_distribution<int> material(0, 3);
+
+        scene.Shapes.reserve(count);
+        for (size_t i = 0; i < count; i++)
+            AddSphere(scene, {coordinate(engine), coordinate(engine), coordinate(engine)}, radius(engine), material(engine));
+
+        float lightDistance = extent * 2.0f;
+        AddLight(scene, {lightDistance, lightDistance, lightDistance}, {1.0f, 1.0f, 1.0f}, lightDistance * lightDistance * 2.0f);
+        AddLight(scene, {-lightDistance, lightDistance * 0.5f, lightDistance}, {0.8f, 0.8f, 1.0f}, lightDistance * lightDistance);
+
+        camera.SetView({0.0f, 0.0f, extent * 3.2f}, {0.0f, 0.0f, -1.0f});
+    }
+
+    // count copies of one 64-sphere helix, each with its own rotation, scale and material, over a single shared
+    // geometry; same palette, lights and density of objects as LoadRandomSpheres
+    void LoadInstancedHelices(Scene &scene, Camera &camera, size_t count)
+    {
+        const glm::vec3 palette[] = {{0.9f, 0.2f, 0.2f}, {0.2f, 0.8f, 0.3f}, {0.2f, 0.3f, 1.0f}, {0.9f, 0.9f, 0.9f}};
+        for (const glm::vec3 &albedo : palette)
+        {
+            Material material;
+            material.Albedo = albedo;
+            material.Roughness = 0.5f;
+            scene.Materials.push_back(material);
+        }
+
+        const int helixSpheres = 64;
+        Geometry helix;
+        for (int i = 0; i < helixSpheres; i++)
+        {
+            float t = (float)i / helixSpheres;
+            float angle = t * 4.0f * 3.14159265f;
+            std::shared_ptr<Sphere> sphere = std::make_shared<Sphere>();
+            sphere->SetPosition({0.4f * std::cos(angle), t * 1.6f - 0.8f, 0.4f * std::sin(angle)});
+            sphere->SetRadius(0.08f);
+            helix.Shapes.push_back(sphere);
+        }
+        scene.Geometries.push_back(helix);
+
+        float extent = 2.0f * std::cbrt((float)count);
+        std::mt19937 engine(1337);
+        std::uniform_real_distribution<float> coordinate(-extent, extent);
+        std::uniform_real_distribution<float> angle(0.0f, 360.0f);
+        std::uniform_real_distribution<float> scale(0.5f, 1.0f);
+        std::uniform_int_distribution<int> material(0, 3);
+
+        scene.Instances.reserve(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            Instance instance;
+            glm::vec3 position(coordinate(engine), coordinate(engine), coordinate(engine));
+            glm::vec3 rotation(angle(engine), angle(engine), angle(engine));
+            instance.ObjectToWorld = Transform::FromTRS(position, rotation, glm::vec3(scale(engine)));
+            instance.MaterialIndex = material(engine);
+            scene.Instances.push_back(instance);
+        }
+
+        float lightDistance = extent * 2.0f;
+        AddLight(scene, {lightDistance, lightDistance, lightDistance}, {1.0f, 1.0f, 1.0f}, lightDistance * lightDistance * 2.0f);
+        AddLight(scene, {-lightDistance, lightDistance * 0.5f, lightDistance}, {0.8f, 0.8f, 1.0f}, lightDistance * lightDistance);
+
+        camera.SetView({0.0f, 0.0f, extent * 3.2f}, {0.0f, 0.0f, -1.0f});
+    }
+
+    // count small coloured lights hovering over a field of spheres on a ground, each lighting mostly its own
+    // neighbourhood; the field grows with count so every light has about the same number of spheres around it
+    void LoadManyLights(Scene &scene, Camera &camera, size_t count)
+    {
+        const glm::vec3 palette[] = {{0.9f, 0.2f, 0.2f}, {0.2f, 0.8f, 0.3f}, {0.2f, 0.3f, 1.0f}, {0.9f, 0.9f, 0.9f}};
+        for (const glm::vec3 &albedo : palette)
+        {
+            Material material;
+            material.Albedo = albedo;
+            material.Roughness = 0.5f;
+            scene.Materials.push_back(material);
+        }
+        Material ground;
+        ground.Albedo = {0.6f, 0.6f, 0.6f};
+        ground.Specular = 0.1f;
+        scene.Materials.push_back(ground);
+
+        float extent = 2.0f * std::sqrt((float)count);
+        std::mt19937 engine(1337);
+        std::uniform_real_distribution<float> coordinate(-extent, extent);
+        std::uniform_real_distribution<float> height(0.5f, 2.0f);
+        std::uniform_real_distribution<float> radius(0.3f, 0.6f);
+        std::uniform_real_distribution<float> channel(0.2f, 1.0f);
+        std::uniform_real_distribution<float> intensity(2.0f, 6.0f);
+        std::uniform_int_distribution<int> material(0, 3);
+
+        AddSphere(scene, {0.0f, -1000.0f, 0.0f}, 1000.0f, 4);
+        for (float x = -extent + 1.0f; x < extent; x += 2.0f)
+        {
+            for (float z = -extent + 1.0f; z < extent; z += 2.0f)
+            {
+                float r = radius(engine);
+                AddSphere(scene, {x, r, z}, r, material(engine));
+            }
+        }
+
+        scene.Lights.reserve(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            glm::vec3 position(coordinate(engine), height(engine), coordinate(engine));
+            glm::vec3 color(channel(engine), channel(engine), channel(engine));
+            AddLight(scene, position, color, intensity(engine));
+        }
+
+        glm::vec3 eye(0.0f, extent * 0.6f, extent * 1.2f);
+        camera.SetView(eye, -glm::normalize(eye));
+    }
+
+    // Single material and two lights around a mesh, camera looking down at its bounds from +z
+    void FrameMesh(Scene &scene, Camera &camera, const std::shared_ptr<Mesh> &mesh)
+    {
+        Material material;
+        material.Albedo = {0.8f, 0.7f, 0.6f};
+        material.Roughness = 0.4f;
+        scene.Materials.push_back(material);
+        scene.Shapes.push_back(mesh);
+
+        AABB bounds = mesh->GetBounds();
+        glm::vec3 center = (bounds.Min + bounds.Max) * 0.5f;
+        float radius = glm::length(bounds.Max - bounds.Min) * 0.5f;
+        AddLight(scene, center + glm::vec3(2.0f, 2.0f, 2.0f) * radius, {1.0f, 1.0f, 1.0f}, radius * radius * 8.0f);
+        AddLight(scene, center + glm::vec3(-2.0f, 1.0f, 2.0f) * radius, {0.8f, 0.8f, 1.0f}, radius * radius * 4.0f);
+
+        glm::vec3 offset = glm::vec3(0.0f, 1.0f, 2.2f) * radius;
+        camera.SetView(center + offset, -glm::normalize(offset));
+    }
+
+    // Torus of about triangleCount triangles, twice as many segments around the ring as around the tube
+    void LoadTorus(Scene &scene, Camera &camera, size_t triangleCount)
+    {
+        const float ringRadius = 1.0f;
+        const float tubeRadius = 0.35f;
+        glm::uint32 tubeSegments = std::max(3u, (glm::uint32)std::sqrt(triangleCount / 4.0));
+        glm::uint32 ringSegments = tubeSegments * 2;
+
+        std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>();
+        mesh->Vertices.reserve((size_t)ringSegments * tubeSegments);
+        for (glm::uint32 i = 0; i < ringSegments; i++)
+        {
+            float ring = 2.0f * 3.14159265f * i / ringSegments;
+            for (glm::uint32 j = 0; j < tubeSegments; j++)
+            {
+                float tube = 2.0f * 3.14159265f * j / tubeSegments;
+                float distance = ringRadius + tubeRadius * std::cos(tube);
+                mesh->Vertices.push_back({distance * std::cos(ring), tubeRadius * std::sin(tube), distance * std::sin(ring)});
+            }
+        }
+
+        mesh->Indices.reserve((size_t)ringSegments * tubeSegments * 6);
+        for (glm::uint32 i = 0; i < ringSegments; i++)
+        {
+            glm::uint32 nextI = (i + 1) % ringSegments;
+            for (glm::uint32 j = 0; j < tubeSegments; j++)
+            {
+                glm::uint32 nextJ = (j + 1) % tubeSegments;
+                glm::uint32 a = i * tubeSegments + j;
+                glm::uint32 b = nextI * tubeSegments + j;
+                glm::uint32 c = nextI * tubeSegments + nextJ;
+                glm::uint32 d = i * tubeSegments + nextJ;
+                mesh->Indices.insert(mesh->Indices.end(), {a, b, c, a, c, d});
+            }
+        }
+        mesh->Build();
+
+        FrameMesh(scene, camera, mesh);
+    }
+
+    // Parses the count of a "prefix:<count>" name, 0 when name has another prefix or no valid count
+    unsigned long ParseCount(const std::string &name, const std::string &prefix)
+    {
+        if (name.compare(0, prefix.size(), prefix) != 0)
+            return 0;
+        char *end = nullptr;
+        unsigned long count = std::strtoul(name.c_str() + prefix.size(), &end, 10);
+        return *end == '\0' ? count : 0;
+    }
+}
+
+namespace ScenePresets
+{
+    bool Load(const std::string &name, Scene &scene, Camera &camera)
+    {
+        scene = Scene();
+
+        if (name == "default")
+        {
+            LoadDefault(scene, camera);
+            return true;
+        }
+
+        if (unsigned long count = ParseCount(name, "spheres:"))
+        {
+            LoadRandomSpheres(scene, camera, count);
+            return true;
+        }
+        if (unsigned long count = ParseCount(name, "instances:"))
+        {
+            LoadInstancedHelices(scene, camera, count);
+            return true;
+        }
+        if (unsigned long count = ParseCount(name, "lights:"))
+        {
+            LoadManyLights(scene, camera, count);
+            return true;
+        }
+        if (unsigned long count = ParseCount(name, "torus:"))
+        {
+            LoadTorus(scene, camera, count);
+            return true;
+        }
+        if (name.compare(0, 5, "bscn:") == 0)
+            return SceneFile::Load(name.substr(5), scene, camera);
+        if (name.compare(0, 5, "json:") == 0)
+            return SceneJSON::Load(name.substr(5), scene, camera);
+        if (name.compare(0, 4, "obj:") == 0)
+        {
+            std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>();
+            if (!ObjLoader::Load(name.substr(4), *mesh))
+                return false;
+            FrameMesh(scene, camera, mesh);
+            return true;
+        }
+
+        return false;
+    }
+
+    std::vector<std::string> GetNames()
+    {
+        return {"default", "spheres:<count>", "instances:<count>", "lights:<count>", "torus:<triangles>", "obj:<path>", "bscn:<path>", "json:<path>"};
+    }
+}
@@ -0,0 +1,227 @@
+#include "SceneWatcher.h"
+#include "Mesh.h"
+#include <unordered_map>
+#include <unordered_set>
+
+namespace
+{
+    bool SameMaterials(const std::vector<Material> &a, const std::vector<Material> &b)
+    {
+        return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const Material &x, const Material &y)
+                          { return x.Albedo == y.Albedo && x.Roughness == y.Roughness && x.Specular == y.Specular &&
+                                   x.Shininess == y.Shininess; });
+    }
+
+    bool SameLights(const std::vector<Light> &a, const std::vector<Light> &b)
+    {
+        return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const Light &x, const Light &y)
+                          { return x.Position == y.Position && x.Color == y.Color && x.Intensity == y.Intensity; });
+    }
+
+    // Copies the fields that differ between the two versions of the file, so settings changed in the UI since
+    // stay as they are unless the file changes them too
+    bool ApplySettings(const Tracer::Settings &previous, const Tracer::Settings &next, Tracer::Settings &settings)
+    {
+        bool changed = false;
+        auto apply = [&](auto Tracer::Settings::*field)
+        {
+            if (previous.*field != next.*field && settings.*field != next.*field)
+            {
+                settings.*field = next.*field;
+                changed = true;
+            }
+        };
+        apply(&Tracer::Settings::Accumulate);
+        apply(&Tracer::Settings::Bounces);
+        apply(&Tracer::Settings::RussianRoulette);
+        apply(&Tracer::Settings::RouletteDepth);
+        apply(&Tracer::Settings::ThreadCount);
+        apply(&Tracer::Settings::TileSize);
+        apply(&Tracer::Settings::UseBVH);
+        apply(&Tracer::Settings::BVHWidth);
+        apply(&Tracer::Settings::QuantizedBVH);
+        apply(&Tracer::Settings::PacketSize);
+        apply(&Tracer::Settings::Wavefront);
+        apply(&Tracer::Settings::SortByMaterial);
+        apply(&Tracer::Settings::AdaptiveSampling);
+        apply(&Tracer::Settings::NoiseThreshold);
+        apply(&Tracer::Settings::LightSelection);
+        apply(&Tracer::Settings::LightSamples);
+        return changed;
+    }
+}
+
+bool SceneWatcher::Open(const std::string &path, Scene &scene, Camera &camera, Tracer::Settings &settings)
+{
+    SceneJSON::SceneDescription description;
+    if (!SceneJSON::Read(path, description) || !SceneJSON::Instantiate(description, scene, camera))
+        return false;
+
+    std::error_code error;
+    this->path = path;
+    lastWriteTime = std::filesystem::last_write_time(path, error);
+    lastCheck = std::chrono::steady_clock::now();
+    status = "Loaded";
+
+    // Against the defaults, only the settings the file sets override the current ones
+    ApplySettings(Tracer::Settings(), description.Settings, settings);
+    current = std::move(description);
+    return true;
+}
+
+void SceneWatcher::Close()
+{
+    path.clear();
+    status.clear();
+    current = SceneJSON::SceneDescription();
+}
+
+bool SceneWatcher::Poll(Scene &scene, Camera &camera, Tracer::Settings &settings)
+{
+    if (path.empty())
+        return false;
+
+    auto now = std::chrono::steady_clock::now();
+    if (now - lastCheck < CheckInterval)
+        return false;
+    lastCheck = now;
+
+    // Editors often truncate and rewrite, a missing file or a half-written one is simply tried on the next change
+    std::error_code error;
+    std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(path, error);
+    if (error || writeTime == lastWriteTime)
+        return false;
+    lastWriteTime = writeTime;
+
+    SceneJSON::SceneDescription next;
+    if (!SceneJSON::Read(path, next))
+    {
+        status = "Parse error, see the console";
+        return false;
+    }
+
+    bool changed;
+    if (!Apply(next, scene, camera, settings, changed))
+        return false;
+    current = std::move(next);
+    return changed;
+}
+
+bool SceneWatcher::Apply(const SceneJSON::SceneDescription &next, Scene &scene, Camera &camera, Tracer::Settings &settings, bool &changed)
+{
+    // Same shapes in the same order can be edited in place, anything else (or shapes added from the UI since)
+    // needs the scene's shape list rebuilt. New shapes are created before anything is touched, a mesh that
+    // fails to load leaves the whole scene as it was.
+    bool sameLayout = current.Shapes.size() == next.Shapes.size() && scene.Shapes.size() == next.Shapes.size();
+    for (size_t i = 0; sameLayout && i < next.Shapes.size(); i++)
+        sameLayout = current.Shapes[i].Type == next.Shapes[i].Type && current.Shapes[i].MeshPath == next.Shapes[i].MeshPath &&
+                     scene.Shapes[i]->GetType() == next.Shapes[i].Type;
+
+    std::vector<std::shared_ptr<Shape>> shapes;
+    if (!sameLayout && !CreateShapes(next, scene, shapes))
+    {
+        status = "Cannot load a mesh, see the console";
+        return false;
+    }
+
+    changed = false;
+    if (!SameMaterials(current.Materials, next.Materials))
+    {
+        scene.Materials = next.Materials;
+        changed = true;
+    }
+    if (!SameLights(current.Lights, next.Lights))
+    {
+        scene.Lights = next.Lights;
+        scene.LightsDirty = true;
+        changed = true;
+    }
+    if (current.AmbientLight != next.AmbientLight || current.AmbientIntensity != next.AmbientIntensity)
+    {
+        scene.AmbientLight = next.AmbientLight;
+        scene.AmbientIntensity = next.AmbientIntensity;
+        changed = true;
+    }
+    if (current.Builder != next.Builder)
+    {
+        scene.Builder = next.Builder;
+        scene.GeometryDirty = true;
+        changed = true;
+    }
+
+    size_t edited = 0;
+    if (sameLayout)
+    {
+        for (size_t i = 0; i < next.Shapes.size(); i++)
+        {
+            if (current.Shapes[i] == next.Shapes[i])
+                continue;
+            SceneJSON::UpdateShape(next.Shapes[i], *scene.Shapes[i]);
+            scene.EditedShapes.push_back(i);
+            edited++;
+        }
+    }
+    else
+    {
+        scene.Shapes = std::move(shapes);
+        scene.EditedShapes.clear();
+        scene.GeometryDirty = true;
+        edited = next.Shapes.size();
+    }
+    changed |= edited > 0;
+
+    if (next.HasCamera && (!current.HasCamera || current.CameraPosition != next.CameraPosition ||
+                           current.CameraDirection != next.CameraDirection))
+    {
+        camera.SetView(next.CameraPosition, glm::normalize(next.CameraDirection));
+        changed = true;
+    }
+
+    changed |= ApplySettings(current.Settings, next.Settings, settings);
+
+    if (!sameLayout)
+        status = "Reloaded, " + std::to_string(next.Shapes.size()) + " shapes rebuilt";
+    else
+        status = "Reloaded, " + std::to_string(edited) + " shapes updated";
+    return true;
+}
+
+bool SceneWatcher::CreateShapes(const SceneJSON::SceneDescription &next, const Scene &scene, std::vector<std::shared_ptr<Shape>> &shapes)
+{
+    // Meshes already loaded from the same file are kept, with their BVH
+    std::unordered_map<std::string, std::shared_ptr<Shape>> meshes;
+    for (size_t i = 0; i < current.Shapes.size() && i < scene.Shapes.size(); i++)
+    {
+        if (current.Shapes[i].Type == ShapeType::Mesh && scene.Shapes[i]->GetType() == ShapeType::Mesh)
+            meshes.emplace(current.Shapes[i].MeshPath, scene.Shapes[i]);
+    }
+
+    // The first shape naming a file takes the loaded mesh, any further ones a copy since they are placed apart
+    std::unordered_set<std::string> taken;
+    shapes.reserve(next.Shapes.size());
+    for (const SceneJSON::ShapeDescription &description : next.Shapes)
+    {
+        auto mesh = description.Type == ShapeType::Mesh ? meshes.find(description.MeshPath) : meshes.end();
+        if (mesh == meshes.end())
+        {
+            std::shared_ptr<Shape> shape = SceneJSON::CreateShape(description);
+            if (!shape)
+                return false;
+            if (description.Type == ShapeType::Mesh)
+            {
+                meshes.emplace(description.MeshPath, shape);
+                taken.insert(description.MeshPath);
+            }
+            shapes.push_back(std::move(shape));
+        }
+        else if (taken.insert(description.MeshPath).second)
+            shapes.push_back(mesh->second);
+        else
+            shapes.push_back(std::make_shared<Mesh>(static_cast<const Mesh &>(*mesh->second)));
+    }
+
+    // Kept meshes are still live in the scene, they are only moved once nothing can fail any more
+    for (size_t i = 0; i < shapes.size(); i++)
+        SceneJSON::UpdateShape(next.Shapes[i], *shapes[i]);
+    return true;
+}
@@ -2,7 +2,6 @@
 #include <algorithm>
 #include <glm/glm.hpp>
 #include "Shape.h"
-#include "Renderer.h"
 
 Sphere::Sphere() : Shape()
 {
@@ -74,9 +73,35 @@ float Sphere::GetClosestHit(const Ray &ray) const
         hitDistance = closestT;
         return (hitDistance);
     }
+    return -1.0f;
 
     // if (closestSphere < 0)
     //     return Miss(ray);
 
     // return ClosestHit(ray, hitDistance, closestSphere);
-}
\ No newline at end of file
+}
+
+bool Sphere::AnyHit(const Ray &ray, float tMin, float tMax) const
+{
+    glm::vec3 origin = ray.Origin - Position;
+
+    float a = glm::dot(ray.Direction, ray.Direction);
+    float b = 2.0f * glm::dot(origin, ray.Direction);
+    float c = glm::dot(origin, origin) - Radius * Radius;
+
+    float discriminant = b * b - 4.0f * a * c;
+    if (discriminant < 0.0f)
+        return false;
+
+    // Same entry point as GetClosestHit so shadows agree with the closest-hit query
+    float closestT = (-b - glm::sqrt(discriminant)) / (2.0f * a);
+    return closestT > tMin && closestT < tMax;
+}
+
+AABB Sphere::GetBounds() const
+{
+    AABB bounds;
+    bounds.Min = Position - glm::vec3(glm::abs(Radius));
+    bounds.Max = Position + glm::vec3(glm::abs(Radius));
+    return bounds;
+}
@@ -0,0 +1,84 @@
+#include "SphereKernel.h"
+
+namespace SphereKernel
+{
+    namespace
+    {
+        // Lanes of the last step that lie past the range end are dropped from the hit bits
+        int ValidLanes(glm::uint32 remaining)
+        {
+            return remaining >= SIMD::Width ? (1 << SIMD::Width) - 1 : (1 << remaining) - 1;
+        }
+    }
+
+    int Intersect(const Spheres &spheres, const Ray &ray, glm::uint32 first, glm::uint32 count, float &hitDistance)
+    {
+        const SIMD::Float originX = SIMD::Broadcast(ray.Origin.x);
+        const SIMD::Float originY = SIMD::Broadcast(ray.Origin.y);
+        const SIMD::Float originZ = SIMD::Broadcast(ray.Origin.z);
+        const SIMD::Float directionX = SIMD::Broadcast(ray.Direction.x);
+        const SIMD::Float directionY = SIMD::Broadcast(ray.Direction.y);
+        const SIMD::Float directionZ = SIMD::Broadcast(ray.Direction.z);
+        const float a = glm::dot(ray.Direction, ray.Direction);
+        const SIMD::Float lengthSquared = SIMD::Broadcast(a);
+        const SIMD::Float negInvA = SIMD::Broadcast(-1.0f / a);
+        const SIMD::Float zero = SIMD::Broadcast(0.0f);
+
+        int hitSlot = -1;
+        glm::uint32 end = first + count;
+        for (glm::uint32 i = first; i < end; i += SIMD::Width)
+        {
+            SIMD::Float t = EntryDistance(originX - SIMD::LoadUnaligned(spheres.CenterX + i),
+                                          originY - SIMD::LoadUnaligned(spheres.CenterY + i),
+                                          originZ - SIMD::LoadUnaligned(spheres.CenterZ + i),
+                                          SIMD::LoadUnaligned(spheres.RadiusSquared + i),
+                                          directionX, directionY, directionZ, lengthSquared, negInvA);
+
+            int hitBits = SIMD::Bits(SIMD::Greater(t, zero) & SIMD::Less(t, SIMD::Broadcast(hitDistance))) & ValidLanes(end - i);
+            if (hitBits == 0)
+                continue;
+
+            // Hits are rare next to tests, resolve them lane by lane
+            alignas(32) float distances[SIMD::Width];
+            SIMD::Store(distances, t);
+            for (glm::uint32 lane = 0; lane < SIMD::Width; lane++)
+            {
+                if ((hitBits & (1 << lane)) && distances[lane] < hitDistance)
+                {
+                    hitDistance = distances[lane];
+                    hitSlot = (int)(i + lane);
+                }
+            }
+        }
+        return hitSlot;
+    }
+
+    bool AnyHit(const Spheres &spheres, const Ray &ray, glm::uint32 first, glm::uint32 count, float tMin, float tMax)
+    {
+        const SIMD::Float originX = SIMD::Broadcast(ray.Origin.x);
+        const SIMD::Float originY = SIMD::Broadcast(ray.Origin.y);
+        const SIMD::Float originZ = SIMD::Broadcast(ray.Origin.z);
+        const SIMD::Float directionX = SIMD::Broadcast(ray.Direction.x);
+        const SIMD::Float directionY = SIMD::Broadcast(ray.Direction.y);
+        const SIMD::Float directionZ = SIMD::Broadcast(ray.Direction.z);
+        const float a = glm::dot(ray.Direction, ray.Direction);
+        const SIMD::Float lengthSquared = SIMD::Broadcast(a);
+        const SIMD::Float negInvA = SIMD::Broadcast(-1.0f / a);
+        const SIMD::Float rangeMin = SIMD::Broadcast(tMin);
+        const SIMD::Float rangeMax = SIMD::Broadcast(tMax);
+
+        glm::uint32 end = first + count;
+        for (glm::uint32 i = first; i < end; i += SIMD::Width)
+        {
+            SIMD::Float t = EntryDistance(originX - SIMD::LoadUnaligned(spheres.CenterX + i),
+                                          originY - SIMD::LoadUnaligned(spheres.CenterY + i),
+                                          originZ - SIMD::LoadUnaligned(spheres.CenterZ + i),
+                                          SIMD::LoadUnaligned(spheres.RadiusSquared + i),
+                                          directionX, directionY, directionZ, lengthSquared, negInvA);
+
+            if (SIMD::Bits(SIMD::Greater(t, rangeMin) & SIMD::Less(t, rangeMax)) & ValidLanes(end - i))
+                return true;
+        }
+        return false;
+    }
+}
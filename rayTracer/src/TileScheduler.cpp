@@ -0,0 +1,83 @@
+#include "TileScheduler.h"
+#include <algorithm>
+#include <tbb/info.h>
+
+namespace
+{
+    glm::uint32 SpreadBits(glm::uint32 v)
+    {
+        v &= 0x0000ffff;
+        v = (v | (v << 8)) & 0x00ff00ff;
+        v = (v | (v << 4)) & 0x0f0f0f0f;
+        v = (v | (v << 2)) & 0x33333333;
+        v = (v | (v << 1)) & 0x55555555;
+        return v;
+    }
+
+    glm::uint32 MortonCode(glm::uint32 x, glm::uint32 y)
+    {
+        return SpreadBits(x) | (SpreadBits(y) << 1);
+    }
+}
+
+TileScheduler::TileScheduler()
+{
+    SetThreadCount(0);
+}
+
+TileScheduler::~TileScheduler()
+{
+}
+
+int TileScheduler::GetMaxThreadCount()
+{
+    return tbb::info::default_concurrency();
+}
+
+void TileScheduler::SetThreadCount(int count)
+{
+    if (count == requestedThreads && arena)
+        return;
+
+    requestedThreads = count;
+    arenaThreads = count > 0 ? std::min(count, GetMaxThreadCount()) : GetMaxThreadCount();
+    arena = std::make_unique<tbb::task_arena>(arenaThreads);
+}
+
+void TileScheduler::Configure(glm::uint32 width, glm::uint32 height, glm::uint32 tileSize)
+{
+    tileSize = std::max(tileSize, 1u);
+    if (width == this->width && height == this->height && tileSize == this->tileSize)
+        return;
+
+    this->width = width;
+    this->height = height;
+    this->tileSize = tileSize;
+
+    glm::uint32 tilesX = (width + tileSize - 1) / tileSize;
+    glm::uint32 tilesY = (height + tileSize - 1) / tileSize;
+
+    std::vector<std::pair<glm::uint32, Tile>> ordered;
+    ordered.reserve(tilesX * tilesY);
+    for (glm::uint32 ty = 0; ty < tilesY; ty++)
+    {
+        for (glm::uint32 tx = 0; tx < tilesX; tx++)
+        {
+            Tile tile;
+            tile.MinX = tx * tileSize;
+            tile.MinY = ty * tileSize;
+            tile.MaxX = std::min(tile.MinX + tileSize, width);
+            tile.MaxY = std::min(tile.MinY + tileSize, height);
+            ordered.push_back({MortonCode(tx, ty), tile});
+        }
+    }
+
+    // Neighbouring tiles end up close in the list, so a worker walking its range stays in nearby memory
+    std::sort(ordered.begin(), ordered.end(), [](const auto &a, const auto &b)
+              { return a.first < b.first; });
+
+    tiles.clear();
+    tiles.reserve(ordered.size());
+    for (const auto &entry : ordered)
+        tiles.push_back(entry.second);
+}
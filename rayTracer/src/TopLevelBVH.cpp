@@ -0,0 +1,178 @@
+#include "TopLevelBVH.h"
+#include "Mesh.h"
+#include <chrono>
+#include <limits>
+
+void TopLevelBVH::Build(const Scene &scene, BVHBuilder builder)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    this->builder = builder;
+    bottomLevels.clear();
+    stats.GeometryShapeCount = 0;
+    for (const Geometry &geometry : scene.Geometries)
+    {
+        std::unique_ptr<BottomLevel> bottomLevel = std::make_unique<BottomLevel>();
+        bottomLevel->Geometry.Compile(geometry.Shapes);
+        bottomLevel->Tree.Build(bottomLevel->Geometry, builder);
+        if (!bottomLevel->Tree.GetNodes().empty())
+            bottomLevel->Bounds = bottomLevel->Tree.GetNodes()[0].Bounds;
+        for (const Mesh *mesh : bottomLevel->Geometry.GetMeshes().Meshes)
+            bottomLevel->Bounds.Grow(mesh->GetBounds());
+        stats.GeometryShapeCount += geometry.Shapes.size();
+        bottomLevels.push_back(std::move(bottomLevel));
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    stats.GeometryBuildTimeMs = std::chrono::duration<float, std::milli>(end - start).count();
+    stats.GeometryCount = (glm::uint32)bottomLevels.size();
+
+    Update(scene);
+}
+
+void TopLevelBVH::Update(const Scene &scene)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    worldToObject.resize(scene.Instances.size());
+    std::vector<AABB> instanceBounds;
+    std::vector<PlacedInstance> instances;
+    stats.InstancedShapeCount = 0;
+    for (size_t i = 0; i < scene.Instances.size(); i++)
+    {
+        const Instance &instance = scene.Instances[i];
+        worldToObject[i] = instance.ObjectToWorld.Inverse();
+        if (instance.GeometryIndex >= bottomLevels.size())
+            continue;
+
+        const BottomLevel &bottomLevel = *bottomLevels[instance.GeometryIndex];
+        if (bottomLevel.Tree.GetNodes().empty() && bottomLevel.Geometry.GetMeshes().Size() == 0)
+            continue;
+
+        instanceBounds.push_back(instance.ObjectToWorld.TransformBounds(bottomLevel.Bounds));
+        instances.push_back({worldToObject[i], &bottomLevel.Tree, &bottomLevel.Geometry, (int)i});
+        stats.InstancedShapeCount += bottomLevel.Tree.GetStats().BoundedCount + bottomLevel.Geometry.GetMeshes().Size();
+    }
+
+    topLevel.Build(instanceBounds, builder);
+
+    // Stored in leaf order, so a leaf's instances sit next to each other
+    const std::vector<glm::uint32> &order = topLevel.GetPrimitiveIndices();
+    placed.resize(order.size());
+    for (size_t i = 0; i < order.size(); i++)
+        placed[i] = instances[order[i]];
+
+    auto end = std::chrono::high_resolution_clock::now();
+    stats.BuildTimeMs = std::chrono::duration<float, std::milli>(end - start).count();
+    stats.InstanceCount = (glm::uint32)placed.size();
+
+    stats.MemorySize = topLevel.GetNodes().size() * sizeof(BVH::Node) + placed.size() * sizeof(PlacedInstance);
+    for (const std::unique_ptr<BottomLevel> &bottomLevel : bottomLevels)
+    {
+        // Five floats or ints per sphere: centre, squared radius and shape index
+        stats.MemorySize += bottomLevel->Tree.GetNodes().size() * sizeof(BVH::Node) +
+                            bottomLevel->Geometry.GetSpheres().Size() * 5 * sizeof(float);
+        for (const Mesh *mesh : bottomLevel->Geometry.GetMeshes().Meshes)
+            stats.MemorySize += mesh->GetMemorySize();
+    }
+}
+
+bool TopLevelBVH::IntersectCloser(const Ray &ray, float &hitDistance, int &objectIndex, int &instanceIndex, int &triangle) const
+{
+    if (placed.empty())
+        return false;
+
+    const std::vector<BVH::Node> &nodes = topLevel.GetNodes();
+    float incomingDistance = hitDistance;
+
+    struct StackEntry
+    {
+        glm::uint32 Node;
+        float Distance;
+    };
+    StackEntry stack[BVH::MaxDepth + 4];
+    int stackSize = 0;
+
+    glm::vec3 invDirection = 1.0f / ray.Direction;
+    float rootDistance = nodes[0].Bounds.Intersect(ray, invDirection, hitDistance);
+    if (rootDistance < hitDistance)
+        stack[stackSize++] = {0, rootDistance};
+
+    while (stackSize > 0)
+    {
+        StackEntry entry = stack[--stackSize];
+        if (entry.Distance >= hitDistance)
+            continue;
+
+        const BVH::Node &node = nodes[entry.Node];
+        if (node.IsLeaf())
+        {
+            // The object-space direction keeps the scale of the transform, so distances carry over unchanged
+            for (glm::uint32 i = node.LeftFirst; i < node.LeftFirst + node.Count; i++)
+            {
+                const PlacedInstance &instance = placed[i];
+                Ray objectRay = instance.WorldToObject.TransformRay(ray);
+                if (instance.Tree->IntersectCloser(objectRay, hitDistance, objectIndex))
+                {
+                    instanceIndex = instance.InstanceIndex;
+                    triangle = -1;
+                }
+                if (instance.Geometry->IntersectMeshes(objectRay, hitDistance, objectIndex, triangle))
+                    instanceIndex = instance.InstanceIndex;
+            }
+            continue;
+        }
+
+        glm::uint32 nearChild = node.LeftFirst;
+        glm::uint32 farChild = node.LeftFirst + 1;
+        float nearDistance = nodes[nearChild].Bounds.Intersect(ray, invDirection, hitDistance);
+        float farDistance = nodes[farChild].Bounds.Intersect(ray, invDirection, hitDistance);
+        if (farDistance < nearDistance)
+        {
+            std::swap(nearChild, farChild);
+            std::swap(nearDistance, farDistance);
+        }
+        if (farDistance < hitDistance)
+            stack[stackSize++] = {farChild, farDistance};
+        if (nearDistance < hitDistance)
+            stack[stackSize++] = {nearChild, nearDistance};
+    }
+
+    return hitDistance < incomingDistance;
+}
+
+bool TopLevelBVH::AnyHit(const Ray &ray, float tMin, float tMax) const
+{
+    if (placed.empty())
+        return false;
+
+    const std::vector<BVH::Node> &nodes = topLevel.GetNodes();
+    glm::uint32 stack[BVH::MaxDepth + 4];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+
+    glm::vec3 invDirection = 1.0f / ray.Direction;
+    while (stackSize > 0)
+    {
+        const BVH::Node &node = nodes[stack[--stackSize]];
+        if (node.Bounds.Intersect(ray, invDirection, tMax) == std::numeric_limits<float>::max())
+            continue;
+
+        if (node.IsLeaf())
+        {
+            for (glm::uint32 i = node.LeftFirst; i < node.LeftFirst + node.Count; i++)
+            {
+                const PlacedInstance &instance = placed[i];
+                Ray objectRay = instance.WorldToObject.TransformRay(ray);
+                if (instance.Tree->AnyHit(objectRay, tMin, tMax) || instance.Geometry->AnyHitMeshes(objectRay, tMin, tMax))
+                    return true;
+            }
+            continue;
+        }
+
+        stack[stackSize++] = node.LeftFirst + 1;
+        stack[stackSize++] = node.LeftFirst;
+    }
+
+    return false;
+}
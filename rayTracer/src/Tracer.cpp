@@ -0,0 +1,563 @@
+#include "Tracer.h"
+#include "SceneFile.h"
+#include "Random.h"
+#include "WavefrontIntegrator.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace Utils
+{
+    const float pi = 3.14159265358979323846;
+    const float shadowBias = 0.001f;      // Ajustar el bias para evitar patrones
+    const float shadowRandomness = 0.02f; // Ajustar la aleatoriedad para suavizar sombras
+    const glm::uint32 maxAdaptiveSamples = 8; // Per pixel and frame for tiles that have not converged
+
+    static glm::uint32 ConvertToRGBA(const glm::vec4 &color)
+    {
+        uint8_t r = (uint8_t)(color.r * 255.0f);
+        uint8_t g = (uint8_t)(color.g * 255.0f);
+        uint8_t b = (uint8_t)(color.b * 255.0f);
+        uint8_t a = (uint8_t)(color.a * 255.0f);
+
+        glm::uint32 result = (a << 24) | (b << 16) | (g << 8) | r;
+        return result;
+    }
+
+}
+
+Tracer::Tracer()
+{
+}
+
+Tracer::~Tracer()
+{
+    delete[] accumulationData;
+}
+
+void Tracer::OnResize(glm::uint32 width, glm::uint32 height)
+{
+    if (width == this->width && height == this->height && accumulationData)
+        return;
+    this->width = width;
+    this->height = height;
+
+    delete[] accumulationData;
+    accumulationData = new glm::vec4[width * height];
+    frameIndex = 1;
+}
+
+void Tracer::PrepareScene(Scene &scene)
+{
+    activeScene = &scene;
+    scheduler.SetThreadCount(settings.ThreadCount);
+
+    if (scene.GeometryDirty || scene.Builder != bvh.GetStats().Builder)
+    {
+        compiledScene.Compile(scene);
+        const SceneFile *prebuilt = scene.Prebuilt.get();
+        if (!prebuilt || prebuilt->GetBuilder() != scene.Builder ||
+            !bvh.Restore(compiledScene, prebuilt->GetBVHNodes(), prebuilt->GetBVHNodeCount(), scene.Builder))
+        {
+            scheduler.Execute([this, &scene]
+                              { bvh.Build(compiledScene, scene.Builder); });
+        }
+        scene.Prebuilt.reset();
+        builtWideWidth = 0;
+        scheduler.Execute([this, &scene]
+                          { instances.Build(scene, scene.Builder); });
+        scene.GeometryDirty = false;
+        scene.InstancesDirty = false;
+        scene.EditedShapes.clear();
+    }
+    else if (!scene.EditedShapes.empty())
+    {
+        RefitScene(scene);
+    }
+
+    // Moving instances never touches their geometry, only the tree over them
+    if (scene.InstancesDirty)
+    {
+        scheduler.Execute([this, &scene]
+                          { instances.Update(scene); });
+        scene.InstancesDirty = false;
+    }
+
+    // Lights edited in place keep the tree's topology until refitting has worn it out
+    if (scene.LightsDirty)
+    {
+        lightSampler.Build(scene.Lights);
+        if (!lightTree.Refit(scene.Lights))
+            lightTree.Build(scene.Lights);
+        scene.LightsDirty = false;
+    }
+
+    activeWidth = settings.BVHWidth == 4 || settings.BVHWidth == 8 ? settings.BVHWidth : 2;
+    activeQuantized = activeWidth != 2 && settings.QuantizedBVH;
+    if (activeWidth != 2 && (activeWidth != builtWideWidth || activeQuantized != builtQuantized))
+    {
+        if (activeWidth == 4 && activeQuantized)
+            quantizedBVH4.Build(bvh);
+        else if (activeWidth == 4)
+            bvh4.Build(bvh);
+        else if (activeQuantized)
+            quantizedBVH8.Build(bvh);
+        else
+            bvh8.Build(bvh);
+        builtWideWidth = activeWidth;
+        builtQuantized = activeQuantized;
+    }
+}
+
+void Tracer::RefitScene(Scene &scene)
+{
+    refitSlots.clear();
+    for (size_t shapeIndex : scene.EditedShapes)
+    {
+        int slot = compiledScene.UpdateShape(scene, shapeIndex);
+        if (slot >= 0)
+            refitSlots.push_back((glm::uint32)slot);
+    }
+    scene.EditedShapes.clear();
+
+    if (refitSlots.empty())
+        return;
+
+    // Refitting keeps the topology, once moved shapes have stretched the boxes too far a rebuild pays off.
+    // LBVH scenes expect most shapes to move every frame and rebuild right away instead of letting the tree wear out.
+    if (scene.Builder == BVHBuilder::LBVH || !bvh.Refit(refitSlots))
+    {
+        scheduler.Execute([this, &scene]
+                          { bvh.Build(compiledScene, scene.Builder); });
+        builtWideWidth = 0;
+        return;
+    }
+
+    if (builtWideWidth == 4 && builtQuantized)
+        quantizedBVH4.Refit(bvh);
+    else if (builtWideWidth == 4)
+        bvh4.Refit(bvh);
+    else if (builtWideWidth == 8 && builtQuantized)
+        quantizedBVH8.Refit(bvh);
+    else if (builtWideWidth == 8)
+        bvh8.Refit(bvh);
+}
+
+void Tracer::Render(Scene &scene, const Camera &camera, glm::uint32 *data)
+{
+    PrepareScene(scene);
+    activeCamera = &camera;
+
+    // The squared sums have to cover every sample of the accumulation, turning adaptive sampling on restarts it
+    adaptive = settings.Accumulate && settings.AdaptiveSampling && !settings.Wavefront;
+    if (adaptive && !convergence.IsActive())
+        frameIndex = 1;
+    else if (!adaptive)
+        convergence.Clear();
+
+    if (frameIndex == 1)
+    {
+        memset(accumulationData, 0, width * height * sizeof(glm::vec4));
+        if (adaptive)
+            convergence.Reset(width, height);
+    }
+
+    auto renderStart = std::chrono::high_resolution_clock::now();
+
+    if (settings.Wavefront)
+    {
+        if (!wavefront)
+            wavefront = std::make_unique<WavefrontIntegrator>();
+        wavefront->Render(*this, data);
+    }
+    else
+    {
+        scheduler.Configure(width, height, settings.TileSize);
+        if (adaptive)
+        {
+            convergence.Configure(settings.TileSize, settings.NoiseThreshold);
+            adaptiveSamples = convergence.GetSamplesPerPixel(Utils::maxAdaptiveSamples);
+        }
+        scheduler.Run([this, data](const TileScheduler::Tile &tile)
+                      { RenderTile(tile, data); });
+    }
+
+    auto renderEnd = std::chrono::high_resolution_clock::now();
+    lastRenderTimeMs = std::chrono::duration<float, std::milli>(renderEnd - renderStart).count();
+
+    if (settings.Accumulate)
+        frameIndex++;
+    else
+        frameIndex = 1;
+}
+
+const Tracer::WavefrontStats &Tracer::GetWavefrontStats() const
+{
+    static const WavefrontStats noStats;
+    return wavefront ? wavefront->GetStats() : noStats;
+}
+
+size_t Tracer::GetBVHMemorySize() const
+{
+    if (activeWidth == 4)
+        return activeQuantized ? quantizedBVH4.GetMemorySize() : bvh4.GetMemorySize();
+    if (activeWidth == 8)
+        return activeQuantized ? quantizedBVH8.GetMemorySize() : bvh8.GetMemorySize();
+    return bvh.GetNodes().size() * sizeof(BVH::Node);
+}
+
+glm::vec4 Tracer::RayGun(glm::uint32 x, glm::uint32 y, const HitPayload *primaryHit)
+{
+    Ray ray;
+    ray.Origin = activeCamera->GetPosition();
+    ray.Direction = activeCamera->GetRayDirections()[x + y * width];
+
+    // Numbered by the pixel's own sample count, which is frameIndex unless adaptive sampling gave it several
+    // samples in one frame
+    Sampler sampler(x + y * width, (glm::uint32)accumulationData[x + y * width].a + 1);
+
+    glm::vec3 color(0.0f);
+    float multiplier = 1.0f;
+
+    int bounces = settings.Bounces;
+
+    for (int i = 0; i < bounces; i++)
+    {
+        sampler.SetBounce(i);
+        Tracer::HitPayload payload = (i == 0 && primaryHit) ? *primaryHit : TraceRay(ray);
+        if (payload.HitDistance < 0.0f)
+        {
+            color += GetSkyColor() * multiplier;
+            break;
+        }
+
+        const Material &material = GetMaterial(payload);
+
+        // Componente de luz ambiental ajustada por su intensidad
+        glm::vec3 accumulatedLight = activeScene->AmbientLight * activeScene->AmbientIntensity * material.Albedo;
+
+        // Iterar sobre todas las luces, o sobre las elegidas al muestrearlas
+        glm::uint32 shadowRays = GetShadowRaysPerHit();
+        for (glm::uint32 s = 0; s < shadowRays; s++)
+        {
+            float weight = 1.0f;
+            int lightIndex = SelectLight(s, payload, material, sampler, weight);
+            if (lightIndex < 0)
+                continue;
+            const Light &light = activeScene->Lights[lightIndex];
+
+            float lightDistance = 0.0f;
+            Ray shadowRay = GenerateShadowRay(payload, light, sampler, lightDistance);
+            bool inShadow = TraceShadowRay(shadowRay, lightDistance);
+
+            accumulatedLight += ShadeLight(ray, payload, material, light, inShadow) * weight;
+        }
+
+        color += accumulatedLight * multiplier;
+
+        multiplier *= 0.5f;
+
+        ray = GenerateBounceRay(ray, payload, material, sampler);
+        if (!ContinuePath(i, multiplier, sampler))
+            break;
+    }
+
+    return glm::vec4(color, 1.0f);
+}
+
+const Material &Tracer::GetMaterial(const HitPayload &payload) const
+{
+    return activeScene->Materials[GetMaterialIndex(payload)];
+}
+
+int Tracer::GetMaterialIndex(const HitPayload &payload) const
+{
+    if (payload.InstanceIndex < 0)
+        return activeScene->Shapes[payload.ObjectIndex]->GetMaterialIndex();
+
+    const Instance &instance = activeScene->Instances[payload.InstanceIndex];
+    if (instance.MaterialIndex >= 0)
+        return instance.MaterialIndex;
+    return activeScene->Geometries[instance.GeometryIndex].Shapes[payload.ObjectIndex]->GetMaterialIndex();
+}
+
+glm::uint32 Tracer::GetShadowRaysPerHit() const
+{
+    if (settings.LightSelection == LightSampling::All || activeScene->Lights.empty())
+        return (glm::uint32)activeScene->Lights.size();
+    return (glm::uint32)std::max(settings.LightSamples, 1);
+}
+
+int Tracer::SelectLight(glm::uint32 sample, const HitPayload &payload, const Material &material, Sampler &sampler, float &weight) const
+{
+    weight = 1.0f;
+    if (settings.LightSelection == LightSampling::All)
+        return (int)sample;
+
+    int lightIndex = settings.LightSelection == LightSampling::Tree
+                         ? lightTree.Sample(payload.WorldPosition, payload.WorldNormal, material.Specular, sampler, weight)
+                         : lightSampler.Sample(activeScene->Lights, payload.WorldPosition, payload.WorldNormal, material.Specular, sampler, weight);
+    weight /= (float)GetShadowRaysPerHit();
+    return lightIndex;
+}
+
+Ray Tracer::GenerateShadowRay(const HitPayload &payload, const Light &light, Sampler &sampler, float &lightDistance) const
+{
+    glm::vec3 lightDir = glm::normalize(light.Position - payload.WorldPosition);
+    lightDistance = glm::length(light.Position - payload.WorldPosition);
+
+    // Sombra con aleatoriedad ajustada
+    Ray shadowRay;
+    shadowRay.Origin = payload.WorldPosition + payload.WorldNormal * Utils::shadowBias;
+    shadowRay.Direction = glm::normalize(lightDir + Utils::shadowRandomness * sampler.Vec3(-1.0f, 1.0f));
+    return shadowRay;
+}
+
+glm::vec3 Tracer::ShadeLight(const Ray &ray, const HitPayload &payload, const Material &material, const Light &light, bool inShadow) const
+{
+    glm::vec3 lightDir = glm::normalize(light.Position - payload.WorldPosition);
+    float lightDistance = glm::length(light.Position - payload.WorldPosition);
+
+    // Intensidad de la luz ajustada por la intensidad de la luz y la sombra
+    float lightIntensity = inShadow ? 0.0f : light.Intensity * glm::max(glm::dot(payload.WorldNormal, lightDir), 0.0f); // Componente difusa
+
+    // Atenuación (opcional)
+    float attenuation = 1.0f / (lightDistance * lightDistance);
+    lightIntensity *= attenuation;
+
+    // Componente difusa
+    glm::vec3 diffuse = material.Albedo * lightIntensity * light.Color;
+
+    // Componente especular (Phong)
+    glm::vec3 viewDir = glm::normalize(ray.Origin - payload.WorldPosition);
+    glm::vec3 reflectDir = glm::reflect(-lightDir, payload.WorldNormal);
+    float spec = glm::pow(glm::max(glm::dot(viewDir, reflectDir), 0.0f), material.Shininess);
+    glm::vec3 specular = material.Specular * spec * light.Color;
+
+    return diffuse + specular;
+}
+
+Ray Tracer::GenerateBounceRay(const Ray &ray, const HitPayload &payload, const Material &material, Sampler &sampler) const
+{
+    Ray bounce;
+    bounce.Origin = payload.WorldPosition + payload.WorldNormal * Utils::shadowBias;
+    bounce.Direction = glm::reflect(ray.Direction, payload.WorldNormal + material.Roughness * sampler.Vec3(-0.5f, 0.5f));
+    return bounce;
+}
+
+bool Tracer::ContinuePath(int bounce, float &multiplier, Sampler &sampler) const
+{
+    if (!settings.RussianRoulette || bounce < settings.RouletteDepth || bounce + 1 >= settings.Bounces)
+        return true;
+
+    // The path goes on with a probability equal to its throughput, survivors make up for the ones that ended
+    float survival = std::min(multiplier, 1.0f);
+    if (sampler.Float() >= survival)
+        return false;
+    multiplier /= survival;
+    return true;
+}
+
+Tracer::HitPayload Tracer::TraceRay(const Ray &ray)
+{
+    int closestShape = -1;
+    int closestInstance = -1;
+    int closestTriangle = -1;
+    float hitDistance = std::numeric_limits<float>::max();
+
+    bool hit;
+    if (!settings.UseBVH)
+        hit = compiledScene.Intersect(ray, hitDistance, closestShape);
+    else if (activeWidth == 4)
+        hit = activeQuantized ? quantizedBVH4.Intersect(ray, hitDistance, closestShape) : bvh4.Intersect(ray, hitDistance, closestShape);
+    else if (activeWidth == 8)
+        hit = activeQuantized ? quantizedBVH8.Intersect(ray, hitDistance, closestShape) : bvh8.Intersect(ray, hitDistance, closestShape);
+    else
+        hit = bvh.Intersect(ray, hitDistance, closestShape);
+    hit |= compiledScene.IntersectMeshes(ray, hitDistance, closestShape, closestTriangle);
+    hit |= instances.IntersectCloser(ray, hitDistance, closestShape, closestInstance, closestTriangle);
+    if (!hit)
+        return Miss(ray);
+
+    return ClosestHit(ray, hitDistance, closestShape, closestInstance, closestTriangle);
+}
+
+void Tracer::TracePacket(RayPacket &packet)
+{
+    if (activeWidth == 4 && activeQuantized)
+        quantizedBVH4.IntersectPacket(packet);
+    else if (activeWidth == 4)
+        bvh4.IntersectPacket(packet);
+    else if (activeWidth == 8 && activeQuantized)
+        quantizedBVH8.IntersectPacket(packet);
+    else if (activeWidth == 8)
+        bvh8.IntersectPacket(packet);
+    else
+        bvh.IntersectPacket(packet);
+
+    // Meshes walk their own trees and every instance has its own object space, so both are traced lane by lane
+    if (compiledScene.GetMeshes().Size() == 0 && instances.IsEmpty())
+        return;
+    for (glm::uint32 lane = 0; lane < packet.Size; lane++)
+    {
+        Ray ray;
+        ray.Origin = packet.Origin;
+        ray.Direction = packet.GetDirection(lane);
+        compiledScene.IntersectMeshes(ray, packet.HitDistance[lane], packet.ObjectIndex[lane], packet.PrimitiveIndex[lane]);
+        instances.IntersectCloser(ray, packet.HitDistance[lane], packet.ObjectIndex[lane], packet.InstanceIndex[lane], packet.PrimitiveIndex[lane]);
+    }
+}
+
+bool Tracer::TraceShadowRay(const Ray &ray, float maxDistance)
+{
+    bool occluded;
+    if (!settings.UseBVH)
+        occluded = compiledScene.AnyHit(ray, 0.0f, maxDistance);
+    else if (activeWidth == 4)
+        occluded = activeQuantized ? quantizedBVH4.AnyHit(ray, 0.0f, maxDistance) : bvh4.AnyHit(ray, 0.0f, maxDistance);
+    else if (activeWidth == 8)
+        occluded = activeQuantized ? quantizedBVH8.AnyHit(ray, 0.0f, maxDistance) : bvh8.AnyHit(ray, 0.0f, maxDistance);
+    else
+        occluded = bvh.AnyHit(ray, 0.0f, maxDistance);
+    return occluded || compiledScene.AnyHitMeshes(ray, 0.0f, maxDistance) || instances.AnyHit(ray, 0.0f, maxDistance);
+}
+
+void Tracer::RenderTile(const TileScheduler::Tile &tile, glm::uint32 *data)
+{
+    // A converged tile takes no samples, but data is a new buffer every frame and still needs its pixels
+    if (adaptive && convergence.IsConverged(tile))
+    {
+        for (glm::uint32 y = tile.MinY; y < tile.MaxY; y++)
+        {
+            for (glm::uint32 x = tile.MinX; x < tile.MaxX; x++)
+                ResolvePixel(x, y, data);
+        }
+        return;
+    }
+
+    // Camera rays have no jitter, the extra adaptive samples reuse the primary hit and differ from the first bounce on
+    glm::uint32 samples = adaptive ? adaptiveSamples : 1;
+    glm::uint32 blockSize = settings.PacketSize == 4 || settings.PacketSize == 8 ? settings.PacketSize : 0;
+    if (!settings.UseBVH || blockSize == 0)
+    {
+        for (glm::uint32 y = tile.MinY; y < tile.MaxY; y++)
+        {
+            for (glm::uint32 x = tile.MinX; x < tile.MaxX; x++)
+            {
+                for (glm::uint32 sample = 0; sample < samples; sample++)
+                    AccumulateSample(x, y, RayGun(x, y));
+                ResolvePixel(x, y, data);
+            }
+        }
+        if (adaptive)
+            convergence.UpdateTile(tile, accumulationData);
+        return;
+    }
+
+    // Camera rays are coherent, trace them block by block as packets; the bounces in RayGun stay single rays
+    RayPacket packet;
+    for (glm::uint32 blockY = tile.MinY; blockY < tile.MaxY; blockY += blockSize)
+    {
+        for (glm::uint32 blockX = tile.MinX; blockX < tile.MaxX; blockX += blockSize)
+        {
+            packet.Generate(activeCamera->GetPosition(), activeCamera->GetRayDirections(), width,
+                            blockX, blockY, blockSize, tile.MaxX, tile.MaxY);
+            TracePacket(packet);
+
+            glm::uint32 endY = std::min(blockY + blockSize, tile.MaxY);
+            glm::uint32 endX = std::min(blockX + blockSize, tile.MaxX);
+            for (glm::uint32 y = blockY; y < endY; y++)
+            {
+                for (glm::uint32 x = blockX; x < endX; x++)
+                {
+                    glm::uint32 lane = (x - blockX) + (y - blockY) * blockSize;
+                    Ray ray;
+                    ray.Origin = packet.Origin;
+                    ray.Direction = packet.GetDirection(lane);
+
+                    HitPayload primaryHit = packet.ObjectIndex[lane] < 0 ? Miss(ray) : ClosestHit(ray, packet.HitDistance[lane], packet.ObjectIndex[lane], packet.InstanceIndex[lane], packet.PrimitiveIndex[lane]);
+                    for (glm::uint32 sample = 0; sample < samples; sample++)
+                        AccumulateSample(x, y, RayGun(x, y, &primaryHit));
+                    ResolvePixel(x, y, data);
+                }
+            }
+        }
+    }
+    if (adaptive)
+        convergence.UpdateTile(tile, accumulationData);
+}
+
+void Tracer::WritePixel(glm::uint32 x, glm::uint32 y, const glm::vec4 &color, glm::uint32 *data)
+{
+    AccumulateSample(x, y, color);
+    ResolvePixel(x, y, data);
+}
+
+void Tracer::AccumulateSample(glm::uint32 x, glm::uint32 y, const glm::vec4 &color)
+{
+    accumulationData[x + y * width] += color;
+    if (adaptive)
+        convergence.AddSample(x + y * width, glm::vec3(color));
+}
+
+void Tracer::ResolvePixel(glm::uint32 x, glm::uint32 y, glm::uint32 *data)
+{
+    // Every sample adds 1 to alpha, which makes it the pixel's sample count
+    glm::vec4 accumulatedColor = accumulationData[x + y * width];
+    accumulatedColor /= accumulatedColor.a;
+
+    accumulatedColor = glm::clamp(accumulatedColor, glm::vec4(0.0f), glm::vec4(1.0f));
+    data[x + y * width] = Utils::ConvertToRGBA(accumulatedColor);
+}
+
+Tracer::HitPayload Tracer::ClosestHit(const Ray &ray, float hitDistance, int objectIndex, int instanceIndex, int primitiveIndex)
+{
+    Tracer::HitPayload payload;
+    payload.HitDistance = hitDistance;
+    payload.ObjectIndex = objectIndex;
+    payload.InstanceIndex = instanceIndex;
+    payload.PrimitiveIndex = primitiveIndex;
+
+    if (instanceIndex >= 0)
+    {
+        // Normal from the shape in object space, brought back with the inverse transpose
+        const Instance &instance = activeScene->Instances[instanceIndex];
+        const Shape &shape = *activeScene->Geometries[instance.GeometryIndex].Shapes[objectIndex];
+        const Transform &worldToObject = instances.GetWorldToObject(instanceIndex);
+
+        payload.WorldPosition = ray.Origin + ray.Direction * hitDistance;
+        glm::vec3 objectPosition = worldToObject.TransformPoint(payload.WorldPosition);
+        glm::vec3 objectNormal = GetShapeNormal(shape, objectPosition - shape.GetPosition(), primitiveIndex);
+        payload.WorldNormal = glm::normalize(worldToObject.TransformNormalByInverse(objectNormal));
+    }
+    else
+    {
+        const Shape &closestShape = *activeScene->Shapes[objectIndex];
+
+        glm::vec3 origin = ray.Origin - closestShape.GetPosition();
+        payload.WorldPosition = origin + ray.Direction * hitDistance;
+        payload.WorldNormal = GetShapeNormal(closestShape, payload.WorldPosition, primitiveIndex);
+
+        payload.WorldPosition += closestShape.GetPosition();
+    }
+
+    // Triangles are hit from both sides, shade the side the ray came from
+    if (primitiveIndex >= 0 && glm::dot(payload.WorldNormal, ray.Direction) > 0.0f)
+        payload.WorldNormal = -payload.WorldNormal;
+
+    return payload;
+}
+
+glm::vec3 Tracer::GetShapeNormal(const Shape &shape, const glm::vec3 &point, int primitiveIndex) const
+{
+    if (shape.GetType() == ShapeType::Mesh && primitiveIndex >= 0)
+        return static_cast<const Mesh &>(shape).GetTriangleNormal(primitiveIndex);
+    return shape.GetNormal(point);
+}
+
+Tracer::HitPayload Tracer::Miss(const Ray &ray)
+{
+    Tracer::HitPayload payload;
+    payload.HitDistance = -1.0f;
+    return payload;
+}
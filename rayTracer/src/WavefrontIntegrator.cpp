@@ -0,0 +1,246 @@
+#include "WavefrontIntegrator.h"
+#include <algorithm>
+
+namespace
+{
+    constexpr size_t PathGrainSize = 256;
+    constexpr size_t ShadowGrainSize = 512;
+}
+
+void WavefrontIntegrator::Render(Tracer &tracer, glm::uint32 *data)
+{
+    stats = Stats();
+
+    glm::uint32 width = tracer.width;
+    glm::uint32 height = tracer.height;
+    if (width == 0 || height == 0)
+        return;
+
+    // Whole rows per wave, a multiple of the packet size so primary packets never straddle two waves
+    glm::uint32 rowsPerWave = std::max(MaxWaveSize / width, 1u);
+    if (rowsPerWave > RayPacket::MaxBlockSize)
+        rowsPerWave -= rowsPerWave % RayPacket::MaxBlockSize;
+
+    for (glm::uint32 firstRow = 0; firstRow < height; firstRow += rowsPerWave)
+    {
+        glm::uint32 rowCount = std::min(rowsPerWave, height - firstRow);
+        stats.WaveCount++;
+
+        GeneratePrimary(tracer, firstRow, rowCount);
+        for (int bounce = 0; bounce < tracer.settings.Bounces; bounce++)
+        {
+            if (bounce > 0)
+                TraceActive(tracer);
+            Compact(tracer);
+            if (active.empty())
+                break;
+
+            if (tracer.settings.SortByMaterial)
+                SortByMaterial(tracer);
+            TraceShadows(tracer, (glm::uint32)bounce);
+            Shade(tracer, (glm::uint32)bounce);
+            if (tracer.settings.RussianRoulette && bounce >= tracer.settings.RouletteDepth)
+                Retire();
+        }
+        Write(tracer, firstRow, rowCount, data);
+    }
+}
+
+void WavefrontIntegrator::GeneratePrimary(Tracer &tracer, glm::uint32 firstRow, glm::uint32 rowCount)
+{
+    glm::uint32 width = tracer.width;
+    glm::uint32 pathCount = width * rowCount;
+    const Camera &camera = *tracer.activeCamera;
+
+    paths.resize(pathCount);
+    hits.resize(pathCount);
+    active.resize(pathCount);
+    for (glm::uint32 i = 0; i < pathCount; i++)
+        active[i] = i;
+    stats.PathsTraced += pathCount;
+
+    tracer.scheduler.ParallelFor(pathCount, PathGrainSize, [&](size_t begin, size_t end)
+                                 {
+        for (size_t i = begin; i < end; i++)
+        {
+            glm::uint32 pixel = firstRow * width + (glm::uint32)i;
+            PathState &path = paths[i];
+            path.CurrentRay.Origin = camera.GetPosition();
+            path.CurrentRay.Direction = camera.GetRayDirections()[pixel];
+            path.Color = glm::vec3(0.0f);
+            path.Multiplier = 1.0f;
+            path.PathSampler = Sampler(pixel, tracer.frameIndex);
+        } });
+
+    glm::uint32 blockSize = tracer.settings.PacketSize == 4 || tracer.settings.PacketSize == 8 ? tracer.settings.PacketSize : 0;
+    if (!tracer.settings.UseBVH || blockSize == 0)
+    {
+        TraceActive(tracer);
+        return;
+    }
+
+    // Camera rays are coherent, trace them as packets of whole blocks
+    glm::uint32 blocksX = (width + blockSize - 1) / blockSize;
+    glm::uint32 blocksY = (rowCount + blockSize - 1) / blockSize;
+    glm::uint32 endRow = firstRow + rowCount;
+    tracer.scheduler.ParallelFor(blocksX * blocksY, 1, [&](size_t begin, size_t end)
+                                 {
+        RayPacket packet;
+        for (size_t block = begin; block < end; block++)
+        {
+            glm::uint32 blockX = (glm::uint32)(block % blocksX) * blockSize;
+            glm::uint32 blockY = firstRow + (glm::uint32)(block / blocksX) * blockSize;
+            packet.Generate(camera.GetPosition(), camera.GetRayDirections(), width, blockX, blockY, blockSize, width, endRow);
+            tracer.TracePacket(packet);
+
+            for (glm::uint32 y = blockY; y < std::min(blockY + blockSize, endRow); y++)
+            {
+                for (glm::uint32 x = blockX; x < std::min(blockX + blockSize, width); x++)
+                {
+                    glm::uint32 lane = (x - blockX) + (y - blockY) * blockSize;
+                    glm::uint32 index = (y - firstRow) * width + x;
+                    const Ray &ray = paths[index].CurrentRay;
+                    hits[index] = packet.ObjectIndex[lane] < 0 ? tracer.Miss(ray) : tracer.ClosestHit(ray, packet.HitDistance[lane], packet.ObjectIndex[lane], packet.InstanceIndex[lane], packet.PrimitiveIndex[lane]);
+                }
+            }
+        } });
+}
+
+void WavefrontIntegrator::TraceActive(Tracer &tracer)
+{
+    stats.PathsTraced += (glm::uint32)active.size();
+    tracer.scheduler.ParallelFor(active.size(), PathGrainSize, [&](size_t begin, size_t end)
+                                 {
+        for (size_t i = begin; i < end; i++)
+        {
+            glm::uint32 index = active[i];
+            hits[index] = tracer.TraceRay(paths[index].CurrentRay);
+        } });
+}
+
+// Serial, order preserving and linear in the number of live paths; cheap next to the trace it follows
+void WavefrontIntegrator::Compact(Tracer &tracer)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < active.size(); i++)
+    {
+        glm::uint32 index = active[i];
+        if (hits[index].HitDistance < 0.0f)
+        {
+            PathState &path = paths[index];
+            path.Color += tracer.GetSkyColor() * path.Multiplier;
+            continue;
+        }
+        active[count++] = index;
+    }
+    active.resize(count);
+}
+
+// Counting sort, stable, so paths that shade the same material run back to back
+void WavefrontIntegrator::SortByMaterial(Tracer &tracer)
+{
+    const Scene &scene = *tracer.activeScene;
+    materialOffsets.assign(scene.Materials.size() + 1, 0);
+    for (glm::uint32 index : active)
+        materialOffsets[tracer.GetMaterialIndex(hits[index]) + 1]++;
+    for (size_t i = 1; i < materialOffsets.size(); i++)
+        materialOffsets[i] += materialOffsets[i - 1];
+
+    sorted.resize(active.size());
+    for (glm::uint32 index : active)
+        sorted[materialOffsets[tracer.GetMaterialIndex(hits[index])]++] = index;
+    active.swap(sorted);
+}
+
+void WavefrontIntegrator::TraceShadows(Tracer &tracer, glm::uint32 bounce)
+{
+    const std::vector<Light> &lights = tracer.activeScene->Lights;
+    size_t rayCount = tracer.GetShadowRaysPerHit();
+    size_t shadowCount = active.size() * rayCount;
+
+    shadowLights.resize(shadowCount);
+    shadowWeights.resize(shadowCount);
+    shadowRays.resize(shadowCount);
+    shadowDistances.resize(shadowCount);
+    occluded.resize(shadowCount);
+    stats.ShadowRays += (glm::uint32)shadowCount;
+
+    // Draws the same sampler dimensions in the same order as RayGun
+    tracer.scheduler.ParallelFor(active.size(), PathGrainSize, [&](size_t begin, size_t end)
+                                 {
+        for (size_t i = begin; i < end; i++)
+        {
+            glm::uint32 index = active[i];
+            PathState &path = paths[index];
+            path.PathSampler.SetBounce(bounce);
+            const Material &material = tracer.GetMaterial(hits[index]);
+            for (size_t s = 0; s < rayCount; s++)
+            {
+                size_t slot = i * rayCount + s;
+                shadowLights[slot] = tracer.SelectLight((glm::uint32)s, hits[index], material, path.PathSampler, shadowWeights[slot]);
+                if (shadowLights[slot] >= 0)
+                    shadowRays[slot] = tracer.GenerateShadowRay(hits[index], lights[shadowLights[slot]], path.PathSampler, shadowDistances[slot]);
+            }
+        } });
+
+    tracer.scheduler.ParallelFor(shadowCount, ShadowGrainSize, [&](size_t begin, size_t end)
+                                 {
+        for (size_t i = begin; i < end; i++)
+            occluded[i] = shadowLights[i] < 0 || tracer.TraceShadowRay(shadowRays[i], shadowDistances[i]) ? 1 : 0; });
+}
+
+void WavefrontIntegrator::Shade(Tracer &tracer, glm::uint32 bounce)
+{
+    const Scene &scene = *tracer.activeScene;
+    size_t rayCount = tracer.GetShadowRaysPerHit();
+
+    tracer.scheduler.ParallelFor(active.size(), PathGrainSize, [&](size_t begin, size_t end)
+                                 {
+        for (size_t i = begin; i < end; i++)
+        {
+            glm::uint32 index = active[i];
+            PathState &path = paths[index];
+            const Tracer::HitPayload &hit = hits[index];
+            const Material &material = tracer.GetMaterial(hit);
+
+            glm::vec3 accumulatedLight = scene.AmbientLight * scene.AmbientIntensity * material.Albedo;
+            for (size_t s = 0; s < rayCount; s++)
+            {
+                size_t slot = i * rayCount + s;
+                if (shadowLights[slot] >= 0)
+                    accumulatedLight += tracer.ShadeLight(path.CurrentRay, hit, material, scene.Lights[shadowLights[slot]], occluded[slot] != 0) * shadowWeights[slot];
+            }
+
+            path.Color += accumulatedLight * path.Multiplier;
+            path.Multiplier *= 0.5f;
+            path.CurrentRay = tracer.GenerateBounceRay(path.CurrentRay, hit, material, path.PathSampler);
+            if (!tracer.ContinuePath((int)bounce, path.Multiplier, path.PathSampler))
+                path.Multiplier = 0.0f;
+        } });
+}
+
+// Drops the paths Russian roulette ended before they are traced again
+void WavefrontIntegrator::Retire()
+{
+    size_t count = 0;
+    for (size_t i = 0; i < active.size(); i++)
+    {
+        glm::uint32 index = active[i];
+        if (paths[index].Multiplier > 0.0f)
+            active[count++] = index;
+    }
+    active.resize(count);
+}
+
+void WavefrontIntegrator::Write(Tracer &tracer, glm::uint32 firstRow, glm::uint32 rowCount, glm::uint32 *data)
+{
+    glm::uint32 width = tracer.width;
+    tracer.scheduler.ParallelFor(width * rowCount, PathGrainSize, [&](size_t begin, size_t end)
+                                 {
+        for (size_t i = begin; i < end; i++)
+        {
+            glm::uint32 x = (glm::uint32)i % width;
+            glm::uint32 y = firstRow + (glm::uint32)i / width;
+            tracer.WritePixel(x, y, glm::vec4(paths[i].Color, 1.0f), data);
+        } });
+}
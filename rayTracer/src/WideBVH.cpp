@@ -0,0 +1,466 @@
+#include "WideBVH.h"
+#include <chrono>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+    // Slab test of one ray against every child box of a node. Writes the entry distances to distances
+    // and returns one bit per child entered before tMax, with the same acceptance as AABB::Intersect.
+    template <glm::uint32 Lanes>
+    int IntersectChildren(const WideNode<Lanes> &node, const glm::vec3 &origin, const glm::vec3 &invDirection, float tMax, float *distances)
+    {
+        const SIMD::Float originX = SIMD::Broadcast(origin.x);
+        const SIMD::Float originY = SIMD::Broadcast(origin.y);
+        const SIMD::Float originZ = SIMD::Broadcast(origin.z);
+        const SIMD::Float invX = SIMD::Broadcast(invDirection.x);
+        const SIMD::Float invY = SIMD::Broadcast(invDirection.y);
+        const SIMD::Float invZ = SIMD::Broadcast(invDirection.z);
+        const SIMD::Float zero = SIMD::Broadcast(0.0f);
+        const SIMD::Float rangeMax = SIMD::Broadcast(tMax);
+
+        int hitBits = 0;
+        for (glm::uint32 lane = 0; lane < Lanes; lane += SIMD::Width)
+        {
+            SIMD::Float t0X = (SIMD::Load(node.MinX + lane) - originX) * invX;
+            SIMD::Float t0Y = (SIMD::Load(node.MinY + lane) - originY) * invY;
+            SIMD::Float t0Z = (SIMD::Load(node.MinZ + lane) - originZ) * invZ;
+            SIMD::Float t1X = (SIMD::Load(node.MaxX + lane) - originX) * invX;
+            SIMD::Float t1Y = (SIMD::Load(node.MaxY + lane) - originY) * invY;
+            SIMD::Float t1Z = (SIMD::Load(node.MaxZ + lane) - originZ) * invZ;
+
+            SIMD::Float tEnter = SIMD::Max(SIMD::Max(SIMD::Min(t0X, t1X), SIMD::Min(t0Y, t1Y)), SIMD::Min(t0Z, t1Z));
+            SIMD::Float tExit = SIMD::Min(SIMD::Min(SIMD::Max(t0X, t1X), SIMD::Max(t0Y, t1Y)), SIMD::Max(t0Z, t1Z));
+
+            SIMD::Mask hit = SIMD::LessEqual(tEnter, tExit) & SIMD::Greater(tExit, zero) & SIMD::Less(tEnter, rangeMax);
+            SIMD::Store(distances + lane, tEnter);
+            hitBits |= SIMD::Bits(hit) << lane;
+        }
+        return hitBits & ((1 << node.ChildCount) - 1);
+    }
+
+    // 2^(exponent - 127), built straight from the float bits
+    float GetStepSize(glm::uint8 exponent)
+    {
+        glm::uint32 bits = (glm::uint32)exponent << 23;
+        float step;
+        std::memcpy(&step, &bits, sizeof(step));
+        return step;
+    }
+
+    // Same test on quantized boxes, a plane q steps from the origin lies q * step + (origin - rayOrigin) from the ray origin.
+    // Decoding the plane before scaling by invDirection keeps axis-parallel rays free of inf - inf, like the float test
+    template <glm::uint32 Lanes>
+    int IntersectChildren(const QuantizedWideNode<Lanes> &node, const glm::vec3 &origin, const glm::vec3 &invDirection, float tMax, float *distances)
+    {
+        glm::vec3 offset = glm::vec3(node.Origin[0], node.Origin[1], node.Origin[2]) - origin;
+
+        const SIMD::Float stepX = SIMD::Broadcast(GetStepSize(node.Exponent[0]));
+        const SIMD::Float stepY = SIMD::Broadcast(GetStepSize(node.Exponent[1]));
+        const SIMD::Float stepZ = SIMD::Broadcast(GetStepSize(node.Exponent[2]));
+        const SIMD::Float offsetX = SIMD::Broadcast(offset.x);
+        const SIMD::Float offsetY = SIMD::Broadcast(offset.y);
+        const SIMD::Float offsetZ = SIMD::Broadcast(offset.z);
+        const SIMD::Float invX = SIMD::Broadcast(invDirection.x);
+        const SIMD::Float invY = SIMD::Broadcast(invDirection.y);
+        const SIMD::Float invZ = SIMD::Broadcast(invDirection.z);
+        const SIMD::Float zero = SIMD::Broadcast(0.0f);
+        const SIMD::Float rangeMax = SIMD::Broadcast(tMax);
+
+        int hitBits = 0;
+        for (glm::uint32 lane = 0; lane < Lanes; lane += SIMD::Width)
+        {
+            SIMD::Float t0X = SIMD::MultiplyAdd(SIMD::LoadBytes(node.MinX + lane), stepX, offsetX) * invX;
+            SIMD::Float t0Y = SIMD::MultiplyAdd(SIMD::LoadBytes(node.MinY + lane), stepY, offsetY) * invY;
+            SIMD::Float t0Z = SIMD::MultiplyAdd(SIMD::LoadBytes(node.MinZ + lane), stepZ, offsetZ) * invZ;
+            SIMD::Float t1X = SIMD::MultiplyAdd(SIMD::LoadBytes(node.MaxX + lane), stepX, offsetX) * invX;
+            SIMD::Float t1Y = SIMD::MultiplyAdd(SIMD::LoadBytes(node.MaxY + lane), stepY, offsetY) * invY;
+            SIMD::Float t1Z = SIMD::MultiplyAdd(SIMD::LoadBytes(node.MaxZ + lane), stepZ, offsetZ) * invZ;
+
+            SIMD::Float tEnter = SIMD::Max(SIMD::Max(SIMD::Min(t0X, t1X), SIMD::Min(t0Y, t1Y)), SIMD::Min(t0Z, t1Z));
+            SIMD::Float tExit = SIMD::Min(SIMD::Min(SIMD::Max(t0X, t1X), SIMD::Max(t0Y, t1Y)), SIMD::Max(t0Z, t1Z));
+
+            SIMD::Mask hit = SIMD::LessEqual(tEnter, tExit) & SIMD::Greater(tExit, zero) & SIMD::Less(tEnter, rangeMax);
+            SIMD::Store(distances + lane, tEnter);
+            hitBits |= SIMD::Bits(hit) << lane;
+        }
+        return hitBits & ((1 << node.ChildCount) - 1);
+    }
+
+    template <glm::uint32 Lanes>
+    AABB GetChildBounds(const WideNode<Lanes> &node, glm::uint32 lane)
+    {
+        AABB bounds;
+        bounds.Min = glm::vec3(node.MinX[lane], node.MinY[lane], node.MinZ[lane]);
+        bounds.Max = glm::vec3(node.MaxX[lane], node.MaxY[lane], node.MaxZ[lane]);
+        return bounds;
+    }
+
+    template <glm::uint32 Lanes>
+    AABB GetChildBounds(const QuantizedWideNode<Lanes> &node, glm::uint32 lane)
+    {
+        glm::vec3 origin(node.Origin[0], node.Origin[1], node.Origin[2]);
+        glm::vec3 step(GetStepSize(node.Exponent[0]), GetStepSize(node.Exponent[1]), GetStepSize(node.Exponent[2]));
+
+        AABB bounds;
+        bounds.Min = origin + glm::vec3(node.MinX[lane], node.MinY[lane], node.MinZ[lane]) * step;
+        bounds.Max = origin + glm::vec3(node.MaxX[lane], node.MaxY[lane], node.MaxZ[lane]) * step;
+        return bounds;
+    }
+
+    // Stores childCount boxes in the first lanes, the spare lanes get an empty box at the origin
+    template <glm::uint32 Lanes>
+    void SetChildBounds(WideNode<Lanes> &node, const AABB *bounds, glm::uint32 childCount)
+    {
+        for (glm::uint32 lane = 0; lane < Lanes; lane++)
+        {
+            AABB box;
+            box.Min = box.Max = glm::vec3(0.0f);
+            if (lane < childCount)
+                box = bounds[lane];
+            node.MinX[lane] = box.Min.x;
+            node.MinY[lane] = box.Min.y;
+            node.MinZ[lane] = box.Min.z;
+            node.MaxX[lane] = box.Max.x;
+            node.MaxY[lane] = box.Max.y;
+            node.MaxZ[lane] = box.Max.z;
+        }
+    }
+
+    // Smallest step that covers extent in 255 steps, as a biased exponent
+    glm::uint8 GetStepExponent(float origin, float max)
+    {
+        int exponent = 0;
+        std::frexp((max - origin) / 255.0f, &exponent);
+        exponent = std::min(std::max(exponent, -126), 127);
+        while (exponent < 127 && origin + 255.0f * GetStepSize((glm::uint8)(exponent + 127)) < max)
+            exponent++;
+        return (glm::uint8)(exponent + 127);
+    }
+
+    // Rounds down for a lower bound and up for an upper one, checked against the decoded value so float error never
+    // leaves a bound inside the box
+    glm::uint8 QuantizeMin(float value, float origin, float step)
+    {
+        int q = std::min(std::max((int)std::floor((value - origin) / step), 0), 255);
+        while (q > 0 && origin + (float)q * step > value)
+            q--;
+        return (glm::uint8)q;
+    }
+
+    glm::uint8 QuantizeMax(float value, float origin, float step)
+    {
+        int q = std::min(std::max((int)std::ceil((value - origin) / step), 0), 255);
+        while (q < 255 && origin + (float)q * step < value)
+            q++;
+        return (glm::uint8)q;
+    }
+
+    // Same for quantized nodes, the grid spans the union of the child boxes
+    template <glm::uint32 Lanes>
+    void SetChildBounds(QuantizedWideNode<Lanes> &node, const AABB *bounds, glm::uint32 childCount)
+    {
+        AABB parentBounds;
+        for (glm::uint32 lane = 0; lane < childCount; lane++)
+            parentBounds.Grow(bounds[lane]);
+        if (childCount == 0)
+            parentBounds.Min = parentBounds.Max = glm::vec3(0.0f);
+
+        glm::uint8 *mins[3] = {node.MinX, node.MinY, node.MinZ};
+        glm::uint8 *maxs[3] = {node.MaxX, node.MaxY, node.MaxZ};
+        for (int axis = 0; axis < 3; axis++)
+        {
+            float origin = parentBounds.Min[axis];
+            node.Origin[axis] = origin;
+            node.Exponent[axis] = GetStepExponent(origin, parentBounds.Max[axis]);
+            float step = GetStepSize(node.Exponent[axis]);
+
+            for (glm::uint32 lane = 0; lane < Lanes; lane++)
+            {
+                mins[axis][lane] = lane < childCount ? QuantizeMin(bounds[lane].Min[axis], origin, step) : 0;
+                maxs[axis][lane] = lane < childCount ? QuantizeMax(bounds[lane].Max[axis], origin, step) : 0;
+            }
+        }
+    }
+
+    struct StackEntry
+    {
+        glm::uint32 Child;
+        glm::uint32 Count; // > 0 for a leaf range
+        float Distance;
+    };
+
+    // Sorts the hit children of one node by decreasing distance, so pushing them in order leaves the nearest on top
+    int SortHits(int hitBits, const float *distances, const glm::uint32 *children, const glm::uint32 *counts, StackEntry *sorted)
+    {
+        int hitCount = 0;
+        while (hitBits != 0)
+        {
+            int lane = __builtin_ctz(hitBits);
+            hitBits &= hitBits - 1;
+
+            StackEntry entry = {children[lane], counts[lane], distances[lane]};
+            int i = hitCount++;
+            for (; i > 0 && sorted[i - 1].Distance < entry.Distance; i--)
+                sorted[i] = sorted[i - 1];
+            sorted[i] = entry;
+        }
+        return hitCount;
+    }
+}
+
+template <glm::uint32 N, bool Quantized>
+void WideBVH<N, Quantized>::Build(const BVH &binary)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    scene = binary.GetScene();
+    nodes.clear();
+    stats = BuildStats();
+
+    const std::vector<BVH::Node> &binaryNodes = binary.GetNodes();
+    binarySlots.assign(binaryNodes.size(), ~0u);
+    slotBinaries.clear();
+    if (!binaryNodes.empty())
+    {
+        // Every wide node absorbs at least N - 1 binary inner nodes, except the last ones on each path
+        nodes.reserve(binaryNodes.size() / (N - 1) + 1);
+        nodes.emplace_back();
+        Collapse(binaryNodes, 0, 0, 0);
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+
+    stats.BuildTimeMs = std::chrono::duration<float, std::milli>(end - start).count();
+    stats.NodeCount = (glm::uint32)nodes.size();
+}
+
+template <glm::uint32 N, bool Quantized>
+void WideBVH<N, Quantized>::Collapse(const std::vector<BVH::Node> &binaryNodes, glm::uint32 binaryIndex, glm::uint32 nodeIndex, glm::uint32 depth)
+{
+    stats.MaxDepth = std::max(stats.MaxDepth, depth);
+
+    // Start from the two children and keep opening the inner child with the largest surface area,
+    // the one most likely to be visited, until the node is full
+    glm::uint32 children[N];
+    glm::uint32 childCount = 0;
+    const BVH::Node &binaryNode = binaryNodes[binaryIndex];
+    if (binaryNode.IsLeaf())
+    {
+        children[childCount++] = binaryIndex;
+    }
+    else
+    {
+        children[childCount++] = binaryNode.LeftFirst;
+        children[childCount++] = binaryNode.LeftFirst + 1;
+    }
+
+    while (childCount < N)
+    {
+        int largest = -1;
+        float largestArea = -1.0f;
+        for (glm::uint32 i = 0; i < childCount; i++)
+        {
+            const BVH::Node &child = binaryNodes[children[i]];
+            float area = child.Bounds.GetSurfaceArea();
+            if (!child.IsLeaf() && area > largestArea)
+            {
+                largest = (int)i;
+                largestArea = area;
+            }
+        }
+        if (largest < 0)
+            break;
+
+        glm::uint32 opened = binaryNodes[children[largest]].LeftFirst;
+        children[largest] = opened;
+        children[childCount++] = opened + 1;
+    }
+
+    // Unused slots are never children, the child count masks them out anyway
+    for (glm::uint32 lane = 0; lane < Lanes; lane++)
+    {
+        Node &node = nodes[nodeIndex];
+        node.Child[lane] = 0;
+        node.Count[lane] = 0;
+    }
+    nodes[nodeIndex].ChildCount = childCount;
+
+    slotBinaries.resize(nodes.size() * Lanes, ~0u);
+    for (glm::uint32 lane = 0; lane < childCount; lane++)
+    {
+        binarySlots[children[lane]] = nodeIndex * Lanes + lane;
+        slotBinaries[nodeIndex * Lanes + lane] = children[lane];
+    }
+    EncodeNode(binaryNodes, nodeIndex);
+
+    for (glm::uint32 lane = 0; lane < childCount; lane++)
+    {
+        const BVH::Node &child = binaryNodes[children[lane]];
+        if (child.IsLeaf())
+        {
+            nodes[nodeIndex].Child[lane] = child.LeftFirst;
+            nodes[nodeIndex].Count[lane] = child.Count;
+            stats.LeafCount++;
+            continue;
+        }
+
+        // nodes may reallocate here, so nodeIndex is looked up again every time
+        glm::uint32 childIndex = (glm::uint32)nodes.size();
+        nodes.emplace_back();
+        nodes[nodeIndex].Child[lane] = childIndex;
+        nodes[nodeIndex].Count[lane] = 0;
+        Collapse(binaryNodes, children[lane], childIndex, depth + 1);
+    }
+}
+
+template <glm::uint32 N, bool Quantized>
+void WideBVH<N, Quantized>::EncodeNode(const std::vector<BVH::Node> &binaryNodes, glm::uint32 nodeIndex)
+{
+    Node &node = nodes[nodeIndex];
+    AABB bounds[Lanes];
+    for (glm::uint32 lane = 0; lane < node.ChildCount; lane++)
+        bounds[lane] = binaryNodes[slotBinaries[nodeIndex * Lanes + lane]].Bounds;
+    SetChildBounds(node, bounds, node.ChildCount);
+}
+
+template <glm::uint32 N, bool Quantized>
+void WideBVH<N, Quantized>::Refit(const BVH &binary)
+{
+    const std::vector<BVH::Node> &binaryNodes = binary.GetNodes();
+    for (glm::uint32 binaryIndex : binary.GetRefittedNodes())
+    {
+        // Nodes opened during the collapse have no slot of their own, their bounds live on in their children
+        glm::uint32 slot = binarySlots[binaryIndex];
+        if (slot == ~0u)
+            continue;
+
+        // All children of a quantized node share one grid, so the whole node is encoded again
+        EncodeNode(binaryNodes, slot / Lanes);
+    }
+}
+
+template <glm::uint32 N, bool Quantized>
+bool WideBVH<N, Quantized>::Intersect(const Ray &ray, float &hitDistance, int &objectIndex) const
+{
+    hitDistance = std::numeric_limits<float>::max();
+    objectIndex = -1;
+    if (scene == nullptr)
+        return false;
+
+    scene->IntersectPlanes(ray, hitDistance, objectIndex);
+
+    if (nodes.empty())
+        return objectIndex >= 0;
+
+    // Each visited node replaces its entry with at most N children
+    StackEntry stack[(BVH::MaxDepth + 1) * N];
+    int stackSize = 0;
+    stack[stackSize++] = {0, 0, 0.0f};
+
+    glm::vec3 invDirection = 1.0f / ray.Direction;
+    alignas(SIMD::Alignment) float distances[Lanes];
+    while (stackSize > 0)
+    {
+        StackEntry entry = stack[--stackSize];
+        if (entry.Distance >= hitDistance)
+            continue;
+
+        if (entry.Count > 0)
+        {
+            scene->IntersectSpheres(ray, entry.Child, entry.Count, hitDistance, objectIndex);
+            continue;
+        }
+
+        const Node &node = nodes[entry.Child];
+        int hitBits = IntersectChildren(node, ray.Origin, invDirection, hitDistance, distances);
+        stackSize += SortHits(hitBits, distances, node.Child, node.Count, stack + stackSize);
+    }
+
+    return objectIndex >= 0;
+}
+
+template <glm::uint32 N, bool Quantized>
+bool WideBVH<N, Quantized>::AnyHit(const Ray &ray, float tMin, float tMax) const
+{
+    if (scene == nullptr)
+        return false;
+
+    if (scene->AnyHitPlanes(ray, tMin, tMax))
+        return true;
+
+    if (nodes.empty())
+        return false;
+
+    // No ordering needed, any blocker ends the query; leaves are tested as soon as their box is entered
+    glm::uint32 stack[(BVH::MaxDepth + 1) * N];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+
+    glm::vec3 invDirection = 1.0f / ray.Direction;
+    alignas(SIMD::Alignment) float distances[Lanes];
+    while (stackSize > 0)
+    {
+        const Node &node = nodes[stack[--stackSize]];
+        int hitBits = IntersectChildren(node, ray.Origin, invDirection, tMax, distances);
+        while (hitBits != 0)
+        {
+            int lane = __builtin_ctz(hitBits);
+            hitBits &= hitBits - 1;
+
+            if (node.Count[lane] == 0)
+                stack[stackSize++] = node.Child[lane];
+            else if (scene->AnyHitSpheres(ray, node.Child[lane], node.Count[lane], tMin, tMax))
+                return true;
+        }
+    }
+
+    return false;
+}
+
+template <glm::uint32 N, bool Quantized>
+void WideBVH<N, Quantized>::IntersectPacket(RayPacket &packet) const
+{
+    if (scene == nullptr)
+        return;
+
+    scene->IntersectPlanes(packet);
+
+    if (nodes.empty())
+        return;
+
+    StackEntry stack[(BVH::MaxDepth + 1) * N];
+    int stackSize = 0;
+    stack[stackSize++] = {0, 0, 0.0f};
+
+    // The centre ray decides the visiting order, the whole packet decides which children are visited
+    glm::vec3 centerDirection = packet.GetDirection(packet.Size / 2);
+    glm::vec3 invDirection = 1.0f / centerDirection;
+    alignas(SIMD::Alignment) float distances[Lanes];
+
+    while (stackSize > 0)
+    {
+        StackEntry entry = stack[--stackSize];
+        if (entry.Count > 0)
+        {
+            scene->IntersectSpheres(packet, entry.Child, entry.Count);
+            continue;
+        }
+
+        const Node &node = nodes[entry.Child];
+        IntersectChildren(node, packet.Origin, invDirection, std::numeric_limits<float>::max(), distances);
+
+        int hitBits = 0;
+        for (glm::uint32 lane = 0; lane < node.ChildCount; lane++)
+        {
+            if (packet.HitsBounds(GetChildBounds(node, lane)))
+                hitBits |= 1 << lane;
+        }
+        stackSize += SortHits(hitBits, distances, node.Child, node.Count, stack + stackSize);
+    }
+}
+
+template class WideBVH<4>;
+template class WideBVH<8>;
+template class WideBVH<4, true>;
+template class WideBVH<8, true>;